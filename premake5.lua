@@ -1,3 +1,18 @@
+newoption {
+    trigger = "profile",
+    description = "Build with the CPU profiler zones compiled in"
+}
+
+newoption {
+    trigger = "headless",
+    description = "Build with the EGL surfaceless backend, selected at runtime with --headless"
+}
+
+newoption {
+    trigger = "avx2",
+    description = "Build with AVX2 code paths, the binary then requires a CPU supporting them"
+}
+
 workspace "pgr-engine"
     configurations { "Debug", "Release" }
     flags { "MultiProcessorCompile" }
@@ -33,3 +48,13 @@ workspace "pgr-engine"
             kind "WindowedApp"
             defines { "NDEBUG" }
             optimize "On"
+
+        filter "options:profile"
+            defines { "ENGINE_PROFILE" }
+
+        filter "options:headless"
+            defines { "ENGINE_HEADLESS" }
+            links { "EGL" }
+
+        filter "options:avx2"
+            vectorextensions "AVX2"
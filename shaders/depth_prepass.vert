@@ -0,0 +1,58 @@
+#version 460 core
+
+/* Only the position is pulled, the rest of the vertex stays in memory */
+struct vertex_t {
+    float pos[3];
+    float normal[3];
+    float tangent[3];
+    float bitangent[3];
+    float uv[2];
+};
+
+struct object_t {
+    float object[16];
+    float normal[16];
+    float uv[9];
+    int mat_index;
+};
+
+layout (std430, binding = 0) restrict readonly buffer vertex_buffer {
+    vertex_t b_vertices[];
+};
+
+layout (std430, binding = 1) restrict readonly buffer object_buffer {
+    object_t b_objects[];
+};
+
+layout (std140, binding = 2) uniform camera {
+    mat4x4 u_mat_projection;
+    mat4x4 u_mat_view;
+    vec4   u_camera_position;
+    vec4   u_clip_planes;
+};
+
+/* Material vertex shaders have to produce bit-identical positions for GL_EQUAL to pass */
+invariant gl_Position;
+
+mat4x4 object_matrix(uint idx) {
+    return mat4x4(
+        b_objects[idx].object[0],  b_objects[idx].object[1],  b_objects[idx].object[2],  b_objects[idx].object[3],
+        b_objects[idx].object[4],  b_objects[idx].object[5],  b_objects[idx].object[6],  b_objects[idx].object[7],
+        b_objects[idx].object[8],  b_objects[idx].object[9],  b_objects[idx].object[10], b_objects[idx].object[11],
+        b_objects[idx].object[12], b_objects[idx].object[13], b_objects[idx].object[14], b_objects[idx].object[15]
+    );
+}
+
+vec3 vertex(uint idx) {
+    return vec3(
+        b_vertices[idx].pos[0],
+        b_vertices[idx].pos[1],
+        b_vertices[idx].pos[2]
+    );
+}
+
+void main() {
+
+    mat4x4 object = object_matrix(gl_BaseInstance + gl_InstanceID);
+    gl_Position = u_mat_projection * u_mat_view * object * vec4(vertex(gl_VertexID), 1.0);
+}
@@ -3,6 +3,7 @@
 /// @author geffevil
 ///
 #pragma once
+#include <cstddef>
 
 namespace assets {
 
@@ -11,9 +12,19 @@ namespace assets {
     /// To qualify as asset, class must publicly derive from this class
     /// Class must also provide constructor which takes one parameter, @c{const string& path}
     /// The above conditions must be met to be able to load the asset using @c assets::loader::load
+    ///
+    /// Assets may split the construction for @c assets::loader::load_async - a nested @c prepared type, a static
+    /// @c prepare(const string& path) returning it, and a constructor taking the path and @c prepared&&. Preparation
+    /// reads the file on a loader's thread and must not touch OpenGL, the constructor finishes on the owning thread
     class asset {
         public:
             /// @brief Default destructor for class - assuring proper construction/destruction 
             virtual ~asset() = default;
+
+            /// @brief Memory the asset holds in the system memory in bytes, weighed against the loader's budget once released
+            virtual size_t cpu_size() const { return 0; }
+
+            /// @brief Memory the asset holds on the GPU in bytes, weighed against the loader's budget once released
+            virtual size_t gpu_size() const { return 0; }
     };
 }
\ No newline at end of file
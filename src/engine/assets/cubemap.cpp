@@ -4,18 +4,25 @@
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include "image_decoder.hpp"
 #include "../utils/project_settings.hpp"
 #include "../utils/resource.hpp"
-#include "../../lib/stb/stb_image.h"
+#include "../rendering/texture_streamer.hpp"
 
 using namespace std;
 using namespace utils;
 using namespace assets;
 
+/// @brief Number of mipmap levels of a cubemap's faces
+static int mip_levels(int w, int h) {
+    return static_cast<int>(min(5.0f, log2f(static_cast<float>(max(w, h)))));
+}
+
 cubemap::cubemap()
     : m_cubemap_obj(0), m_w(0), m_h(0), m_channels(0) {}
 
-cubemap::cubemap(const std::string& name) {
+cubemap::cubemap(const std::string& name)
+    : m_cubemap_obj(0), m_w(0), m_h(0), m_channels(0) {
     
     /* Load resource of texture infos */
     resource cubemap_descriptor = resource(name);
@@ -24,23 +31,40 @@ cubemap::cubemap(const std::string& name) {
     if (face_filenames.size() < 6)
         throw std::logic_error("Cubemap " + name + " contains less than 6 defined face textures");
 
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_cubemap_obj);    
+    /* All the faces are decoded at once, the first one sizes the cubemap */
+    for (int i = 0; i < 6; i++)
+        image_decoder::prefetch(face_filenames[i], GL_RGBA8);
+
+    try {
+        m_upload_faces(face_filenames);
+    } catch (...) {
+        /* Faces not picked up yet would stay decoded in the image decoder */
+        for (int i = 0; i < 6; i++)
+            image_decoder::discard(face_filenames[i], GL_RGBA8);
+        glDeleteTextures(1, &m_cubemap_obj);
+        throw;
+    }
+}
+
+void cubemap::m_upload_faces(const vector<string>& face_filenames) {
 
-    /* Explicitly load the first texture */
-    uint8_t* first_img_data = stbi_load(face_filenames[0].c_str(), &m_w, &m_h, &m_channels, STBI_rgb_alpha);
-    if (first_img_data == nullptr)
-        throw std::runtime_error("Image " + face_filenames[0] + " not found or corrupted");
+    image_decoder::image first_face = image_decoder::decode(face_filenames[0], GL_RGBA8);
+    m_w = first_face.size.x;
+    m_h = first_face.size.y;
+    m_channels = first_face.channels;
 
     /* Calculate number of mipmap levels */
-    int mip_levels = static_cast<int>(min(5.0f, log2f(static_cast<float>(max(m_w, m_h)))));
+    int levels = mip_levels(m_w, m_h);
 
-    glTextureStorage2D(m_cubemap_obj, mip_levels, GL_RGBA8, m_w, m_h);
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_cubemap_obj);    
+    glTextureStorage2D(m_cubemap_obj, levels, GL_RGBA8, m_w, m_h);
     glTextureSubImage3D(
         m_cubemap_obj, 
         0, 0, 0, 0, 
         m_w, m_h, 1, 
-        GL_RGBA, GL_UNSIGNED_BYTE, first_img_data
+        GL_RGBA, GL_UNSIGNED_BYTE, first_face.pixels.data()
     );
+    image_decoder::recycle(std::move(first_face.pixels));
 
     glTextureParameteri(m_cubemap_obj, GL_TEXTURE_MIN_FILTER, project_settings::tex_min_filter());
     glTextureParameteri(m_cubemap_obj, GL_TEXTURE_MAG_FILTER, project_settings::tex_mag_filter());
@@ -48,29 +72,33 @@ cubemap::cubemap(const std::string& name) {
     glTextureParameteri(m_cubemap_obj, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTextureParameteri(m_cubemap_obj, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    /* Load and process sides */
+    /* Upload the sides as they get decoded */
     for (int i = 1; i < 6; i++) {
         
-        int face_w, face_h, face_channels;
-        uint8_t* img_data = stbi_load(face_filenames[i].c_str(), &face_w, &face_h, &face_channels, STBI_rgb_alpha);
-        if (img_data == nullptr)
-            throw std::runtime_error("Image " + face_filenames[i] + " not found or corrupted");
-
-        if (face_w != m_w || face_h != m_h) 
+        image_decoder::image face = image_decoder::decode(face_filenames[i], GL_RGBA8);
+        if (face.size != first_face.size) 
             throw std::logic_error("Image " + face_filenames[i] + " has different size than others");
 
         glTextureSubImage3D(
             m_cubemap_obj, 
             0, 0, 0, i, 
-            face_w, face_h, 1, 
-            GL_RGBA, GL_UNSIGNED_BYTE, img_data
+            face.size.x, face.size.y, 1, 
+            GL_RGBA, GL_UNSIGNED_BYTE, face.pixels.data()
         );
-        stbi_image_free(img_data);
+        image_decoder::recycle(std::move(face.pixels));
     }
 
     glGenerateTextureMipmap(m_cubemap_obj);
 }
 
+size_t cubemap::gpu_size() const {
+
+    if (m_cubemap_obj == 0)
+        return 0;
+
+    return 6 * rendering::texture_streamer::memory_size(GL_RGBA8, glm::ivec2(m_w, m_h), mip_levels(m_w, m_h));
+}
+
 cubemap::~cubemap() {
 
     glDeleteTextures(1, &m_cubemap_obj);
@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace assets {
 
@@ -31,9 +32,16 @@ namespace assets {
             /// @returns Pair of texture's size (in px) and number of channels in the texture file
             inline std::pair<glm::ivec2, int> texture_params() const { return std::make_pair(glm::ivec2(m_w, m_h), m_channels); }
 
+            /// @brief Memory of the six faces and their mip levels on the GPU
+            size_t gpu_size() const override;
+
             /// @brief Getter for the OpenGL texture object
             GLuint cubemap_object () const { return m_cubemap_obj; } 
 
+        private:
+            /// @brief Creates the cubemap object from the prefetched faces, throws if a face is missing or sized differently
+            void m_upload_faces(const std::vector<std::string>& face_filenames);
+
         private:
             GLuint m_cubemap_obj;   ///< OpenGL texture object for the cubemap                   
             int m_w,                ///< Single texture's width
@@ -1,4 +1,5 @@
 #include "displacement.hpp"
+#include "image_decoder.hpp"
 #include "../rendering/renderer.hpp"
 #include <array>
 #include <cmath>
@@ -16,24 +17,63 @@ using namespace utils;
 using namespace assets;
 using namespace rendering;
 
+/// @brief Name under which the heightmap of an image is decoded
+static string heightmap_key(const string& path) {
+    return path + "#grey";
+}
+
+/// @brief Decodes a heightmap, converted to luminance rather than cut down to the red channel as textures are
+static image_decoder::decode_job heightmap_job(const string& path) {
+
+    return [path] {
+        image_decoder::image result;
+        uint8_t* img_data = stbi_load(path.c_str(), &result.size.x, &result.size.y, &result.channels, STBI_grey);
+        if (img_data == nullptr)
+            throw std::runtime_error("Image " + path + " not found or corrupted");
+
+        result.format = GL_R8;
+        result.pixels.assign(img_data, img_data + static_cast<size_t>(result.size.x) * result.size.y);
+        stbi_image_free(img_data);
+        return result;
+    };
+}
+
+void displacement::prefetch(const std::string& path) {
+
+    image_decoder::submit(heightmap_key(path), heightmap_job(path));
+}
+
+void displacement::discard(const std::string& path) {
+
+    image_decoder::drop(heightmap_key(path));
+}
+
 displacement::displacement(const std::string& path)
     : mesh() {
 
-    /* Load the heightmap */
-    m_heightmap = stbi_load(path.c_str(), &m_w, &m_h, nullptr, STBI_grey);
-    if (m_heightmap == nullptr)
-        throw std::runtime_error("Image " + path + " not found or corrupted");
+    /* Load the heightmap, decoded ahead if the load was started in the background */
+    image_decoder::image heightmap = image_decoder::wait(heightmap_key(path), heightmap_job(path));
+
+    m_w = heightmap.size.x;
+    m_h = heightmap.size.y;
+    m_heightmap = std::move(heightmap.pixels);
 
     /* Generate vertices */
     vector<mesh::vertex> vertices;
     vertices.reserve(m_w * m_h);
 
+    float min_height = INFINITY, 
+          max_height = -INFINITY;
+
     for (int z = 0; z < m_h; z++) {
         for (int x = 0; x < m_w; x++) {
 
+            float height = static_cast<float>(m_heightmap[z * m_w  + x]) / DISPLACEMENT_HIEGHT_MODIFIER;
+            min_height = glm::min(min_height, height);
+            max_height = glm::max(max_height, height);
+
             vertices.emplace_back(
-                glm::vec3(static_cast<float>(x), static_cast<float>(m_heightmap[z * m_w  + x]) / DISPLACEMENT_HIEGHT_MODIFIER, 
-                static_cast<float>(z)), glm::vec3(0), glm::vec3(0), glm::vec3(0), glm::vec2( 
+                glm::vec3(static_cast<float>(x), height, static_cast<float>(z)), glm::vec3(0), glm::vec3(0), glm::vec3(0), glm::vec2( 
                     static_cast<float>(x) / static_cast<float>(m_w) * 12.0f,
                     static_cast<float>(z) / static_cast<float>(m_h) * 12.0f 
                 )
@@ -85,7 +125,9 @@ displacement::displacement(const std::string& path)
     auto [vert_handle, vert_offset] = renderer::instance()->vertex_allocator().alloc_buffer(vertices.size() * sizeof(vertices[0]));
     
     /* Upload vertices to the GPU */
-    renderer::instance()->vertex_allocator().buffer_data(vert_handle, vertices.size() * sizeof(vertices[0]), vertices.data());
+    m_upload = renderer::instance()->uploads().upload_buffer(
+        renderer::instance()->vertex_allocator().buffer(), vert_offset, vertices.data(), vertices.size() * sizeof(vertices[0])
+    );
     m_vert_handle = vert_handle;
     m_first_vertex = vert_offset / sizeof(vertices[0]);
 
@@ -93,17 +135,22 @@ displacement::displacement(const std::string& path)
     auto [elem_handle, elem_offset] = renderer::instance()->element_allocator().alloc_buffer(indices.size() * sizeof(indices[0]));
             
     /* Upload indices to the GPU */
-    renderer::instance()->element_allocator().buffer_data(elem_handle, indices.size() * sizeof(indices[0]), indices.data());
+    m_upload = renderer::instance()->uploads().upload_buffer(
+        renderer::instance()->element_allocator().buffer(), elem_offset, indices.data(), indices.size() * sizeof(indices[0])
+    );
     m_elem_handle = elem_handle;
     m_first_index = elem_offset / sizeof(indices[0]);   
     m_element_count = indices.size();
-}
 
-displacement::~displacement() {
-     
-   stbi_image_free(m_heightmap);
+    /* Bounds of the terrain are known from the heightmap itself */
+    m_set_bounds(
+        glm::vec3(0, min_height, 0), 
+        glm::vec3(static_cast<float>(m_w - 1), max_height, static_cast<float>(m_h - 1))
+    );
 }
 
+displacement::~displacement() {}
+
 float displacement::height_at(const glm::vec2& pos) const {
 
     /* Get points to sample at pos - wrap around if out of terrain */
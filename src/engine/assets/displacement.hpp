@@ -8,6 +8,7 @@
 #include "asset.hpp"
 #include <glm/ext/vector_float3.hpp>
 #include <string>
+#include <vector>
 
 namespace assets {
     
@@ -22,13 +23,27 @@ namespace assets {
             /// @param path Filesystem path to the asset
             /// @see assets::asset
             displacement(const std::string& path); 
+
+            /// @brief Queues decoding of the heightmap on the @c image_decoder, the constructor picks it up
+            /// @param path Filesystem path to the asset
+            static void prefetch(const std::string& path);
+
+            /// @brief Drops the prefetch of a heightmap whose load was abandoned
+            /// @param path Filesystem path to the asset
+            static void discard(const std::string& path);
             
             
             /// @brief Destructor
             /// 
-            /// Destroys stored heightmap and calls underlying @c rendering::mesh destructor
+            /// Calls underlying @c rendering::mesh destructor
             ~displacement() override;        
 
+            /// @brief Memory of the heightmap, kept for height queries
+            inline size_t cpu_size() const override { return m_heightmap.size(); }
+
+            /// @brief Memory of the vertices and indices on the GPU
+            inline size_t gpu_size() const override { return m_geometry_size(); }
+
             /// @brief Retrieves height at position
             ///
             /// Retrieves height at position given by @c pos - linearly interpolates when neceseary
@@ -47,8 +62,8 @@ namespace assets {
             float height_at(const glm::vec3& pos) const;
 
         private:
-            int m_w,                ///< Width of the underyling heightmap
-                m_h;                ///< Height of the underlying heightmap  
-            uint8_t* m_heightmap;   ///< Heightmap data
+            int m_w,                            ///< Width of the underyling heightmap
+                m_h;                            ///< Height of the underlying heightmap  
+            std::vector<uint8_t> m_heightmap;   ///< Heightmap data
     };
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "image_decoder.hpp"
+#include <algorithm>
+#include "texture.hpp"
+#include "../utils/cpu_profiler.hpp"
+
+using namespace std;
+using namespace assets;
+
+/// @brief Name under which the texels of an image are decoded
+static string texel_key(const string& path, GLenum format) {
+    return path + "#" + to_string(format);
+}
+
+/// @brief Decodes an image into texels
+static image_decoder::decode_job texel_job(const string& path, GLenum format) {
+
+    return [path, format] {
+        image_decoder::image result;
+        result.format = format;
+        result.pixels = texture::decode(path, result.format, result.size, result.channels);
+        return result;
+    };
+}
+
+image_decoder::image_decoder(size_t threads)
+    : m_stop(false), m_staging_bytes(0) {
+
+    if (threads == 0)
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+
+    s_instance = this;
+    for (size_t i = 0; i < threads; i++)
+        m_workers.emplace_back(&image_decoder::m_worker_loop, this);
+}
+
+image_decoder::~image_decoder() {
+
+    {
+        lock_guard<mutex> lock(m_queue_mutex);
+        m_stop = true;
+    }
+    m_queue_signal.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+
+    s_instance = nullptr;
+}
+
+void image_decoder::prefetch(const string& path, GLenum format) {
+
+    submit(texel_key(path, format), texel_job(path, format));
+}
+
+void image_decoder::discard(const string& path, GLenum format) {
+
+    drop(texel_key(path, format));
+}
+
+image_decoder::image image_decoder::decode(const string& path, GLenum format) {
+
+    return wait(texel_key(path, format), texel_job(path, format));
+}
+
+void image_decoder::submit(const string& key, decode_job job) {
+
+    /* Nobody to hand the work to, it is done once waited for */
+    if (s_instance == nullptr)
+        return;
+
+    {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        if (s_instance->m_results.find(key) != s_instance->m_results.end())
+            return;
+
+        packaged_task<image()> task(std::move(job));
+        s_instance->m_results.emplace(key, task.get_future());
+        s_instance->m_jobs.push_back(pending_job{ key, std::move(task) });
+    }
+    s_instance->m_queue_signal.notify_one();
+}
+
+image_decoder::image image_decoder::wait(const string& key, decode_job job) {
+
+    PROFILE_ZONE("image_decoder::wait");
+    if (s_instance == nullptr)
+        return job();
+
+    future<image> result;
+    packaged_task<image()> task;
+    {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        auto found = s_instance->m_results.find(key);
+        if (found == s_instance->m_results.end())
+            task = packaged_task<image()>(std::move(job));
+        else {
+            result = std::move(found->second);
+            s_instance->m_results.erase(found);
+
+            /* Decodes still queued are taken over rather than waited for behind the others */
+            auto& jobs = s_instance->m_jobs;
+            auto queued = std::find_if(jobs.begin(), jobs.end(), [&key](const pending_job& pending) { return pending.key == key; });
+            if (queued != jobs.end()) {
+                task = std::move(queued->task);
+                jobs.erase(queued);
+            }
+        }
+    }
+
+    if (task.valid()) {
+        if (!result.valid())
+            result = task.get_future();
+        task();
+    }
+
+    return result.get();
+}
+
+vector<uint8_t> image_decoder::acquire(size_t bytes) {
+
+    vector<uint8_t> buffer;
+    if (s_instance != nullptr) {
+        lock_guard<mutex> lock(s_instance->m_staging_mutex);
+        auto& staging = s_instance->m_staging;
+
+        /* Smallest buffer the texels fit in */
+        auto best = staging.end();
+        for (auto it = staging.begin(); it != staging.end(); ++it)
+            if (it->capacity() >= bytes && (best == staging.end() || it->capacity() < best->capacity()))
+                best = it;
+
+        if (best != staging.end()) {
+            s_instance->m_staging_bytes -= best->capacity();
+            buffer = std::move(*best);
+            staging.erase(best);
+        }
+    }
+
+    buffer.resize(bytes);
+    return buffer;
+}
+
+void image_decoder::recycle(vector<uint8_t>&& buffer) {
+
+    if (s_instance == nullptr || buffer.capacity() == 0)
+        return;
+
+    lock_guard<mutex> lock(s_instance->m_staging_mutex);
+    if (s_instance->m_staging_bytes + buffer.capacity() > c_max_staging_bytes)
+        return;
+
+    s_instance->m_staging_bytes += buffer.capacity();
+    s_instance->m_staging.push_back(std::move(buffer));
+}
+
+void image_decoder::drop(const string& key) {
+
+    if (s_instance == nullptr)
+        return;
+
+    /* Decodes already running finish into the dropped result, its buffer is freed along with it */
+    lock_guard<mutex> lock(s_instance->m_queue_mutex);
+    s_instance->m_results.erase(key);
+
+    auto& jobs = s_instance->m_jobs;
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&key](const pending_job& pending) { return pending.key == key; }), jobs.end());
+}
+
+void image_decoder::m_worker_loop() {
+
+    while (true) {
+
+        pending_job job;
+        {
+            unique_lock<mutex> lock(m_queue_mutex);
+            m_queue_signal.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        /* Exceptions are stored in the result, rethrown to whoever waits for it */
+        PROFILE_ZONE("image_decoder::decode");
+        job.task();
+    }
+}
@@ -0,0 +1,118 @@
+///
+/// @file image_decoder.hpp
+/// @author geffevil
+///
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../lib/glad/glad.h"
+
+namespace assets {
+
+    /// @brief Pool of threads decoding images ahead of their upload
+    ///
+    /// Assets queue the images they are about to need with @c prefetch and pick the texels up with @c decode, which waits
+    /// for the queued decode or runs it on the calling thread if no worker got to it yet. Queueing several images before
+    /// waiting for the first spreads them over the pool, the thread holding the GL context is left with the uploads only.
+    /// Every prefetch has to be picked up or dropped with @c discard, results are kept until then. Texels are written into staging buffers, which are
+    /// handed back with @c recycle once uploaded. Without an instance all the images are decoded on the calling thread
+    class image_decoder {
+
+        public:
+            static constexpr size_t c_max_staging_bytes = 64 << 20;   ///< Memory kept in recycled staging buffers
+
+            /// @brief Decoded image
+            struct image {
+                glm::ivec2 size;
+                int channels;                   ///< Channels of the image file
+                GLenum format;                  ///< Uncompressed format of the texels
+                std::vector<uint8_t> pixels;    ///< Texels, held in a staging buffer
+            };
+
+            /// @brief Work decoding an image, run on one of the threads
+            using decode_job = std::function<image()>;
+
+        public:
+            /// @brief Constructor, starts the threads
+            /// @param threads Number of decoding threads, 0 for one less than the hardware runs concurrently
+            image_decoder(size_t threads = 0);
+            image_decoder(const image_decoder&) = delete;
+
+            /// @brief Destructor, decodes which were not started yet are abandoned
+            ~image_decoder();
+
+            /// @brief Queues decoding of an image into texels, unless it is queued already
+            /// @param path Filesystem path of the image
+            /// @param format Format of the texels, see @c texture::decode
+            static void prefetch(const std::string& path, GLenum format = 0);
+
+            /// @brief Drops a prefetch which is not going to be picked up, nothing is done if there is none
+            /// @param path Filesystem path of the image
+            /// @param format Format of the texels, as prefetched
+            static void discard(const std::string& path, GLenum format = 0);
+
+            /// @brief Decodes an image into texels, taking over its prefetch if there was one
+            /// @param path Filesystem path of the image
+            /// @param format Format of the texels, see @c texture::decode
+            /// @returns Decoded image, throws if it could not be read
+            static image decode(const std::string& path, GLenum format = 0);
+
+            /// @brief Queues a decode of an image some other way than into texels, unless one of the key is queued already
+            /// @param key Name of the decode, unique to the image and the way it is decoded
+            /// @param job Work decoding the image
+            static void submit(const std::string& key, decode_job job);
+
+            /// @brief Waits for a decode of the key, running @p job on the calling thread if there is none
+            /// @param key Name of the decode, as submitted
+            /// @param job Work decoding the image
+            /// @returns Decoded image, exceptions of the job are rethrown
+            static image wait(const std::string& key, decode_job job);
+
+            /// @brief Drops a submitted decode which is not going to be waited for, nothing is done if there is none
+            /// @param key Name of the decode, as submitted
+            static void drop(const std::string& key);
+
+            /// @brief Hands out a staging buffer of a size, recycled if possible. Safe to call from any thread
+            /// @param bytes Size of the buffer
+            static std::vector<uint8_t> acquire(size_t bytes);
+
+            /// @brief Takes a staging buffer back once its content was uploaded. Safe to call from any thread
+            /// @param buffer Buffer handed out by @c acquire
+            static void recycle(std::vector<uint8_t>&& buffer);
+
+        private:
+            /// @brief Queued decode
+            struct pending_job {
+                std::string key;
+                std::packaged_task<image()> task;
+            };
+
+        private:
+            void m_worker_loop();
+
+        private:
+            inline static image_decoder* s_instance = nullptr;
+
+            std::vector<std::thread> m_workers;                             ///< Decoding threads
+            std::mutex m_queue_mutex;                                       ///< Guards the queue, the results and the stop flag
+            std::condition_variable m_queue_signal;                         ///< Signaled when a decode is queued or the threads should stop
+            std::deque<pending_job> m_jobs;                                 ///< Decodes not started yet
+            std::unordered_map<std::string, std::future<image>> m_results;  ///< Results of the queued decodes, by key
+            bool m_stop;                                                    ///< Signals the threads to finish
+
+            std::mutex m_staging_mutex;                                     ///< Guards the staging buffers
+            std::vector<std::vector<uint8_t>> m_staging;                    ///< Recycled staging buffers
+            size_t m_staging_bytes;                                         ///< Capacity of the recycled buffers
+    };
+}
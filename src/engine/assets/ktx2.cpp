@@ -0,0 +1,207 @@
+#include "ktx2.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace assets;
+
+static constexpr array<uint8_t, 12> c_identifier = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+/// @brief Container header, up to the level index
+struct ktx2_header {
+    uint8_t identifier[12];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t width, height, depth;
+    uint32_t layer_count, face_count, level_count;
+    uint32_t supercompression;
+    uint32_t dfd_offset, dfd_length;
+    uint32_t kvd_offset, kvd_length;
+    uint64_t sgd_offset, sgd_length;
+};
+static_assert(sizeof(ktx2_header) == 80, "KTX2 header has to be tightly packed");
+
+/// @brief Entry of the level index
+struct ktx2_level {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t uncompressed_length;
+};
+
+/// @brief Description of a supported format
+struct format_info {
+    uint32_t vk_format;
+    GLenum gl_format;
+    uint32_t block_bytes;
+    uint8_t color_model;                    ///< Khronos data format color model
+    bool srgb;
+    int channels;                           ///< Channels meaningful to the engine
+    vector<pair<uint16_t, uint8_t>> samples; ///< Bit offset and channel of every 64-bit or 128-bit sample
+};
+
+static const vector<format_info> c_formats = {
+    { ktx2_image::BC1_RGB_UNORM, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, 128, false, 3, {{0, 0}} },
+    { ktx2_image::BC1_RGB_SRGB, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8, 128, true, 3, {{0, 0}} },
+    { ktx2_image::BC1_RGBA_UNORM, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, 128, false, 4, {{0, 1}} },
+    { ktx2_image::BC1_RGBA_SRGB, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8, 128, true, 4, {{0, 1}} },
+    { ktx2_image::BC3_UNORM, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, 130, false, 4, {{0, 15}, {64, 0}} },
+    { ktx2_image::BC3_SRGB, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16, 130, true, 4, {{0, 15}, {64, 0}} },
+    { ktx2_image::BC4_UNORM, GL_COMPRESSED_RED_RGTC1, 8, 131, false, 1, {{0, 0}} },
+    { ktx2_image::BC5_UNORM, GL_COMPRESSED_RG_RGTC2, 16, 132, false, 2, {{0, 0}, {64, 1}} },
+    { ktx2_image::BC7_UNORM, GL_COMPRESSED_RGBA_BPTC_UNORM, 16, 134, false, 4, {{0, 0}} },
+    { ktx2_image::BC7_SRGB, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16, 134, true, 4, {{0, 0}} },
+};
+
+static const format_info* find_vk_format(uint32_t format) {
+
+    auto info = std::find_if(c_formats.begin(), c_formats.end(), [format](const format_info& f) { return f.vk_format == format; });
+    return info == c_formats.end() ? nullptr : &*info;
+}
+
+static const format_info* find_gl_format(GLenum format) {
+
+    auto info = std::find_if(c_formats.begin(), c_formats.end(), [format](const format_info& f) { return f.gl_format == format; });
+    return info == c_formats.end() ? nullptr : &*info;
+}
+
+template <typename Tp>
+static void write_value(vector<uint8_t>& out, Tp value) {
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(Tp));
+}
+
+ktx2_image::ktx2_image(vk_format format, const glm::ivec2& size, vector<vector<uint8_t>> levels)
+    : m_format(format), m_size(size), m_level_count(levels.size()), m_first_level(0), m_levels(std::move(levels)) {}
+
+ktx2_image ktx2_image::load(const string& path, GLsizei first_level, uint32_t max_size) {
+
+    ifstream file = ifstream(path, ios::in | ios::binary);
+    if (!file.is_open())
+        throw runtime_error("Unable to open KTX2 file " + path);
+
+    ktx2_header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.identifier, c_identifier.data(), c_identifier.size()) != 0)
+        throw runtime_error("File " + path + " is not a KTX2 container");
+
+    if (find_vk_format(header.vk_format) == nullptr)
+        throw runtime_error("KTX2 file " + path + " uses an unsupported format " + to_string(header.vk_format));
+
+    if (header.depth > 1 || header.layer_count > 1 || header.face_count != 1 || header.supercompression != 0)
+        throw runtime_error("KTX2 file " + path + " is not a plain 2D texture");
+
+    /* Level count of 0 asks the loader to generate the levels, cooked files always carry them */
+    if (header.level_count == 0)
+        throw runtime_error("KTX2 file " + path + " has no mip levels");
+
+    vector<ktx2_level> index(header.level_count);
+    if (!file.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(ktx2_level)))
+        throw runtime_error("KTX2 file " + path + " is truncated");
+
+    ktx2_image image;
+    image.m_format = static_cast<vk_format>(header.vk_format);
+    image.m_size = glm::ivec2(header.width, header.height);
+    image.m_level_count = header.level_count;
+    while (max_size != 0 && first_level < image.m_level_count - 1 && std::max(header.width >> first_level, header.height >> first_level) > max_size)
+        first_level++;
+    image.m_first_level = std::clamp<GLsizei>(first_level, 0, header.level_count - 1);
+
+    for (GLsizei level = image.m_first_level; level < image.m_level_count; level++) {
+
+        vector<uint8_t> blocks(index[level].length);
+        file.seekg(index[level].offset);
+        if (!file.read(reinterpret_cast<char*>(blocks.data()), blocks.size()))
+            throw runtime_error("KTX2 file " + path + " is truncated");
+
+        image.m_levels.push_back(std::move(blocks));
+    }
+
+    return image;
+}
+
+void ktx2_image::save(const string& path) const {
+
+    const format_info* info = find_vk_format(m_format);
+    if (info == nullptr)
+        throw logic_error("Unable to save an unsupported KTX2 format");
+
+    /* Basic data format descriptor, one sample per 64-bit block plane */
+    vector<uint8_t> dfd;
+    uint32_t block_size = 24 + 16 * info->samples.size();
+    write_value<uint32_t>(dfd, 4 + block_size);
+    write_value<uint32_t>(dfd, 0);                                  /* Khronos vendor, basic descriptor type */
+    write_value<uint32_t>(dfd, 2 | (block_size << 16));             /* Version 1.3, block size */
+    dfd.insert(dfd.end(), { info->color_model, 1, static_cast<uint8_t>(info->srgb ? 2 : 1), 0 });
+    dfd.insert(dfd.end(), { 3, 3, 0, 0 });                          /* 4x4 texel blocks */
+    dfd.insert(dfd.end(), { static_cast<uint8_t>(info->block_bytes), 0, 0, 0, 0, 0, 0, 0 });
+
+    uint16_t sample_bits = info->block_bytes * 8 / info->samples.size();
+    for (auto [offset, channel] : info->samples) {
+        write_value<uint16_t>(dfd, offset);
+        dfd.insert(dfd.end(), { static_cast<uint8_t>(sample_bits - 1), channel, 0, 0, 0, 0 });
+        write_value<uint32_t>(dfd, 0);
+        write_value<uint32_t>(dfd, UINT32_MAX);
+    }
+
+    /* Levels are stored coarsest first, each aligned to its blocks */
+    uint32_t dfd_offset = sizeof(ktx2_header) + m_levels.size() * sizeof(ktx2_level);
+    uint64_t offset = dfd_offset + dfd.size();
+    vector<ktx2_level> index(m_levels.size());
+    for (size_t level = m_levels.size(); level-- > 0;) {
+        offset = (offset + info->block_bytes - 1) / info->block_bytes * info->block_bytes;
+        index[level] = ktx2_level{ offset, m_levels[level].size(), m_levels[level].size() };
+        offset += m_levels[level].size();
+    }
+
+    ktx2_header header = {};
+    memcpy(header.identifier, c_identifier.data(), c_identifier.size());
+    header.vk_format = m_format;
+    header.type_size = 1;
+    header.width = m_size.x;
+    header.height = m_size.y;
+    header.face_count = 1;
+    header.level_count = m_levels.size();
+    header.dfd_offset = dfd_offset;
+    header.dfd_length = dfd.size();
+
+    ofstream file = ofstream(path, ios::out | ios::binary | ios::trunc);
+    if (!file.is_open())
+        throw runtime_error("Unable to write KTX2 file " + path);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ktx2_level));
+    file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size());
+
+    for (size_t level = m_levels.size(); level-- > 0;) {
+        static const char padding[16] = {};
+        file.write(padding, index[level].offset - static_cast<uint64_t>(file.tellp()));
+        file.write(reinterpret_cast<const char*>(m_levels[level].data()), m_levels[level].size());
+    }
+
+    if (!file)
+        throw runtime_error("Unable to write KTX2 file " + path);
+}
+
+GLenum ktx2_image::gl_format(uint32_t format) {
+
+    const format_info* info = find_vk_format(format);
+    return info == nullptr ? 0 : info->gl_format;
+}
+
+int ktx2_image::channels(GLenum gl_format) {
+
+    const format_info* info = find_gl_format(gl_format);
+    return info == nullptr ? 4 : info->channels;
+}
+
+size_t ktx2_image::level_bytes(GLenum gl_format, const glm::ivec2& size) {
+
+    const format_info* info = find_gl_format(gl_format);
+    if (info == nullptr)
+        return static_cast<size_t>(size.x) * size.y * 4;
+
+    return static_cast<size_t>((size.x + 3) / 4) * ((size.y + 3) / 4) * info->block_bytes;
+}
@@ -0,0 +1,95 @@
+///
+/// @file ktx2.hpp
+/// @author geffevil
+///
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../lib/glad/glad.h"
+
+/* S3TC is an extension the loader was not generated with */
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+    #define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+    #define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+    #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+    #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+    #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace assets {
+
+    /// @brief Block-compressed 2D texture stored in a KTX2 container
+    ///
+    /// Only the subset written by the texture cooker is supported: a single 2D image of a BC format,
+    /// with precomputed mip levels and no supercompression. Levels are kept finest first
+    class ktx2_image {
+
+        public:
+            /// @brief Vulkan formats of the supported block compressions, as stored in the container
+            enum vk_format : uint32_t {
+                BC1_RGB_UNORM = 131,
+                BC1_RGB_SRGB = 132,
+                BC1_RGBA_UNORM = 133,
+                BC1_RGBA_SRGB = 134,
+                BC3_UNORM = 137,
+                BC3_SRGB = 138,
+                BC4_UNORM = 139,
+                BC5_UNORM = 141,
+                BC7_UNORM = 145,
+                BC7_SRGB = 146,
+            };
+
+        public:
+            /// @brief Constructor of an image to be saved
+            /// @param format Format of the blocks
+            /// @param size Size of the first level
+            /// @param levels Blocks of every level, finest first
+            ktx2_image(vk_format format, const glm::ivec2& size, std::vector<std::vector<uint8_t>> levels);
+
+            /// @brief Reads a KTX2 file, throws if it is not supported
+            /// @param path Filesystem path of the file
+            /// @param first_level Finest level to be read, coarser ones are always read
+            /// @param max_size Largest size of the levels to be read, 0 for any. The coarsest level is read regardless
+            static ktx2_image load(const std::string& path, GLsizei first_level = 0, uint32_t max_size = 0);
+
+            /// @brief Writes the image to a KTX2 file
+            /// @param path Filesystem path of the file
+            void save(const std::string& path) const;
+
+            /// @brief OpenGL internal format of a Vulkan format, 0 if unsupported
+            static GLenum gl_format(uint32_t format);
+
+            /// @brief Number of color channels meaningful in an OpenGL compressed format
+            static int channels(GLenum gl_format);
+
+            /// @brief Size of a level's blocks in bytes
+            /// @param gl_format OpenGL internal format, @c GL_RGBA8 counts 4 bytes per texel
+            /// @param size Size of the level
+            static size_t level_bytes(GLenum gl_format, const glm::ivec2& size);
+
+            inline vk_format format() const { return m_format; }
+            inline GLenum gl_format() const { return gl_format(m_format); }
+            inline const glm::ivec2& size() const { return m_size; }
+            inline GLsizei level_count() const { return m_level_count; }
+            inline GLsizei first_level() const { return m_first_level; }
+            inline const std::vector<std::vector<uint8_t>>& levels() const { return m_levels; }
+
+        private:
+            ktx2_image() = default;
+
+        private:
+            vk_format m_format;                         ///< Format of the blocks
+            glm::ivec2 m_size;                          ///< Size of level 0
+            GLsizei m_level_count;                      ///< Number of levels in the container
+            GLsizei m_first_level;                      ///< Finest level read
+            std::vector<std::vector<uint8_t>> m_levels; ///< Blocks of the levels read, finest first
+    };
+}
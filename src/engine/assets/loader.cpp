@@ -0,0 +1,388 @@
+#include "loader.hpp"
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+using namespace assets;
+
+void loader::start(size_t threads) {
+
+    if (s_instance == nullptr)
+        throw logic_error("Attempting to access an uninitialized cache!");
+
+    if (!s_instance->m_workers.empty())
+        return;
+
+    s_instance->m_stop = false;
+    for (size_t i = 0; i < threads; i++)
+        s_instance->m_workers.emplace_back(&loader::m_worker_loop, s_instance);
+}
+
+void loader::stop() {
+
+    if (s_instance == nullptr || s_instance->m_workers.empty())
+        return;
+
+    deque<shared_ptr<pending_load>> abandoned;
+    {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        s_instance->m_stop = true;
+        abandoned.swap(s_instance->m_jobs);
+    }
+    s_instance->m_queue_signal.notify_all();
+
+    for (auto& worker : s_instance->m_workers)
+        worker.join();
+    s_instance->m_workers.clear();
+
+    /* Nobody is left to read their files, whoever waits for them gets the failure */
+    for (auto& load : abandoned) {
+        load->prepare = [] { throw runtime_error("Loading was stopped"); };
+        if (load->discard)
+            load->discard();
+        m_prepare(load);
+    }
+}
+
+void loader::poll() {
+
+    if (s_instance == nullptr)
+        return;
+
+    PROFILE_ZONE("loader::poll");
+    vector<shared_ptr<pending_load>> prepared;
+    {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        prepared.swap(s_instance->m_prepared);
+    }
+
+    for (auto& load : prepared)
+        m_finish(load);
+
+    /* Assets are destroyed outside of the lock, they may release others */
+    vector<shared_ptr<asset>> evicted;
+    {
+        lock_guard<mutex> lock(s_instance->m_pool_mutex);
+        evicted.swap(s_instance->m_evicted);
+    }
+}
+
+void loader::budget(size_t bytes) {
+
+    if (s_instance == nullptr)
+        return;
+
+    /* Assets are destroyed outside of the lock, the others they release are evicted in turn */
+    while (true) {
+        vector<shared_ptr<asset>> evicted;
+        {
+            lock_guard<mutex> lock(s_instance->m_pool_mutex);
+            s_instance->m_budget = bytes;
+            s_instance->m_trim(evicted);
+            std::move(s_instance->m_evicted.begin(), s_instance->m_evicted.end(), std::back_inserter(evicted));
+            s_instance->m_evicted.clear();
+        }
+
+        if (evicted.empty())
+            return;
+    }
+}
+
+loader::cache_stats loader::stats() {
+
+    if (s_instance == nullptr)
+        return cache_stats{ 0, 0, 0, 0, 0 };
+
+    lock_guard<mutex> lock(s_instance->m_pool_mutex);
+    return cache_stats{ s_instance->m_hits, s_instance->m_misses, s_instance->m_evictions, s_instance->m_pool.size(), s_instance->m_pool_bytes };
+}
+
+bool loader::cached(const string& path, const string& variant) {
+
+    if (s_instance == nullptr)
+        return false;
+
+    string key = variant.empty() ? path : path + "#" + variant;
+    {
+        cache_shard& shard = s_instance->m_shard(key);
+        lock_guard<mutex> lock(shard.mutex);
+        auto found = shard.assets.find(key);
+        if (found != shard.assets.end() && !found->second.expired())
+            return true;
+    }
+
+    lock_guard<mutex> lock(s_instance->m_pool_mutex);
+    return s_instance->m_pool_index.find(key) != s_instance->m_pool_index.end();
+}
+
+void loader::invalidate() {
+
+    if (s_instance == nullptr)
+        return;
+
+    /* Assets are destroyed outside of the lock, they may release others */
+    vector<shared_ptr<asset>> released;
+    {
+        lock_guard<mutex> lock(s_instance->m_keepalive_mutex);
+        released.swap(s_instance->m_keepalive_list);
+    }
+}
+
+shared_ptr<asset> loader::m_lookup(cache_shard& shard, const string& key) {
+
+    auto& cached = shard.assets[key];
+    if (auto object = cached.lock())
+        return object;
+
+    shared_ptr<asset> object;
+    {
+        lock_guard<mutex> lock(s_instance->m_pool_mutex);
+        auto found = s_instance->m_pool_index.find(key);
+        if (found == s_instance->m_pool_index.end())
+            return nullptr;
+
+        /* Released asset is taken back out of the pool, shared anew */
+        object = std::move(found->second->object);
+        s_instance->m_pool_bytes -= found->second->bytes;
+        s_instance->m_pool.erase(found->second);
+        s_instance->m_pool_index.erase(found);
+    }
+
+    object = m_share(key, std::move(object));
+    cached = object;
+    return object;
+}
+
+shared_ptr<asset> loader::m_share(const string& key, shared_ptr<asset> object) {
+
+    /* Users share an alias of the asset, once the last of them is gone the asset itself goes to the pool */
+    asset* pointer = object.get();
+    return shared_ptr<asset>(pointer, [key, object = std::move(object)](asset*) mutable {
+        m_release(key, std::move(object));
+    });
+}
+
+void loader::m_release(const string& key, shared_ptr<asset> object) {
+
+    /* Without a loader the asset is destroyed along with the last reference, as it would be uncached */
+    if (s_instance == nullptr)
+        return;
+
+    size_t bytes = std::max(object->cpu_size() + object->gpu_size(), c_min_pooled_bytes);
+
+    /* Last user may be on any thread, the render thread included. Assets free their memory through the simulation,
+       dropped ones are destroyed by the next poll */
+    lock_guard<mutex> lock(s_instance->m_pool_mutex);
+
+    /* Assets over the whole budget are not kept, nor a second instance of a pooled one loaded meanwhile */
+    if (s_instance->m_budget == 0 || bytes > s_instance->m_budget || s_instance->m_pool_index.find(key) != s_instance->m_pool_index.end()) {
+        s_instance->m_evicted.push_back(std::move(object));
+    } else {
+        s_instance->m_pool.push_front(pooled_asset{ key, std::move(object), bytes });
+        s_instance->m_pool_index[key] = s_instance->m_pool.begin();
+        s_instance->m_pool_bytes += bytes;
+        s_instance->m_trim(s_instance->m_evicted);
+    }
+}
+
+void loader::m_trim(vector<shared_ptr<asset>>& evicted) {
+
+    /* Released longest ago go first */
+    while (m_pool_bytes > m_budget && !m_pool.empty()) {
+        pooled_asset& oldest = m_pool.back();
+        m_pool_bytes -= oldest.bytes;
+        m_pool_index.erase(oldest.key);
+        evicted.push_back(std::move(oldest.object));
+        m_pool.pop_back();
+        m_evictions++;
+    }
+}
+
+shared_ptr<asset> loader::m_store(const string& key, caching_policy policy, shared_ptr<asset> object) {
+
+    if (policy == caching_policy::NO_CACHE)
+        return object;
+
+    {
+        /* Another thread may have loaded it meanwhile, its instance is kept */
+        cache_shard& shard = s_instance->m_shard(key);
+        lock_guard<mutex> lock(shard.mutex);
+        if (auto existing = m_lookup(shard, key))
+            object = existing;
+        else
+            shard.assets[key] = object = m_share(key, std::move(object));
+        shard.pending.erase(key);
+    }
+
+    /* Keep object alive even if all of its instances were destroyed */
+    if (policy == caching_policy::KEEPALIVE) {
+        lock_guard<mutex> lock(s_instance->m_keepalive_mutex);
+        s_instance->m_keepalive_list.push_back(object);
+    }
+
+    return object;
+}
+
+void loader::m_queue(const shared_ptr<pending_load>& load) {
+
+    {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        if (!s_instance->m_workers.empty()) {
+            s_instance->m_jobs.push_back(load);
+            s_instance->m_queue_signal.notify_one();
+            return;
+        }
+    }
+
+    /* No threads to hand the work to, the file is read right away */
+    m_prepare(load);
+}
+
+void loader::m_prepare(const shared_ptr<pending_load>& load) {
+
+    {
+        lock_guard<mutex> lock(load->mutex);
+        load->stage = pending_load::load_stage::PREPARING;
+    }
+
+    exception_ptr error;
+    try {
+        PROFILE_ZONE("loader::prepare");
+        load->prepare();
+    } catch (...) {
+        error = current_exception();
+    }
+
+    if (error) {
+        /* Work prefetched for the load may never have been picked up */
+        if (load->discard)
+            load->discard();
+
+        /* Failed loads leave the cache, the next request tries again */
+        if (load->policy != caching_policy::NO_CACHE) {
+            cache_shard& shard = s_instance->m_shard(load->key);
+            lock_guard<mutex> lock(shard.mutex);
+            shard.pending.erase(load->key);
+        }
+
+        std::cerr << "[ERROR] Loading " << load->key << " failed" << std::endl;
+        {
+            lock_guard<mutex> lock(load->mutex);
+            load->error = error;
+            load->stage = pending_load::load_stage::DONE;
+        }
+        load->signal.notify_all();
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(load->mutex);
+        load->stage = pending_load::load_stage::PREPARED;
+    }
+    {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        s_instance->m_prepared.push_back(load);
+    }
+    load->signal.notify_all();
+}
+
+void loader::m_finish(const shared_ptr<pending_load>& load) {
+
+    {
+        /* Finished by a wait already, or failed */
+        lock_guard<mutex> lock(load->mutex);
+        if (load->stage != pending_load::load_stage::PREPARED)
+            return;
+        load->stage = pending_load::load_stage::FINISHING;
+    }
+
+    shared_ptr<asset> result;
+    exception_ptr error;
+    try {
+        PROFILE_ZONE("loader::finish");
+        result = m_store(load->key, load->policy, load->finish());
+    } catch (...) {
+        error = current_exception();
+        std::cerr << "[ERROR] Loading " << load->key << " failed" << std::endl;
+
+        if (load->policy != caching_policy::NO_CACHE) {
+            cache_shard& shard = s_instance->m_shard(load->key);
+            lock_guard<mutex> lock(shard.mutex);
+            shard.pending.erase(load->key);
+        }
+    }
+
+    /* Prepared data is no longer needed, the asset holds what it kept */
+    load->finish = nullptr;
+    load->prepare = nullptr;
+    load->discard = nullptr;
+    {
+        lock_guard<mutex> lock(load->mutex);
+        load->result = result;
+        load->error = error;
+        load->stage = pending_load::load_stage::DONE;
+    }
+    load->signal.notify_all();
+}
+
+shared_ptr<asset> loader::m_wait(const shared_ptr<pending_load>& load) {
+
+    PROFILE_ZONE("loader::wait");
+    if (s_instance != nullptr) {
+
+        /* Loads still queued are taken over rather than waited for behind the others */
+        bool queued = false;
+        {
+            lock_guard<mutex> lock(s_instance->m_queue_mutex);
+            auto& jobs = s_instance->m_jobs;
+            auto found = std::find(jobs.begin(), jobs.end(), load);
+            if (found != jobs.end()) {
+                jobs.erase(found);
+                queued = true;
+            }
+        }
+
+        if (queued)
+            m_prepare(load);
+    }
+
+    {
+        unique_lock<mutex> lock(load->mutex);
+        load->signal.wait(lock, [&load] {
+            return load->stage == pending_load::load_stage::PREPARED || load->stage == pending_load::load_stage::DONE;
+        });
+    }
+
+    /* Finished here, poll would otherwise hold on to the asset until the next frame */
+    if (s_instance != nullptr) {
+        lock_guard<mutex> lock(s_instance->m_queue_mutex);
+        auto& prepared = s_instance->m_prepared;
+        prepared.erase(std::remove(prepared.begin(), prepared.end(), load), prepared.end());
+    }
+
+    m_finish(load);
+
+    lock_guard<mutex> lock(load->mutex);
+    if (load->error)
+        rethrow_exception(load->error);
+    return load->result;
+}
+
+void loader::m_worker_loop() {
+
+    while (true) {
+
+        shared_ptr<pending_load> load;
+        {
+            unique_lock<mutex> lock(m_queue_mutex);
+            m_queue_signal.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+                return;
+
+            load = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        m_prepare(load);
+    }
+}
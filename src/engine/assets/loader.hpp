@@ -5,88 +5,367 @@
 #pragma once
 
 #include "asset.hpp"
+#include "../utils/cpu_profiler.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace assets {
 
-    /// @brief Synchronous asset loader with builtin shared/weak pointer cahce
+    /// @brief Asset loader with builtin shared/weak pointer cahce
+    ///
+    /// Assets are loaded either right away by @c load, or in the background by @c load_async. Background loads of assets
+    /// which split their construction (see @c assets::asset) read their files on the loader's threads, the part touching
+    /// OpenGL is finished by @c poll on the owning thread - the simulation's, which holds a context. Assets which do not
+    /// split it are constructed by @c poll as a whole. The cache is split into shards by the hash of the key,
+    /// each with a lock of its own, so it may be queried from any thread.
+    ///
+    /// Cached assets released by their last user are not destroyed right away, they wait in a pool of released assets
+    /// for being loaded again. The pool is bounded by a budget of bytes, as reported by the assets' @c cpu_size and
+    /// @c gpu_size and at least @c c_min_pooled_bytes each, the assets released longest ago are evicted first
     class loader {
         public:
             /// @brief How should assets be cached when loaded
             enum class caching_policy {
                 NO_CACHE,       ///< Do not cache loaded asset, nor use cached instance (if exists)
-                KEEPALIVE,      ///< Keep asset alive (in cache) even after all instances are destroyed
-                DESTROY_UNUSED  ///< Free asset after the last instance is destroyed 
+                KEEPALIVE,      ///< Keep asset alive (in cache) even after all instances are destroyed, outside of the pool's budget
+                DESTROY_UNUSED  ///< Keep the asset in the pool of released assets after the last instance is destroyed, until evicted
+            };
+
+            /// @brief Counters of the cache, since the loader was created
+            struct cache_stats {
+                uint64_t hits;          ///< Loads served by a cached asset, one in the pool or one being loaded
+                uint64_t misses;        ///< Loads which read the asset's file
+                uint64_t evictions;     ///< Released assets destroyed to fit the budget
+                size_t pooled_assets;   ///< Released assets in the pool
+                size_t pooled_bytes;    ///< Memory of the released assets in the pool
+            };
+
+            static constexpr size_t c_shard_count = 16;     ///< Shards of the cache, each locked on its own
+            static constexpr size_t c_min_pooled_bytes = 4096;  ///< Least a pooled asset is charged, so ones reporting no memory age out too
+
+        private:
+            /// @brief Load running in the background, shared by all the requests for the asset
+            struct pending_load {
+                enum class load_stage { QUEUED, PREPARING, PREPARED, FINISHING, DONE } stage;
+                std::string key;                                ///< Name of the asset in the cache
+                caching_policy policy;
+                std::function<void()> prepare;                  ///< CPU part of the load, sets @c finish
+                std::function<std::shared_ptr<asset>()> finish; ///< Constructs the asset on the owning thread
+                std::function<void()> discard;                  ///< Drops the work prefetched for the load, run if it fails to prepare
+                std::shared_ptr<asset> result;                  ///< Loaded asset, once done
+                std::exception_ptr error;                       ///< Failure of either part, rethrown to whoever waits
+                std::mutex mutex;                               ///< Guards the stage, the result and the error
+                std::condition_variable signal;                 ///< Signaled whenever the stage changes
+            };
+
+        public:
+            /// @brief Asset being loaded in the background
+            template<class T>
+                class handle {
+                public:
+                    handle() = default;
+
+                    /// @brief Whether the handle refers to a load
+                    inline bool valid() const { return m_load != nullptr; }
+
+                    /// @brief Whether the asset is loaded or failed to, so @c get does not wait
+                    bool ready() const {
+                        std::lock_guard<std::mutex> lock(m_load->mutex);
+                        return m_load->stage == pending_load::load_stage::DONE;
+                    }
+
+                    /// @brief Waits for the asset, finishing its load right away. Has to be called on the owning thread
+                    /// @returns Shared pointer to the loaded asset, exceptions thrown while loading are rethrown
+                    std::shared_ptr<T> get() const { return std::static_pointer_cast<T>(loader::m_wait(m_load)); }
+
+                private:
+                    friend class loader;
+                    handle(std::shared_ptr<pending_load> load) : m_load(std::move(load)) {}
+
+                    std::shared_ptr<pending_load> m_load;
             };
 
         public:
             loader() { s_instance = this; }
-            ~loader() { s_instance = nullptr; }
+            ~loader() { stop(); s_instance = nullptr; }
+
+            /// @brief Starts the threads preparing background loads
+            /// @param threads Number of the threads, with none the loads are prepared on the requesting thread
+            static void start(size_t threads);
+
+            /// @brief Joins the threads, loads which were not prepared yet fail
+            static void stop();
+
+            /// @brief Sets the memory the released assets may keep, evicting those over it
+            /// @param bytes Budget of the pool in bytes, 0 destroys assets by the next @c poll after they are released
+            static void budget(size_t bytes);
+
+            /// @brief Getter for the counters of the cache. Safe to call from any thread
+            static cache_stats stats();
 
             /// @brief Loads asset and provides asset caching
-            /// 
-            /// Loads asset of type @c T and depending on the caching policy caches appropriately. 
+            ///
+            /// Loads asset of type @c T and depending on the caching policy caches appropriately.
             /// @c T must conform to the asset specification to be able to be loaded this way.
             /// If a cached instance already exists and caching policy permits, the cached instance is used and asset is not loaded.
+            /// An asset being loaded in the background is waited for instead, see @c load_async
             /// @param path Filesystem path to the requested asset
-            /// @param policy How asset cache should behave 
+            /// @param policy How asset cache should behave
             /// @returns Shared pointer to the loaded asset
             ///
             /// @see caching_policy
-            /// @see assets::asset 
+            /// @see assets::asset
             template<class T>
                 static std::shared_ptr<T> load(std::string path, caching_policy policy = caching_policy::DESTROY_UNUSED) {
-                
+                return load_variant<T>(path, "", policy);
+            }
+
+            /// @brief Loads a variant of an asset, constructed with extra arguments
+            ///
+            /// Variants are cached apart from each other and from the plain asset, under the path suffixed by @c #variant.
+            /// The name has to tell the arguments apart, instances with the same name are shared no matter the arguments
+            /// @param path Filesystem path to the requested asset
+            /// @param variant Name of the variant, empty for the plain asset
+            /// @param policy How asset cache should behave
+            /// @param args Arguments passed to the constructor of @c T after the path
+            /// @returns Shared pointer to the loaded asset
+            ///
+            /// @see load
+            template<class T, typename... Args>
+                static std::shared_ptr<T> load_variant(std::string path, const std::string& variant, caching_policy policy, Args&&... args) {
+
                 /* Compile-time type checking */
                 static_assert(std::is_base_of<asset, T>::value, "");
+                PROFILE_ZONE("loader::load");
 
                 /* Run-time sanity checking */
                 if (s_instance == nullptr)
                     throw std::logic_error("Attempting to access an uninitialized cache!");
 
+                std::string key = variant.empty() ? path : path + "#" + variant;
+
                 /* Completly bypass cache, usefull mainly for debugging shaders */
                 if (policy == caching_policy::NO_CACHE) {
-                    std::cerr << "[INFO] Loading " << path << " - cache bypassed" << std::endl;
-                    return std::make_shared<T>(path);
+                    std::cerr << "[INFO] Loading " << key << " - cache bypassed" << std::endl;
+                    return std::make_shared<T>(path, std::forward<Args>(args)...);
                 }
 
-                auto object = s_instance->m_cache[path].lock();
-                if (!object) {
-
-                    std::cerr << "[INFO] Loading " << path << " - cache miss, loading from file" << std::endl;
-                    
-                    /* Loading it for a first time */
-                    std::shared_ptr<T> ptr = std::make_shared<T>(path);
-                    if (policy == caching_policy::KEEPALIVE)
-                        s_instance->m_keepalive_list.push_back(std::dynamic_pointer_cast<asset>(ptr)); /* Keep object alive even if all of its instances were destroyed */
-                    
-                    s_instance->m_cache[path] = std::static_pointer_cast<asset>(ptr);
-                    return ptr;
+                std::shared_ptr<pending_load> pending;
+                {
+                    cache_shard& shard = s_instance->m_shard(key);
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    if (auto object = m_lookup(shard, key)) {
+                        s_instance->m_hits++;
+                        return std::static_pointer_cast<T>(object);
+                    }
+
+                    auto found = shard.pending.find(key);
+                    if (found != shard.pending.end())
+                        pending = found->second;
                 }
 
-                return std::static_pointer_cast<T>(object);
+                /* Already being loaded in the background, finished right away */
+                if (pending) {
+                    s_instance->m_hits++;
+                    return std::static_pointer_cast<T>(m_wait(pending));
+                }
+
+                s_instance->m_misses++;
+                std::cerr << "[INFO] Loading " << key << " - cache miss, loading from file" << std::endl;
+
+                /* Loading it for a first time */
+                std::shared_ptr<T> ptr = std::make_shared<T>(path, std::forward<Args>(args)...);
+                return std::static_pointer_cast<T>(m_store(key, policy, ptr));
+            }
+
+            /// @brief Loads an asset in the background
+            ///
+            /// Requests for an asset already being loaded share its load, cached instances are handed out right away.
+            /// The load is finished by @c poll, or by the first @c handle::get on the owning thread
+            /// @param path Filesystem path to the requested asset
+            /// @param policy How asset cache should behave
+            /// @returns Handle of the load
+            ///
+            /// @see load
+            template<class T>
+                static handle<T> load_async(std::string path, caching_policy policy = caching_policy::DESTROY_UNUSED) {
+                return load_async_variant<T>(path, "", policy);
             }
 
+            /// @brief Loads a variant of an asset in the background, see @c load_variant and @c load_async
+            /// @param path Filesystem path to the requested asset
+            /// @param variant Name of the variant, empty for the plain asset
+            /// @param policy How asset cache should behave
+            /// @param args Arguments passed to @c T::prepare, or the constructor of @c T if it has none, after the path
+            /// @returns Handle of the load
+            template<class T, typename... Args>
+                static handle<T> load_async_variant(std::string path, const std::string& variant, caching_policy policy, Args&&... args) {
+
+                static_assert(std::is_base_of<asset, T>::value, "");
+                PROFILE_ZONE("loader::load_async");
+
+                if (s_instance == nullptr)
+                    throw std::logic_error("Attempting to access an uninitialized cache!");
+
+                auto load = std::make_shared<pending_load>();
+                load->stage = pending_load::load_stage::QUEUED;
+                load->key = variant.empty() ? path : path + "#" + variant;
+                load->policy = policy;
+
+                /* Cached instances and loads in progress are shared, unless bypassed */
+                if (policy != caching_policy::NO_CACHE) {
+                    cache_shard& shard = s_instance->m_shard(load->key);
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    if (auto object = m_lookup(shard, load->key)) {
+                        s_instance->m_hits++;
+                        load->stage = pending_load::load_stage::DONE;
+                        load->result = object;
+                        return handle<T>(load);
+                    }
+
+                    auto found = shard.pending.find(load->key);
+                    if (found != shard.pending.end()) {
+                        s_instance->m_hits++;
+                        return handle<T>(found->second);
+                    }
+
+                    s_instance->m_misses++;
+                    shard.pending.emplace(load->key, load);
+                }
+
+                std::cerr << "[INFO] Loading " << load->key << " - loading in the background" << std::endl;
+                auto arguments = std::make_tuple(std::decay_t<Args>(std::forward<Args>(args))...);
+
+                /* Only the request creating the load prefetches, the load's prepare picks the work up */
+                if constexpr (is_prefetched<T>::value) {
+                    std::apply([&path](const auto&... arg) { T::prefetch(path, arg...); }, arguments);
+                    load->discard = [path, arguments] { std::apply([&path](const auto&... arg) { T::discard(path, arg...); }, arguments); };
+                }
+
+                load->prepare = m_prepare_job<T>(load.get(), path, std::move(arguments));
+                m_queue(load);
+                return handle<T>(load);
+            }
+
+            /// @brief Finishes the background loads whose files were read and destroys the evicted assets, called by the owning thread once a frame
+            static void poll();
+
+            /// @brief Whether an instance of an asset is alive in the cache or waits in the pool, so loading it would not touch the file
+            /// @param path Filesystem path to the asset
+            /// @param variant Name of the variant, empty for the plain asset
+            static bool cached(const std::string& path, const std::string& variant = "");
+
             /// @brief Invalidates the keep-alive list
-            /// 
+            ///
             /// Invalidates the keep-alive list, destroying all the stored instances of the assets loaded with @c KEEPALIVE cache policy.
             /// All assets loaded with @c KEEPALIVE policy prior to calling this function will behave as if they were loaded with @c DESTROY_UNUSED policy.
-            /// 
+            ///
             /// @see caching_policy
-            static void invalidate() { 
-                if (s_instance != nullptr)              
-                    s_instance->m_keepalive_list.clear(); 
+            static void invalidate();
+
+        private:
+            /// @brief Part of the cache, guarded by its own lock
+            struct alignas(64) cache_shard {
+                std::mutex mutex;
+                std::unordered_map<std::string, std::weak_ptr<asset>> assets;           ///< Loaded assets
+                std::unordered_map<std::string, std::shared_ptr<pending_load>> pending; ///< Assets being loaded in the background
+            };
+
+            /// @brief Released asset waiting in the pool
+            struct pooled_asset {
+                std::string key;                ///< Name of the asset in the cache
+                std::shared_ptr<asset> object;  ///< The asset itself, not shared with anyone
+                size_t bytes;                   ///< Memory of the asset, as reported when released
+            };
+
+            /// @brief Whether an asset splits its construction into @c T::prepare and a constructor taking @c T::prepared
+            template<class T, class = void>
+                struct is_prepared : std::false_type {};
+            template<class T>
+                struct is_prepared<T, std::void_t<typename T::prepared>> : std::true_type {};
+
+            /// @brief Whether an asset queues work ahead of its load with @c T::prefetch, dropped by @c T::discard
+            template<class T, class = void>
+                struct is_prefetched : std::false_type {};
+            template<class T>
+                struct is_prefetched<T, std::void_t<decltype(&T::prefetch), decltype(&T::discard)>> : std::true_type {};
+
+            /// @brief Builds the CPU part of a background load
+            /// @param load Load the job belongs to, its @c finish is set once the job runs
+            /// @param path Filesystem path to the asset
+            /// @param args Arguments of the load, copied into the job
+            template<class T, typename Tuple>
+                static std::function<void()> m_prepare_job(pending_load* load, const std::string& path, Tuple args) {
+
+                return [load, path, args = std::move(args)] {
+                    if constexpr (is_prepared<T>::value) {
+                        /* Held by a shared pointer, std::function needs a copyable target */
+                        auto data = std::make_shared<typename T::prepared>(
+                            std::apply([&path](const auto&... arg) { return T::prepare(path, arg...); }, args)
+                        );
+                        load->finish = [path, data] { return std::static_pointer_cast<asset>(std::make_shared<T>(path, std::move(*data))); };
+                    } else {
+                        load->finish = [path, args] {
+                            return std::static_pointer_cast<asset>(std::apply([&path](const auto&... arg) { return std::make_shared<T>(path, arg...); }, args));
+                        };
+                    }
+                };
             }
 
+            inline cache_shard& m_shard(const std::string& key) { return m_shards[std::hash<std::string>{}(key) % c_shard_count]; }
+
+            static std::shared_ptr<asset> m_lookup(cache_shard& shard, const std::string& key);
+            static std::shared_ptr<asset> m_share(const std::string& key, std::shared_ptr<asset> object);
+            static void m_release(const std::string& key, std::shared_ptr<asset> object);
+            void m_trim(std::vector<std::shared_ptr<asset>>& evicted);
+            static std::shared_ptr<asset> m_store(const std::string& key, caching_policy policy, std::shared_ptr<asset> object);
+            static void m_queue(const std::shared_ptr<pending_load>& load);
+            static void m_prepare(const std::shared_ptr<pending_load>& load);
+            static void m_finish(const std::shared_ptr<pending_load>& load);
+            static std::shared_ptr<asset> m_wait(const std::shared_ptr<pending_load>& load);
+            void m_worker_loop();
+
         private:
             inline static loader* s_instance = nullptr;
 
-            std::unordered_map<std::string, std::weak_ptr<asset>> m_cache;  ///< Cache itself
+            std::array<cache_shard, c_shard_count> m_shards;                ///< Cache itself
+            std::mutex m_keepalive_mutex;                                   ///< Guards the keep-alive list
             std::vector<std::shared_ptr<asset>> m_keepalive_list;           ///< List to keep alive all the items
+
+            std::mutex m_pool_mutex;                                        ///< Guards the pool and its budget
+            std::list<pooled_asset> m_pool;                                 ///< Released assets, released most recently first
+            std::unordered_map<std::string, std::list<pooled_asset>::iterator> m_pool_index;    ///< Released assets by key
+            size_t m_pool_bytes = 0;                                        ///< Memory of the released assets
+            size_t m_budget = 0;                                            ///< Memory the released assets may keep
+            std::vector<std::shared_ptr<asset>> m_evicted;                  ///< Assets dropped by the pool, destroyed by the owning thread
+
+            std::atomic<uint64_t> m_hits = 0;                               ///< Loads served by the cache
+            std::atomic<uint64_t> m_misses = 0;                             ///< Loads which read the file
+            std::atomic<uint64_t> m_evictions = 0;                          ///< Released assets evicted from the pool
+
+            std::vector<std::thread> m_workers;                             ///< Threads preparing background loads
+            std::mutex m_queue_mutex;                                       ///< Guards the queues and the stop flag
+            std::condition_variable m_queue_signal;                         ///< Signaled when a load is queued or the threads should stop
+            std::deque<std::shared_ptr<pending_load>> m_jobs;               ///< Loads waiting for a thread
+            std::vector<std::shared_ptr<pending_load>> m_prepared;          ///< Loads waiting for @c poll
+            bool m_stop = false;                                            ///< Signals the threads to finish
     };
-}
\ No newline at end of file
+}
@@ -16,8 +16,10 @@ using namespace std;
 using namespace assets;
 using namespace rendering;
 
-model::model(const string& path) 
-    : mesh() {    
+model::model(const string& path)
+    : model(path, prepare(path)) {}
+
+model::prepared model::prepare(const string& path) {
 
     /// @todo [Long-Term]: Down the line, replace with custom loader
     /// @todo [Mid-Term]: Allow parsing of model's own material files
@@ -37,7 +39,8 @@ model::model(const string& path)
     /* Grab the 0th mesh */
     const aiMesh* mesh = scene->mMeshes[0];
 
-    vector<mesh::vertex> vertices;
+    prepared data;
+    vector<mesh::vertex>& vertices = data.vertices;
     vertices.reserve(mesh->mNumVertices);
 
     /* Hopefully -O2 will do it's job */
@@ -50,33 +53,52 @@ model::model(const string& path)
             glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y)
         );
 
-    /* Reserve buffer for the vertices */
-    auto [vert_handle, vert_offset] = renderer::instance()->vertex_allocator().alloc_buffer(vertices.size() * sizeof(vertices[0]));
-    m_element_count = vertices.size();
-
-    /* Upload the data */
-    renderer::instance()->vertex_allocator().buffer_data(vert_handle, vertices.size() * sizeof(vertices[0]), vertices.data());
-    m_vert_handle = vert_handle;
-    m_first_vertex = vert_offset / sizeof(vertices[0]);
-
     if (!mesh->HasFaces())
         throw std::logic_error("Non-indexed meshes not supported yet!");
 
-    m_indexed = true;
-    vector<uint32_t> indices;
+    vector<uint32_t>& indices = data.indices;
     indices.reserve(mesh->mNumFaces * 3); /* A reasonable estimate, since all faces are triangles */
     for (size_t i = 0; i < mesh->mNumFaces; i++) {
         const aiFace face = mesh->mFaces[i];
         for (size_t e = 0; e < face.mNumIndices; e++)         
             indices.emplace_back(face.mIndices[e]);   
     }
+
+    /* Keep the bounding box generated by Assimp */
+    data.bounds_min = vec3(mesh->mAABB.mMin.x, mesh->mAABB.mMin.y, mesh->mAABB.mMin.z);
+    data.bounds_max = vec3(mesh->mAABB.mMax.x, mesh->mAABB.mMax.y, mesh->mAABB.mMax.z);
+    return data;
+}
+
+model::model(const string&, prepared&& data) 
+    : mesh() {
+
+    const vector<mesh::vertex>& vertices = data.vertices;
+    const vector<uint32_t>& indices = data.indices;
+
+    /* Reserve buffer for the vertices */
+    auto [vert_handle, vert_offset] = renderer::instance()->vertex_allocator().alloc_buffer(vertices.size() * sizeof(vertices[0]));
+    m_element_count = vertices.size();
+
+    /* Upload the data */
+    m_upload = renderer::instance()->uploads().upload_buffer(
+        renderer::instance()->vertex_allocator().buffer(), vert_offset, vertices.data(), vertices.size() * sizeof(vertices[0])
+    );
+    m_vert_handle = vert_handle;
+    m_first_vertex = vert_offset / sizeof(vertices[0]);
+
+    m_indexed = true;
     
     /* Reserve buffer for the indices */
     auto [elem_handle, elem_offset] = renderer::instance()->element_allocator().alloc_buffer(indices.size() * sizeof(indices[0]));
     m_element_count = indices.size();
 
     /* Upload the data */
-    renderer::instance()->element_allocator().buffer_data(elem_handle, indices.size() * sizeof(indices[0]), indices.data());
+    m_upload = renderer::instance()->uploads().upload_buffer(
+        renderer::instance()->element_allocator().buffer(), elem_offset, indices.data(), indices.size() * sizeof(indices[0])
+    );
     m_elem_handle = elem_handle;
     m_first_index = elem_offset / sizeof(indices[0]);   
+
+    m_set_bounds(data.bounds_min, data.bounds_max);
 }
@@ -5,6 +5,7 @@
 #pragma once 
 #include "../rendering/mesh.hpp"
 #include <string>
+#include <vector>
 
 namespace assets {
     /// @brief Mesh provider asset, wrapper around a model file
@@ -20,10 +21,31 @@ namespace assets {
             /// @param path Filesystem path to the desired asset
             model(const std::string& path);
 
+            /// @brief Geometry of a model read from its file, not yet on the GPU
+            struct prepared {
+                std::vector<rendering::mesh::vertex> vertices;
+                std::vector<uint32_t> indices;
+                glm::vec3 bounds_min,   ///< Bounding box generated by the importer
+                          bounds_max;
+            };
+
+            /// @brief Reads and pre-processes the model file, the CPU part of loading. Safe to call from any thread
+            /// @param path Filesystem path to the desired asset
+            /// @returns Geometry to be passed to the constructor, throws if the file could not be read
+            static prepared prepare(const std::string& path);
+
+            /// @brief Asset constructor, sets up the model from its prepared geometry, see @c assets::loader::load_async
+            /// @param path Filesystem path to the asset
+            /// @param data Geometry read by @c prepare
+            model(const std::string& path, prepared&& data);
+
             /// @brief Default destructor, just to ensure everything is destroyed properly 
             ///
             /// This destructor is explicitly define just to @b reaaaly @b ensure that the destructor
             /// of the underlying @c rendering::mesh gets called
             ~model() override = default;
+
+            /// @brief Memory of the vertices and indices on the GPU
+            inline size_t gpu_size() const override { return m_geometry_size(); }
     };
 }
@@ -1,10 +1,17 @@
 #include "scene.hpp"
+#include <filesystem>
 #include "../utils/resource.hpp"
 
 using namespace assets;
 
 scene_template::scene_template(const std::string path) 
-    : m_scene_res(utils::resource(path)) {}
+    : m_scene_res(utils::resource(path)), m_file_size(0) {
+
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (!error)
+        m_file_size = size;
+}
 
 
 scene::scene_node* scene_template::instantiate() {
@@ -32,7 +32,10 @@ namespace assets {
             /// @see runtime::root_node
             scene::scene_node* instantiate();
 
+            inline size_t cpu_size() const override { return m_file_size; }
+
         private:
             utils::resource m_scene_res;    ///< Resource containing the scene template
+            size_t m_file_size;             ///< Size of the scene's file, the parsed JSON takes at least as much
     };
 };
\ No newline at end of file
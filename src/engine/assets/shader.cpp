@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <filesystem>
 #include <iterator>
 #include <ostream>
@@ -12,6 +13,7 @@
 
 #include "shader.hpp"
 #include "../utils/buffer.hpp"
+#include "../rendering/texture_array_pool.hpp"
 
 using namespace glm;
 using namespace std;
@@ -19,34 +21,20 @@ using namespace assets;
 
 static const unordered_map<string, GLenum> c_extension_type_map = {
     {".frag", GL_FRAGMENT_SHADER},
-    {".vert", GL_VERTEX_SHADER}
+    {".vert", GL_VERTEX_SHADER},
+    {".comp", GL_COMPUTE_SHADER}
 };
 
 shader_stage::shader_stage(string path)
-    : m_type_bitmask(0) {
+    : m_type_bitmask(0), m_binary_size(0) {
 
-    GLint result = GL_FALSE;
-    GLenum m_type;
-    
     /// @todo [Long-Term]: Shader system overhaul
     
     /* Get type from filename */
     string ext = filesystem::path(path).extension();
-    if (auto it = c_extension_type_map.find(ext); it != c_extension_type_map.cend())
-        m_type = it->second;
-    else throw logic_error("Unknown shader type encountered");
-
-    /* Generate type */
-    switch (m_type) {
-        case GL_FRAGMENT_SHADER:
-            m_type_bitmask |= GL_FRAGMENT_SHADER_BIT;
-            break;
-        case GL_GEOMETRY_SHADER:
-            m_type_bitmask |= GL_GEOMETRY_SHADER_BIT;
-            break;
-        case GL_VERTEX_SHADER:
-            m_type_bitmask |= GL_VERTEX_SHADER_BIT;
-    }
+    auto type = c_extension_type_map.find(ext);
+    if (type == c_extension_type_map.cend())
+        throw logic_error("Unknown shader type encountered");
 
     ifstream shader_file = ifstream(path, ios::in);
 
@@ -62,11 +50,55 @@ shader_stage::shader_stage(string path)
 		throw runtime_error("Unable to read from shader file " + path);
 
     shader_file.close();
-    
+    m_compile(type->second, src_buffer, path);
+}
+
+shader_stage::shader_stage(GLenum type, const string& source, const string& name)
+    : m_type_bitmask(0), m_binary_size(0) {
+
+    m_compile(type, source, name);
+}
+
+shader_stage::~shader_stage() {
+
+    glDeleteProgram(m_program);
+}
+
+GLint shader_stage::uniform_location(const string& uniform_name) const {
+
+    auto location = m_uniform_locations.find(uniform_name);
+    return location == m_uniform_locations.end() ? -1 : location->second;
+}
+
+void shader_stage::m_compile(GLenum m_type, const string& src_buffer, const string& path) {
+
+    GLint result = GL_FALSE;
+
+    /* Generate type */
+    switch (m_type) {
+        case GL_FRAGMENT_SHADER:
+            m_type_bitmask |= GL_FRAGMENT_SHADER_BIT;
+            break;
+        case GL_GEOMETRY_SHADER:
+            m_type_bitmask |= GL_GEOMETRY_SHADER_BIT;
+            break;
+        case GL_VERTEX_SHADER:
+            m_type_bitmask |= GL_VERTEX_SHADER_BIT;
+            break;
+        case GL_COMPUTE_SHADER:
+            m_type_bitmask |= GL_COMPUTE_SHADER_BIT;
+    }
+
 	/* Compile */
 	GLenum shader = glCreateShader(static_cast<GLenum>(m_type));
+
+    /* Texture backend is announced right after the version directive, which has to stay first */
+    string patched_source = src_buffer;
+    size_t line_end = patched_source.find('\n');
+    if (rendering::texture_array_pool::enabled() && patched_source.compare(0, 8, "#version") == 0 && line_end != string::npos)
+        patched_source.insert(line_end + 1, "#define ENGINE_TEXTURE_ARRAYS\n");
 	  
-    const char* source = src_buffer.c_str();
+    const char* source = patched_source.c_str();
 	glShaderSource(shader, 1, &source, nullptr);
     glCompileShader(shader);
 
@@ -115,11 +147,56 @@ shader_stage::shader_stage(string path)
     /* Clean up */
     glDetachShader(m_program, shader);
     glDeleteShader(shader);
+
+    m_cache_uniform_locations();
+    m_cache_storage_bindings();
+
+    GLint binary_size = 0;
+    glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    m_binary_size = binary_size;
 }
 
-shader_stage::~shader_stage() {
+bool shader_stage::declares_storage(GLuint binding) const {
 
-    glDeleteProgram(m_program);
+    return std::find(m_storage_bindings.begin(), m_storage_bindings.end(), binding) != m_storage_bindings.end();
+}
+
+void shader_stage::m_cache_storage_bindings() {
+
+    GLint block_count = 0;
+    glGetProgramInterfaceiv(m_program, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &block_count);
+
+    const GLenum property = GL_BUFFER_BINDING;
+    for (GLint i = 0; i < block_count; i++) {
+        GLint binding = 0;
+        glGetProgramResourceiv(m_program, GL_SHADER_STORAGE_BLOCK, i, 1, &property, 1, nullptr, &binding);
+        m_storage_bindings.push_back(binding);
+    }
+}
+
+void shader_stage::m_cache_uniform_locations() {
+
+    GLint uniform_count = 0, name_length = 0;
+    glGetProgramInterfaceiv(m_program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_count);
+    glGetProgramInterfaceiv(m_program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &name_length);
+
+    utils::buffer<GLchar> name_buffer = utils::buffer<GLchar>(name_length + 1);
+    for (GLint i = 0; i < uniform_count; i++) {
+
+        GLint location;
+        glGetProgramResourceName(m_program, GL_UNIFORM, i, name_length + 1, nullptr, name_buffer);
+        
+        /* Block members have no location, they are set through buffers */
+        if ((location = glGetProgramResourceLocation(m_program, GL_UNIFORM, name_buffer)) < 0)
+            continue;
+
+        /* Arrays are reported as "name[0]", make them reachable by plain name too */
+        string name = string(name_buffer);
+        m_uniform_locations[name] = location;
+        
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            m_uniform_locations[name.substr(0, name.size() - 3)] = location;
+    }
 }
 
 /* Uniform setters - there is a lot of them*/
@@ -8,6 +8,8 @@
 #include "asset.hpp"
 #include <array>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace assets {
     class shader_stage : public asset {
@@ -25,23 +27,45 @@ namespace assets {
             /// @param path Filesystem path of the shader
             shader_stage(const std::string path);
 
+            /// @brief Constructor compiling a shader generated at runtime
+            ///
+            /// @param type OpenGL type of the shader
+            /// @param source GLSL source of the shader
+            /// @param name Name reported in the compilation errors
+            shader_stage(GLenum type, const std::string& source, const std::string& name);
+
             /// @brief Destructor for the shader_stage class
             /// Destroys OpenGL shader objects and cleans used memory
             ~shader_stage();
     
+            /// @brief Sets a uniform value
+            ///
+            /// Locations are looked up in a cache built when the stage is created. Uniforms
+            /// not present in the stage are skipped
+            /// @param uniform_name Name of the uniform
+            /// @param val Value to be set
             template <typename Tp> 
-            void set_uniform(std::string uniform_name, const Tp& val) {
-            
-                GLint location;
+            void set_uniform(const std::string& uniform_name, const Tp& val) {
             
                 /* Get uniform location - if not found, skip*/
-                if ((location  = glGetUniformLocation(m_program, uniform_name.c_str())) < 0)
+                auto location = m_uniform_locations.find(uniform_name);
+                if (location == m_uniform_locations.end())
                     return;
             
-                m_set_uniform_value<Tp>(location, val);
+                m_set_uniform_value<Tp>(location->second, val);
             }
+
+            /// @brief Gets a cached uniform location
+            /// @returns Location of the uniform or -1, if the stage does not contain it
+            GLint uniform_location(const std::string& uniform_name) const;
             
 
+            /// @brief Checks whether the stage declares a shader storage block at a binding point
+            bool declares_storage(GLuint binding) const;
+
+            /// @brief Memory of the linked program, as reported by its binary
+            inline size_t gpu_size() const override { return m_binary_size; }
+
             /// @brief Getter for type bits of the shader
             inline GLbitfield type_bitmask() const { return m_type_bitmask; }
         
@@ -54,8 +78,20 @@ namespace assets {
             template <typename T>
             void m_set_uniform_value(GLint location, const T& val);
 
+            /// @brief Compiles and links the source into a separable program
+            void m_compile(GLenum type, const std::string& source, const std::string& name);
+
+            /// @brief Queries locations of all the active uniforms outside of uniform blocks
+            void m_cache_uniform_locations();
+
+            /// @brief Queries binding points of the active shader storage blocks
+            void m_cache_storage_bindings();
+
         private:
             GLbitfield m_type_bitmask;  ///< Shader type bitmask
             GLuint m_program;           ///< OpenGL shader program object
+            size_t m_binary_size;       ///< Length of the program's binary in bytes
+            std::unordered_map<std::string, GLint> m_uniform_locations;    ///< Locations of the active uniforms
+            std::vector<GLuint> m_storage_bindings;                         ///< Binding points of the active storage blocks
     };
 }
@@ -1,9 +1,17 @@
 #include "texture.hpp"
 #include <GL/gl.h>
 #include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <memory>
 #include <stdexcept>
+#include "image_decoder.hpp"
+#include "ktx2.hpp"
+#include "texture_cooker.hpp"
 #include "../utils/project_settings.hpp"
 #include "../rendering/renderer.hpp"
+#include "../rendering/texture_streamer.hpp"
+#include "../rendering/texture_array_pool.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../lib/stb/stb_image.h"
@@ -13,73 +21,231 @@ using namespace utils;
 using namespace assets;
 
 texture::texture()
-    : m_texture_obj(0), m_texture_index(-1), m_w(0), m_h(0), m_channels(0) {}
+    : m_texture_obj(0), m_format(GL_RGBA8), m_texture_index(-1), m_w(0), m_h(0), m_channels(0), m_top_level(0), m_streamed(false), m_memory_size(0) {}
 
-texture::texture(const std::string name) 
-    : m_texture_index(-1) {
-    
-    uint8_t* img_data = stbi_load(name.c_str(), &m_w, &m_h, &m_channels, STBI_rgb_alpha);
-    if (img_data == NULL)
-        throw std::runtime_error("Image " + name + " not found or corrupted");
-
-    /* Create OpenGL texture object */ 
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_texture_obj);
-
-    glTextureParameteri(m_texture_obj, GL_TEXTURE_MIN_FILTER, project_settings::tex_min_filter());
-    glTextureParameteri(m_texture_obj, GL_TEXTURE_MAG_FILTER, project_settings::tex_mag_filter());
-    glTextureParameteri(m_texture_obj, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(m_texture_obj, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            
-    /* Calculate number of mipmap levels */
-    int mip_levels = static_cast<int>(min(5.0f, log2f(static_cast<float>(max(m_w, m_h)))));
-
-    /* Send image to OpenGL */
-    glTextureStorage2D(m_texture_obj, mip_levels, GL_RGBA8, m_w, m_h);
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glTextureSubImage2D(
-        m_texture_obj, 
-        0, 0, 0, 
-        m_w, m_h, 
-        GL_RGBA, 
-        GL_UNSIGNED_BYTE, img_data
-    );
-
-    /* Create b&w image, not just R */
-    if (m_channels == 1) {
-        GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_RED, GL_RED };
-        glTextureParameteriv(m_texture_obj, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+/// @brief Whether a texture is loaded from its cooked KTX2 file rather than its image
+/// @param path Filesystem path of the image
+/// @param warn Whether to report cooked files which are out of date
+static bool is_cooked(const std::string& path, bool warn) {
+
+    /* Cooked texture next to the image is preferred, unless the image was edited since */
+    std::error_code error;
+    string cooked = texture_cooker::cooked_path(path);
+    if (!filesystem::exists(cooked, error))
+        return false;
+
+    if (!filesystem::exists(path, error) || filesystem::last_write_time(cooked, error) >= filesystem::last_write_time(path, error))
+        return true;
+
+    if (warn)
+        std::cerr << "[WARNING] Cooked texture " << cooked << " is older than its image, loading the image instead" << std::endl;
+    return false;
+}
+
+texture::texture(const std::string name, GLenum format) 
+    : texture(name, prepare(name, format)) {}
+
+texture::texture(const std::string, prepared&& data)
+    : m_path(data.path), m_format(data.format), m_texture_index(-1), m_w(data.size.x), m_h(data.size.y), m_channels(data.channels), m_top_level(data.top_level), m_streamed(data.streamed) {
+
+    glm::ivec2 size(std::max(m_w >> m_top_level, 1), std::max(m_h >> m_top_level, 1));
+    m_memory_size = rendering::texture_streamer::memory_size(m_format, size, data.level_count);
+
+    /* Without bindless textures the levels are kept until use, then copied into a texture array on the renderer's context */
+    if (rendering::texture_array_pool::enabled()) {
+        m_texture_obj = 0;
+        m_texture_handle = 0;
+        m_levels = std::move(data.levels);
+        return;
     }
 
-    glGenerateTextureMipmap(m_texture_obj);
+    /* Create OpenGL texture object, uncompressed levels missing from the prepared ones get generated */
+    m_texture_obj = rendering::texture_streamer::create_texture(m_format, size, data.level_count, m_channels);
+    m_upload = rendering::renderer::instance()->uploads().upload_texture(m_texture_obj, m_format, size, std::move(data.levels));
     m_texture_handle = glGetTextureHandleARB(m_texture_obj);
-    stbi_image_free(img_data);  
+}
+
+texture::prepared texture::prepare(const std::string& path, GLenum format) {
+
+    if (is_cooked(path, true))
+        return m_prepare_cooked(texture_cooker::cooked_path(path));
+
+    return m_prepare_image(path, format);
+}
+
+void texture::prefetch(const std::string& path, GLenum format) {
+
+    if (!is_cooked(path, false))
+        image_decoder::prefetch(path, format);
+}
+
+void texture::discard(const std::string& path, GLenum format) {
+
+    image_decoder::discard(path, format);
+}
+
+GLenum texture::parse_format(const std::string& name) {
+
+    static const vector<pair<string, GLenum>> names = {
+        {"auto", 0}, {"r", GL_R8}, {"rg", GL_RG8}, {"rgb", GL_RGB8}, {"rgba", GL_RGBA8}
+    };
+
+    auto found = std::find_if(names.begin(), names.end(), [&name](const auto& entry) { return entry.first == name; });
+    if (found == names.end())
+        throw invalid_argument("Unknown texture format " + name);
+
+    return found->second;
+}
+
+vector<uint8_t> texture::decode(const std::string& path, GLenum& format, glm::ivec2& size, int& channels) {
+
+    uint8_t* img_data = stbi_load(path.c_str(), &size.x, &size.y, &channels, 0);
+    if (img_data == NULL)
+        throw std::runtime_error("Image " + path + " not found or corrupted");
+
+    if (format == 0) {
+        static constexpr GLenum formats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+        format = formats[std::clamp(channels, 1, 4) - 1];
+    }
+
+    size_t count = static_cast<size_t>(size.x) * size.y;
+    int components = rendering::texture_streamer::components(format);
+    vector<uint8_t> pixels = image_decoder::acquire(count * components);
+    if (channels == components) {
+        std::copy(img_data, img_data + pixels.size(), pixels.begin());
+        stbi_image_free(img_data);
+        return pixels;
+    }
+
+    /* Grey images without a color conversion keep their channels in place, the rest goes through RGBA */
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* in = img_data + i * channels;
+        uint8_t* out = pixels.data() + i * components;
+
+        if (channels <= 2 && components <= 2) {
+            for (int c = 0; c < components; c++)
+                out[c] = c < channels ? in[c] : 255;
+            continue;
+        }
+
+        uint8_t rgba[4] = { in[0], in[0], in[0], 255 };
+        if (channels >= 3)
+            std::copy(in, in + std::min(channels, 3), rgba);
+        if (channels == 2 || channels == 4)
+            rgba[3] = in[channels - 1];
+        std::copy(rgba, rgba + components, out);
+    }
+
+    stbi_image_free(img_data);
+    return pixels;
+}
+
+texture::prepared texture::m_prepare_cooked(const std::string& path) {
+
+    /* Only the mip tail is uploaded if streamed, unless the levels go to a texture array */
+    bool arrays = rendering::texture_array_pool::enabled();
+    uint32_t tail = arrays ? 0 : rendering::renderer::instance()->texture_stream_tail();
+    ktx2_image image = ktx2_image::load(path, 0, tail);
+
+    /* Streaming assumes the whole chain, as the cooker writes it */
+    if (image.level_count() != rendering::texture_streamer::level_count(image.size()))
+        throw std::runtime_error("Cooked texture " + path + " does not carry a full mip chain");
+
+    /* Levels are precomputed, nothing is generated at load */
+    GLenum format = image.gl_format();
+    GLsizei levels = image.levels().size();
+    return prepared{ path, format, ktx2_image::channels(format), image.size(), image.first_level(), levels, image.levels(), tail != 0 };
+}
+
+texture::prepared texture::m_prepare_image(const std::string& path, GLenum format) {
+
+    /* Decoded on the image decoder's threads, possibly prefetched along with other textures */
+    image_decoder::image image = image_decoder::decode(path, format);
+    prepared data{ path, image.format, image.channels, image.size, 0, rendering::texture_streamer::level_count(image.size), {}, false };
+
+    /* Texture arrays get the whole image, their levels are generated on the renderer's context */
+    if (rendering::texture_array_pool::enabled()) {
+        data.levels.push_back(std::move(image.pixels));
+        return data;
+    }
+
+    /* Only the mip tail is uploaded if streamed, finer levels are streamed in once the GPU samples them */
+    uint32_t tail = rendering::renderer::instance()->texture_stream_tail();
+    data.streamed = tail != 0;
+    data.top_level = rendering::texture_streamer::tail_level(image.size, tail);
+    data.level_count -= data.top_level;
+
+    glm::ivec2 tail_size = image.size;
+    int components = rendering::texture_streamer::components(data.format);
+    data.levels.push_back(rendering::texture_streamer::downsample(image.pixels.data(), tail_size, data.top_level, components));
+    image_decoder::recycle(std::move(image.pixels));
+    return data;
 }
  
+size_t texture::cpu_size() const {
+
+    size_t bytes = 0;
+    for (const auto& level : m_levels)
+        bytes += level.size();
+    return bytes;
+}
+
 void texture::use() {
     
     /* Texture is already in use, no need to redo */
     if (m_texture_index >= 0)
         return;
 
-    /* Make texture resindent & pass it to the renderer */
-    glMakeTextureHandleResidentARB(m_texture_handle);
-
+    /* Reserve a slot in the texture pool & calculate index */
     auto [handle, offset] = rendering::renderer::instance()->texture_allocator().alloc_buffer(sizeof(m_texture_handle));
-    rendering::renderer::instance()->texture_allocator().buffer_data(handle, sizeof(m_texture_handle), &m_texture_handle);
-
-    /* Calculate index */
     m_texture_index = offset / sizeof(m_texture_handle);
     m_buffer_handle = handle;
+
+    uint32_t slot = m_texture_index;
+    if (rendering::texture_array_pool::enabled()) {
+        auto levels = std::make_shared<vector<vector<uint8_t>>>(std::move(m_levels));
+        glm::ivec2 size(m_w, m_h);
+        GLenum format = m_format;
+        int channels = m_channels;
+        rendering::renderer::instance()->enqueue_render_task([slot, size, format, channels, levels] {
+            rendering::renderer::instance()->texture_arrays().add(slot, size, format, channels, std::move(*levels));
+        });
+        return;
+    }
+
+    /* Renderer makes the texture resident once it gets drawn and its levels are uploaded, until then the slot holds a fallback.
+       Streamer takes over the texture object, it gets replaced whenever mip levels are streamed in or out */
+    size_t memory_size = m_memory_size;
+    rendering::texture_streamer::stream_source source{ m_path, glm::ivec2(m_w, m_h), m_channels, m_format, m_texture_obj, m_texture_handle, m_top_level, m_streamed };
+    rendering::renderer::instance()->uploads().when_ready(m_upload, [slot, source, memory_size] {
+        rendering::renderer::instance()->enqueue_render_task([slot, source, memory_size] {
+            rendering::renderer::instance()->residency().track(slot, source.handle, memory_size);
+            rendering::renderer::instance()->streamer().track(slot, source);
+        });
+    });
 }
 
 texture::~texture() {
      
-    /* If rexture was in use, unbind it */
+    /* If rexture was in use, unbind it once no frame being drawn uses it */
     if (m_texture_index >= 0) {
      
-        glMakeTextureHandleNonResidentARB(m_texture_handle);
+        uint32_t slot = m_texture_index;
         rendering::renderer::instance()->texture_allocator().free_buffer(m_buffer_handle);
+
+        /* Texture still being uploaded never reached the streamer, it is deleted here instead */
+        if (rendering::renderer::instance()->uploads().cancel(m_upload))
+            rendering::renderer::instance()->uploads().delete_texture(m_texture_obj);
+
+        rendering::renderer::instance()->enqueue_render_task([slot] {
+            /* Frames in flight may still sample the texture, it is retired rather than released right away */
+            bool resident = rendering::renderer::instance()->residency().untrack(slot);
+            rendering::renderer::instance()->streamer().untrack(slot, rendering::renderer::instance()->frame_number(), resident);
+            rendering::renderer::instance()->texture_arrays().remove(slot);
+        });
+        return;
     }
 
-    glDeleteTextures(1, &m_texture_obj);
+    /* Uploads queued before still write into the texture, deleting it right away could let them write into a recycled name */
+    rendering::renderer::instance()->uploads().delete_texture(m_texture_obj);
 }
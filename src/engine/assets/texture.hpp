@@ -5,10 +5,12 @@
 #pragma once
 #include "../../lib/glad/glad.h"
 #include "../utils/gpu_memory.hpp"
+#include "../rendering/upload_queue.hpp"
 #include "asset.hpp"
 #include <glm/glm.hpp>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace assets {
 
@@ -22,9 +24,35 @@ namespace assets {
 
             /// @brief Constructor for the texture 
             /// Loads the texture form the file pointed to by and prepares the OpenGL object.
+            /// A cooked KTX2 texture next to the file is loaded instead, unless it is older than the file.
+            /// Images are stored in R8, RG8, RGB8 or RGBA8 by their channels, unless a format is requested.
             ///
             /// @param path Filesystem path of the texture
-            texture(const std::string path) ; 
+            /// @param format Uncompressed format the image is stored in, 0 to pick it by the image's channels. Cooked textures keep their own
+            texture(const std::string path, GLenum format = 0) ; 
+
+            /// @brief Levels of a texture read from its file, not yet on the GPU
+            struct prepared {
+                std::string path;                           ///< File the levels are streamed from, the cooked one if loaded from it
+                GLenum format;                              ///< Internal format of the texture
+                int channels;                               ///< Channels of the source image
+                glm::ivec2 size;                            ///< Size of the full texture
+                GLsizei top_level;                          ///< Finest level read, the first of @c levels
+                GLsizei level_count;                        ///< Levels of the texture object from @c top_level on, generated where not read
+                std::vector<std::vector<uint8_t>> levels;   ///< Pixels or blocks of the levels read, finest first
+                bool streamed;                              ///< Whether finer levels are streamed in, otherwise the chain is whole
+            };
+
+            /// @brief Reads the texture's file the way the constructor would, the CPU part of loading. Safe to call from any thread
+            /// @param path Filesystem path of the texture
+            /// @param format Uncompressed format the image is stored in, as passed to the constructor
+            /// @returns Levels to be passed to the constructor, throws if the file could not be read
+            static prepared prepare(const std::string& path, GLenum format = 0);
+
+            /// @brief Constructor creating the OpenGL object from prepared levels, see @c assets::loader::load_async
+            /// @param path Filesystem path of the texture
+            /// @param data Levels read by @c prepare
+            texture(const std::string path, prepared&& data);
             
             /// @brief Destructor for the texture class
             ~texture();    
@@ -32,24 +60,76 @@ namespace assets {
             /// @brief Makes texture resident in GPU memory and stores its index
             void use();   
 
+            /// @brief Parses the name of a storage format, as given by materials
+            /// @param name One of @c auto, @c r, @c rg, @c rgb or @c rgba
+            /// @returns Uncompressed internal format, 0 for @c auto
+            static GLenum parse_format(const std::string& name);
+
+            /// @brief Queues the image of a texture for decoding on the @c image_decoder, the texture's constructor picks it up
+            ///
+            /// Nothing is queued for textures loaded from their cooked KTX2 file
+            /// @param path Filesystem path of the texture
+            /// @param format Uncompressed format the image is to be stored in, as passed to the constructor
+            static void prefetch(const std::string& path, GLenum format = 0);
+
+            /// @brief Drops the prefetch of a texture whose load was abandoned before reading it
+            /// @param path Filesystem path of the texture
+            /// @param format Uncompressed format, as prefetched
+            static void discard(const std::string& path, GLenum format = 0);
+
+            /// @brief Decodes an image into the texels of an uncompressed format
+            ///
+            /// Channels missing from the image are filled the way @c stb_image does - grey is replicated and alpha is opaque.
+            /// Surplus channels are dropped from the end, so an RG8 normal map keeps the red and green of its image
+            /// and a grey image with alpha stored as RG8 keeps both. Safe to call from any thread
+            /// @param path Filesystem path of the image
+            /// @param format Format of the texels, 0 to pick it by the image's channels and set it
+            /// @param size Set to the size of the image
+            /// @param channels Set to the number of channels of the image
+            /// @returns Texels of the image in a staging buffer of the @c image_decoder, throws if it could not be read
+            static std::vector<uint8_t> decode(const std::string& path, GLenum& format, glm::ivec2& size, int& channels);
+
             /// @brief Getter for texture's parameters
             /// @returns Pair of texture size (in px) and number of channels present in the texture
             inline std::pair<glm::ivec2, int> texture_params() const { return std::make_pair(glm::ivec2(m_w, m_h), m_channels); }
         
-            /// @brief Getter for the texture's bindless handle
+            /// @brief Getter for the texture's internal format, block-compressed when loaded from a cooked KTX2 file
+            inline GLenum format() const { return m_format; }
+
+            /// @brief Getter for the bindless handle of the texture as loaded, streaming replaces it once the texture is used
             inline GLuint64 texture_handle() const { return m_texture_handle; }
 
+            /// @brief Getter for the GPU memory occupied by the texture as loaded, including its mip levels
+            inline size_t memory_size() const { return m_memory_size; }
+
+            /// @brief Levels kept until the texture is copied into a texture array
+            size_t cpu_size() const override;
+
+            /// @brief GPU memory of the texture as loaded, see @c memory_size
+            inline size_t gpu_size() const override { return m_memory_size; }
+
             /// @brief Getter for the texture's index within the GPU texture pool
             int texture_index() const { return m_texture_index; } 
 
+        private:
+            static prepared m_prepare_cooked(const std::string& path);
+            static prepared m_prepare_image(const std::string& path, GLenum format);
+
         private:
 
-            GLuint m_texture_obj;                           ///< OpenGL texture object
+            std::string m_path;                             ///< Filesystem path the mip levels are streamed from
+            std::vector<std::vector<uint8_t>> m_levels;     ///< Levels waiting for a texture array layer, used without bindless textures
+            GLuint m_texture_obj;                           ///< OpenGL texture object, owned by the streamer once used
+            GLenum m_format;                                ///< Internal format of the texture
             GLuint64 m_texture_handle;                      ///< Texture's handle in OpenGL memory
             utils::gpu_allocator::handle m_buffer_handle;   ///< Handle to the texture storage in an internal buffer
             GLint m_texture_index;                          ///< Internal index by which the texture could be accessed in shader
             int m_w,                                        ///< Texture's width in px
                 m_h,                                        ///< Texture's height in px
                 m_channels;                                 ///< Number of texture's color channels 
+            GLsizei m_top_level;                            ///< Finest mip level loaded, levels above are streamed
+            bool m_streamed;                                ///< Whether the texture was loaded with its mip tail only
+            rendering::upload_queue::ticket m_upload;       ///< Upload of the loaded levels, the texture is tracked once done
+            size_t m_memory_size;                           ///< GPU memory of all the mip levels in bytes
         };
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "texture_cooker.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include "ktx2.hpp"
+#include "../rendering/texture_streamer.hpp"
+#include "../../lib/stb/stb_image.h"
+
+using namespace std;
+using namespace assets;
+
+using texel_block = array<array<uint8_t, 4>, 16>;   ///< RGBA texels of a 4x4 block, row by row
+
+/// @brief Gathers a 4x4 block, texels past the edge of the image repeat the last ones
+static texel_block load_block(const vector<uint8_t>& pixels, const glm::ivec2& size, int block_x, int block_y) {
+
+    texel_block block;
+    for (int i = 0; i < 16; i++) {
+        int x = std::min(block_x * 4 + i % 4, size.x - 1);
+        int y = std::min(block_y * 4 + i / 4, size.y - 1);
+        std::copy_n(&pixels[(static_cast<size_t>(y) * size.x + x) * 4], 4, block[i].begin());
+    }
+    return block;
+}
+
+/// @brief Fits a line through the texels by their principal axis, returning its extremes
+/// @param block Texels of the block
+/// @param channels Number of channels fitted, the rest are ignored
+/// @param low End of the line the texels are projected the lowest on
+/// @param high End of the line the texels are projected the highest on
+static void fit_endpoints(const texel_block& block, int channels, array<float, 4>& low, array<float, 4>& high) {
+
+    array<float, 4> mean = {};
+    for (const auto& texel : block)
+        for (int c = 0; c < channels; c++)
+            mean[c] += texel[c] / 16.0f;
+
+    array<array<float, 4>, 4> covariance = {};
+    for (const auto& texel : block)
+        for (int i = 0; i < channels; i++)
+            for (int j = 0; j < channels; j++)
+                covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+
+    /* Power iteration converges to the principal axis fast enough for 16 texels */
+    array<float, 4> axis = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        array<float, 4> next = {};
+        float length = 0.0f;
+        for (int i = 0; i < channels; i++) {
+            for (int j = 0; j < channels; j++)
+                next[i] += covariance[i][j] * axis[j];
+            length += next[i] * next[i];
+        }
+
+        /* Uniform block, any axis does */
+        if (length < 1e-6f)
+            break;
+        for (int i = 0; i < channels; i++)
+            axis[i] = next[i] / std::sqrt(length);
+    }
+
+    float t_min = 0.0f, t_max = 0.0f;
+    for (const auto& texel : block) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (texel[c] - mean[c]) * axis[c];
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    for (int c = 0; c < channels; c++) {
+        low[c] = std::clamp(mean[c] + t_min * axis[c], 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + t_max * axis[c], 0.0f, 255.0f);
+    }
+}
+
+/// @brief Index of the palette entry closest to a texel
+template <size_t Size>
+static int closest(const array<array<int, 4>, Size>& palette, const array<uint8_t, 4>& texel, int first_channel, int channels) {
+
+    int best = 0, best_error = INT32_MAX;
+    for (size_t i = 0; i < Size; i++) {
+        int error = 0;
+        for (int c = first_channel; c < first_channel + channels; c++)
+            error += (palette[i][c] - texel[c]) * (palette[i][c] - texel[c]);
+        if (error < best_error) {
+            best = i;
+            best_error = error;
+        }
+    }
+    return best;
+}
+
+/// @brief Encodes colors of a block into 8 bytes of BC1, always in the four-color mode
+static void encode_bc1(const texel_block& block, uint8_t* out) {
+
+    array<float, 4> low, high;
+    fit_endpoints(block, 3, low, high);
+
+    auto pack = [](const array<float, 4>& color) {
+        return static_cast<uint16_t>(
+            (std::lround(color[0] * 31.0f / 255.0f) << 11) | (std::lround(color[1] * 63.0f / 255.0f) << 5) | std::lround(color[2] * 31.0f / 255.0f));
+    };
+    auto unpack = [](uint16_t color) {
+        int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+        return array<int, 4>{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255 };
+    };
+
+    /* First endpoint has to be the larger one, otherwise the block turns into the three-color mode */
+    uint16_t color0 = pack(high), color1 = pack(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        array<array<int, 4>, 4> palette = { unpack(color0), unpack(color1) };
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++)
+            indices |= static_cast<uint32_t>(closest(palette, block[i], 0, 3)) << (2 * i);
+    }
+
+    memcpy(out, &color0, 2);
+    memcpy(out + 2, &color1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+/// @brief Encodes a channel of a block into 8 bytes of BC4, always in the eight-value mode
+static void encode_bc4(const texel_block& block, int channel, uint8_t* out) {
+
+    uint8_t value0 = 0, value1 = 255;
+    for (const auto& texel : block) {
+        value0 = std::max(value0, texel[channel]);
+        value1 = std::min(value1, texel[channel]);
+    }
+
+    uint64_t indices = 0;
+    if (value0 != value1) {
+        array<array<int, 4>, 8> palette = {};
+        palette[0][channel] = value0;
+        palette[1][channel] = value1;
+        for (int i = 2; i < 8; i++)
+            palette[i][channel] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+
+        for (int i = 0; i < 16; i++)
+            indices |= static_cast<uint64_t>(closest(palette, block[i], channel, 1)) << (3 * i);
+    }
+
+    out[0] = value0;
+    out[1] = value1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+/// @brief Encodes a block into 16 bytes of BC7, mode 6 only - a single RGBA line with 4-bit indices
+static void encode_bc7(const texel_block& block, uint8_t* out) {
+
+    static constexpr array<int, 16> weights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    array<float, 4> low, high;
+    fit_endpoints(block, 4, low, high);
+
+    /* Endpoints are 7 bits per channel and a shared lowest bit, the one fitting the channels better is picked */
+    array<array<int, 4>, 2> quantized;
+    array<int, 2> pbits;
+    array<array<int, 4>, 2> endpoints;
+    for (int e = 0; e < 2; e++) {
+        const array<float, 4>& color = e == 0 ? low : high;
+        float best_error = INFINITY;
+
+        for (int p = 0; p < 2; p++) {
+            array<int, 4> q;
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                q[c] = std::clamp(static_cast<int>(std::lround((color[c] - p) / 2.0f)), 0, 127);
+                error += std::pow(((q[c] << 1) | p) - color[c], 2.0f);
+            }
+            if (error < best_error) {
+                best_error = error;
+                quantized[e] = q;
+                pbits[e] = p;
+            }
+        }
+
+        for (int c = 0; c < 4; c++)
+            endpoints[e][c] = (quantized[e][c] << 1) | pbits[e];
+    }
+
+    array<array<int, 4>, 16> palette;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            palette[i][c] = ((64 - weights[i]) * endpoints[0][c] + weights[i] * endpoints[1][c] + 32) >> 6;
+
+    array<int, 16> indices;
+    for (int i = 0; i < 16; i++)
+        indices[i] = closest(palette, block[i], 0, 4);
+
+    /* Most significant bit of the first index is implicit zero, endpoints are swapped to make it so */
+    if (indices[0] >= 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pbits[0], pbits[1]);
+        for (int& index : indices)
+            index = 15 - index;
+    }
+
+    uint64_t bits[2] = {};
+    int position = 0;
+    auto put = [&](uint64_t value, int count) {
+        for (int i = 0; i < count; i++, position++)
+            bits[position / 64] |= ((value >> i) & 1) << (position % 64);
+    };
+
+    put(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        put(quantized[0][c], 7);
+        put(quantized[1][c], 7);
+    }
+    put(pbits[0], 1);
+    put(pbits[1], 1);
+    for (int i = 0; i < 16; i++)
+        put(indices[i], i == 0 ? 3 : 4);
+
+    memcpy(out, bits, 16);
+}
+
+texture_cooker::codec texture_cooker::parse_codec(const string& name) {
+
+    static const vector<pair<string, codec>> names = {
+        {"auto", codec::AUTO}, {"bc1", codec::BC1}, {"bc3", codec::BC3}, {"bc4", codec::BC4}, {"bc5", codec::BC5}, {"bc7", codec::BC7}
+    };
+
+    auto found = std::find_if(names.begin(), names.end(), [&name](const auto& entry) { return entry.first == name; });
+    if (found == names.end())
+        throw invalid_argument("Unknown texture codec " + name);
+
+    return found->second;
+}
+
+string texture_cooker::cooked_path(const string& source) {
+
+    return filesystem::path(source).replace_extension(".ktx2").string();
+}
+
+string texture_cooker::cook(const string& source, codec codec) {
+
+    glm::ivec2 size;
+    int channels;
+    uint8_t* img_data = stbi_load(source.c_str(), &size.x, &size.y, &channels, STBI_rgb_alpha);
+    if (img_data == NULL)
+        throw runtime_error("Image " + source + " not found or corrupted");
+
+    vector<uint8_t> pixels(img_data, img_data + static_cast<size_t>(size.x) * size.y * 4);
+    stbi_image_free(img_data);
+
+    /* Grey and alpha images keep their alpha, so they go through the color codecs */
+    if (codec == codec::AUTO) {
+        bool opaque = true;
+        for (size_t i = 3; i < pixels.size() && opaque; i += 4)
+            opaque = pixels[i] == 255;
+
+        codec = channels == 1 ? codec::BC4 : opaque ? codec::BC1 : codec::BC3;
+    }
+
+    ktx2_image::vk_format format;
+    size_t block_bytes = 16;
+    switch (codec) {
+        case codec::BC1: format = ktx2_image::BC1_RGB_UNORM; block_bytes = 8; break;
+        case codec::BC4: format = ktx2_image::BC4_UNORM; block_bytes = 8; break;
+        case codec::BC5: format = ktx2_image::BC5_UNORM; break;
+        case codec::BC7: format = ktx2_image::BC7_UNORM; break;
+        default: format = ktx2_image::BC3_UNORM;
+    }
+
+    /* Levels are box-filtered from the previous one, like the runtime mip generation did */
+    glm::ivec2 level_size = size;
+    GLsizei level_count = rendering::texture_streamer::level_count(size);
+    vector<vector<uint8_t>> levels;
+
+    for (GLsizei level = 0; level < level_count; level++) {
+
+        glm::ivec2 blocks = (level_size + 3) / 4;
+        vector<uint8_t> encoded(static_cast<size_t>(blocks.x) * blocks.y * block_bytes);
+
+        for (int y = 0; y < blocks.y; y++) {
+            for (int x = 0; x < blocks.x; x++) {
+
+                texel_block block = load_block(pixels, level_size, x, y);
+                uint8_t* out = &encoded[(static_cast<size_t>(y) * blocks.x + x) * block_bytes];
+
+                switch (codec) {
+                    case codec::BC1: encode_bc1(block, out); break;
+                    case codec::BC4: encode_bc4(block, 0, out); break;
+                    case codec::BC5: encode_bc4(block, 0, out); encode_bc4(block, 1, out + 8); break;
+                    case codec::BC7: encode_bc7(block, out); break;
+                    default: encode_bc4(block, 3, out); encode_bc1(block, out + 8);
+                }
+            }
+        }
+
+        levels.push_back(std::move(encoded));
+        if (level + 1 < level_count)
+            pixels = rendering::texture_streamer::downsample(pixels.data(), level_size, 1, 4);
+    }
+
+    string output = cooked_path(source);
+    ktx2_image(format, size, std::move(levels)).save(output);
+    return output;
+}
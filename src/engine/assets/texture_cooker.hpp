@@ -0,0 +1,40 @@
+///
+/// @file texture_cooker.hpp
+/// @author geffevil
+///
+#pragma once
+#include <string>
+
+namespace assets {
+
+    /// @brief Offline encoder of images into block-compressed KTX2 textures
+    ///
+    /// Images are encoded with their whole mip chain, so the loader uploads them as they are.
+    /// Cooked files are written next to the source image, with the @c .ktx2 extension, where the loader looks for them
+    class texture_cooker {
+
+        public:
+            /// @brief Block compression of the cooked texture
+            enum class codec {
+                AUTO,   ///< Picked by the channels of the image: BC4 for grey, BC1 for opaque and BC3 for translucent images
+                BC1,    ///< RGB in 4 bits per texel
+                BC3,    ///< RGBA in 8 bits per texel
+                BC4,    ///< Single channel in 4 bits per texel
+                BC5,    ///< Red and green in 8 bits per texel, meant for normal maps with the third component reconstructed
+                BC7,    ///< RGBA in 8 bits per texel, better quality than BC3
+            };
+
+        public:
+            /// @brief Parses the name of a codec, as given on the command line
+            static codec parse_codec(const std::string& name);
+
+            /// @brief Path the cooked texture of an image is written to
+            static std::string cooked_path(const std::string& source);
+
+            /// @brief Encodes an image into a KTX2 texture
+            /// @param source Filesystem path of the image
+            /// @param codec Block compression to be used
+            /// @returns Filesystem path of the cooked texture
+            static std::string cook(const std::string& source, codec codec = codec::AUTO);
+    };
+}
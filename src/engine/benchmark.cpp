@@ -0,0 +1,174 @@
+#include "benchmark.hpp"
+#include "assets/loader.hpp"
+#include "utils/resource.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+using namespace glm;
+using namespace utils;
+using namespace rendering;
+using nlohmann::json;
+
+/// @brief Nearest-rank percentile of sorted values
+/// @param sorted Values sorted in ascending order, must not be empty
+/// @param percentile Percentile in range [0, 100]
+static uint64_t percentile(const vector<uint64_t>& sorted, float percentile) {
+
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0f * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+/// @brief Summary of a frame time distribution in milliseconds
+static json frame_time_summary(vector<uint64_t> samples) {
+
+    if (samples.empty())
+        return json::object();
+
+    std::sort(samples.begin(), samples.end());
+    return {
+        {"p50", percentile(samples, 50.0f) / 1.0e6},
+        {"p95", percentile(samples, 95.0f) / 1.0e6},
+        {"p99", percentile(samples, 99.0f) / 1.0e6},
+        {"max", samples.back() / 1.0e6}
+    };
+}
+
+benchmark::benchmark(const string& script_path)
+    : m_frame(0), m_allocated_bytes(0), m_allocator_bytes(0) {
+
+    resource script = resource(script_path);
+
+    m_scene = script.deserialize<string>("benchmark/scene");
+    m_output_path = script.deserialize<string>("benchmark/output", "benchmark.json");
+    m_timestep = script.deserialize<float>("benchmark/timestep", 1.0f / 60.0f);
+    m_warmup_frames = script.deserialize<uint32_t>("benchmark/warmup_frames", 120);
+    m_measured_frames = script.deserialize<uint32_t>("benchmark/frames", 1000);
+
+    if (m_timestep <= 0.0f)
+        throw std::runtime_error("Benchmark timestep must be positive");
+
+    for (const auto& key : script.deserialize<json>("benchmark/camera_path", json::array())) {
+
+        resource res = resource(key);
+        m_path.push_back(keyframe{
+            res.deserialize<float>("time"),
+            res.deserialize<vec3>("position", vec3(0.0f)),
+            res.deserialize<quat>("rotation", quat(1.0f, 0.0f, 0.0f, 0.0f))
+        });
+    }
+
+    std::sort(m_path.begin(), m_path.end(), [](const keyframe& a, const keyframe& b) { return a.time < b.time; });
+    m_records.reserve(m_measured_frames);
+}
+
+void benchmark::drive_camera(const renderer& renderer, float time) const {
+
+    if (m_path.empty() || !renderer.has_active_camera())
+        return;
+
+    scene::scene_node* node = renderer.active_camera()->parent();
+    if (node == nullptr)
+        return;
+
+    /* Hold the ends of the path */
+    if (time <= m_path.front().time || m_path.size() == 1) {
+        node->position = m_path.front().position;
+        node->rotation = m_path.front().rotation;
+        return;
+    }
+    if (time >= m_path.back().time) {
+        node->position = m_path.back().position;
+        node->rotation = m_path.back().rotation;
+        return;
+    }
+
+    /* Find the segment [i, i + 1] containing the time */
+    size_t i = std::upper_bound(m_path.begin(), m_path.end(), time,
+        [](float t, const keyframe& key) { return t < key.time; }) - m_path.begin() - 1;
+
+    const keyframe& k1 = m_path[i];
+    const keyframe& k2 = m_path[i + 1];
+    const vec3& p0 = m_path[i > 0 ? i - 1 : i].position;
+    const vec3& p3 = m_path[std::min(i + 2, m_path.size() - 1)].position;
+    float t = (time - k1.time) / std::max(k2.time - k1.time, 1e-6f);
+
+    /* Catmull-Rom spline through the positions, slerp between the rotations */
+    float t2 = t * t, t3 = t2 * t;
+    node->position = 0.5f * (
+        2.0f * k1.position +
+        (k2.position - p0) * t +
+        (2.0f * p0 - 5.0f * k1.position + 4.0f * k2.position - p3) * t2 +
+        (3.0f * k1.position - p0 - 3.0f * k2.position + p3) * t3
+    );
+    node->rotation = glm::slerp(k1.rotation, k2.rotation, t);
+}
+
+void benchmark::record_frame(renderer& renderer, uint64_t cpu_frame_ns) {
+
+    if (m_frame++ < m_warmup_frames)
+        return;
+
+    const renderer::frame_statistics& stats = renderer.statistics();
+    m_records.push_back(frame_record{ cpu_frame_ns, stats.gpu_frame_ns, stats.draw_calls, stats.triangles });
+
+    m_allocated_bytes =
+        renderer.vertex_allocator().used_size() + renderer.element_allocator().used_size() +
+        renderer.material_allocator().used_size() + renderer.texture_allocator().used_size();
+    m_allocator_bytes =
+        renderer.vertex_allocator().buffer_size() + renderer.element_allocator().buffer_size() +
+        renderer.material_allocator().buffer_size() + renderer.texture_allocator().buffer_size();
+}
+
+void benchmark::write_report() const {
+
+    vector<uint64_t> cpu_times, gpu_times;
+    uint64_t draw_calls = 0, triangles = 0;
+
+    for (const auto& record : m_records) {
+        cpu_times.push_back(record.cpu_ns);
+        draw_calls += record.draw_calls;
+        triangles += record.triangles;
+
+        /* GPU time arrives a few frames late, frames with no result yet are skipped */
+        if (record.gpu_ns > 0)
+            gpu_times.push_back(record.gpu_ns);
+    }
+
+    size_t frames = std::max<size_t>(m_records.size(), 1);
+    assets::loader::cache_stats cache = assets::loader::stats();
+    json report = {
+        {"scene", m_scene},
+        {"warmup_frames", m_warmup_frames},
+        {"frames", m_records.size()},
+        {"timestep", m_timestep},
+        {"cpu_frame_ms", frame_time_summary(cpu_times)},
+        {"gpu_frame_ms", frame_time_summary(gpu_times)},
+        {"mean_draw_calls", draw_calls / frames},
+        {"mean_triangles", triangles / frames},
+        {"allocator", {
+            {"used_bytes", m_allocated_bytes},
+            {"total_bytes", m_allocator_bytes}
+        }},
+        {"asset_cache", {
+            {"hits", cache.hits},
+            {"misses", cache.misses},
+            {"evictions", cache.evictions},
+            {"pooled_assets", cache.pooled_assets},
+            {"pooled_bytes", cache.pooled_bytes}
+        }}
+    };
+
+    std::ofstream output(m_output_path);
+    if (!output) {
+        std::cerr << "[ERROR] Unable to write the benchmark report to " << m_output_path << std::endl;
+        std::cout << report.dump(4) << std::endl;
+        return;
+    }
+
+    output << report.dump(4) << std::endl;
+    std::cerr << "[INFO] Benchmark report written to " << m_output_path << std::endl;
+}
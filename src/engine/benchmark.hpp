@@ -0,0 +1,75 @@
+///
+/// @file benchmark.hpp
+/// @author geffevil
+///
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "rendering/renderer.hpp"
+
+/// @brief Scripted benchmark run
+///
+/// The script loads a scene, flies the main camera along a recorded path with a fixed simulated timestep
+/// and measures a window of frames after a warm-up. Its structure is
+/// @code
+/// { "benchmark": {
+///     "scene": "scenes/sponza.json", "warmup_frames": 120, "frames": 1000,
+///     "timestep": 0.016666, "output": "benchmark.json",
+///     "camera_path": [ { "time": 0.0, "position": {"x":0,"y":1,"z":0}, "rotation": {"p":0,"y":0,"r":0} }, ... ]
+/// } }
+/// @endcode
+class benchmark {
+
+    public:
+        /// @brief Loads the benchmark script
+        /// @param script_path Filesystem path of the script
+        benchmark(const std::string& script_path);
+
+        inline const std::string& scene() const { return m_scene; }
+        inline float timestep() const { return m_timestep; }
+        inline bool finished() const { return m_frame >= m_warmup_frames + m_measured_frames; }
+
+        /// @brief Moves the parent node of the active camera to its place on the path
+        /// @param renderer Renderer holding the active camera
+        /// @param time Simulated time since the start of the run
+        void drive_camera(const rendering::renderer& renderer, float time) const;
+
+        /// @brief Records statistics of a finished frame, frames of the warm-up are discarded
+        /// @param renderer Renderer which drew the frame
+        /// @param cpu_frame_ns Wall time of the whole frame on the CPU
+        void record_frame(rendering::renderer& renderer, uint64_t cpu_frame_ns);
+
+        /// @brief Writes the JSON report to the output path of the script
+        void write_report() const;
+
+    private:
+        /// @brief Keyframe of the camera path
+        struct keyframe {
+            float time;
+            glm::vec3 position;
+            glm::quat rotation;
+        };
+
+        /// @brief Statistics of a measured frame
+        struct frame_record {
+            uint64_t cpu_ns;
+            uint64_t gpu_ns;
+            uint32_t draw_calls;
+            uint64_t triangles;
+        };
+
+    private:
+        std::string m_scene;                    ///< Path of the benchmarked scene
+        std::string m_output_path;              ///< Path of the JSON report
+        float m_timestep;                       ///< Simulated time of a frame, in seconds
+        uint32_t m_warmup_frames;               ///< Frames run before measuring
+        uint32_t m_measured_frames;             ///< Frames measured
+        uint32_t m_frame;                       ///< Frames run so far
+        std::vector<keyframe> m_path;           ///< Camera path, ordered by time
+        std::vector<frame_record> m_records;    ///< Statistics of the measured frames
+        size_t m_allocated_bytes,               ///< Bytes allocated from the renderer's GPU buffers after the last frame
+               m_allocator_bytes;               ///< Total size of the renderer's GPU buffers
+};
@@ -1,6 +1,8 @@
 #include "runtime.hpp"
+#include "benchmark.hpp"
 #include "engine_app.hpp"
 #include "game_window.hpp"
+#include "assets/image_decoder.hpp"
 #include "utils/exceptions.hpp"
 #include "utils/project_settings.hpp"
 #include "window/video_mode.hpp"
@@ -13,7 +15,9 @@
 /// @brief Default video mode used when config fails to load
 constexpr video_mode DEFAULT_VIDMODE = video_mode(1280, 720, video_mode::window_mode::WINDOW, video_mode::aa_level::OFF, false);
 
-application::application(const std::string& project_conf) {
+application::application(const std::string& project_conf, bool headless, const game_window::headless_options_t& headless_options,
+                         const std::string& benchmark_script) 
+    : m_headless(headless), m_headless_options(headless_options), m_benchmark_script(benchmark_script) {
 
     try {        
         m_settings.init(project_conf);
@@ -29,11 +33,23 @@ application::application(const std::string& project_conf) {
 application::exit_status application::run() {
 
     try {
+        /* Images are decoded on a pool of threads, 0 threads picks by the hardware */
+        assets::image_decoder decoder = assets::image_decoder(utils::project_settings::decode_threads());
+
         video_mode mode = video_mode("video.json", DEFAULT_VIDMODE);
-        m_window.create(utils::project_settings::project_name(), mode);
+        if (m_headless)
+            mode = mode.with_win_mode(video_mode::window_mode::HEADLESS);
+
+        m_window.create(utils::project_settings::project_name(), mode, m_headless_options);
         
         engine_runtime runtime = engine_runtime(m_window);
-        runtime.start();
+        if (m_benchmark_script.empty()) {
+            runtime.start();
+        } else {
+            benchmark bench = benchmark(m_benchmark_script);
+            runtime.start(&bench);
+            bench.write_report();
+        }
     }
     catch (utils::exceptions::app_reload_message&) {
 
@@ -21,7 +21,11 @@ class application {
     public:
         /// @brief Constructs the application and all it's components
         /// @param project_conf Filesystem path of the main configuration file
-        application(const std::string& project_conf);
+        /// @param headless Render offscreen without a window, see @c game_window
+        /// @param headless_options Options of the headless backend
+        /// @param benchmark_script Path of a benchmark script to run instead of the default scene, see @c benchmark
+        application(const std::string& project_conf, bool headless = false, const game_window::headless_options_t& headless_options = {0, ""},
+                    const std::string& benchmark_script = "");
 
         /// @brief Runs the main loop of the application
         /// @returns An exit code indicating action to take
@@ -31,6 +35,9 @@ class application {
     private:
         game_window m_window;                   ///< Main window
         utils::project_settings m_settings;     ///< Project settings instance
+        bool m_headless;                        ///< Whether to render without a window
+        game_window::headless_options_t m_headless_options; ///< Options of the headless backend
+        std::string m_benchmark_script;         ///< Benchmark script to run, empty for a normal run
         assets::loader m_asset_loader;          ///< Asset cache instance
 };
 
@@ -3,27 +3,66 @@
 /// @author geffevil
 ///
 #include "engine_app.hpp"
+#include "assets/texture_cooker.hpp"
+#include <iostream>
 #include <string>
+#include <vector>
 
 
 #define PARSE_ARG(name, type, var) \
     if (std::string_view(argv[arg]) == name && arg < argc - 1) \
         var = type(argv[++arg]);    
+
+#define PARSE_FLAG(name, var) \
+    if (std::string_view(argv[arg]) == name) \
+        var = true;
+
+#define PARSE_LIST_ARG(name, list) \
+    if (std::string_view(argv[arg]) == name && arg < argc - 1) \
+        list.push_back(argv[++arg]);
     
 /// @brief Entry point of the application
 int main(int argc, char** argv) {    
 
     /* Defaults */
     std::string project_path = "project.json";
+    bool headless = false;
+    game_window::headless_options_t headless_options = { 0, "" };
+    std::string benchmark_script = "";
+    std::vector<std::string> cook_paths;
+    std::string cook_codec = "auto";
 
     /* Arg parsing */
     for (int arg = 0; arg < argc; arg++) {
         PARSE_ARG("--project", std::string, project_path);
+        PARSE_FLAG("--headless", headless);
+        PARSE_ARG("--frames", std::stoul, headless_options.frame_limit);
+        PARSE_ARG("--dump-frames", std::string, headless_options.dump_path);
+        PARSE_ARG("--benchmark", std::string, benchmark_script);
+        PARSE_LIST_ARG("--cook", cook_paths);
+        PARSE_ARG("--cook-codec", std::string, cook_codec);
+    }
+
+    /* Textures are cooked offline, no window is opened */
+    if (!cook_paths.empty()) {
+
+        int failed = 0;
+        for (const auto& path : cook_paths) {
+            try {
+                std::cerr << "[INFO] Cooked " << assets::texture_cooker::cook(path, assets::texture_cooker::parse_codec(cook_codec)) << std::endl;
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[ERROR] Unable to cook " << path << ": " << e.what() << std::endl;
+                failed++;
+            }
+        }
+
+        return failed == 0 ? 0 : 1;
     }
 
     application::exit_status status;
     while (true) {
-        application app = application(project_path);
+        application app = application(project_path, headless, headless_options, benchmark_script);
 
         if ((status = app.run()) != application::exit_status::RELOAD)
             break; /* App is not being reloaded, end */
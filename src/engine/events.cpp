@@ -1,6 +1,7 @@
 #include "events.hpp"
 #include "game_window.hpp"
 #include "window/key_code.hpp"
+#include "utils/cpu_profiler.hpp"
 #include <GLFW/glfw3.h>
 #include <glm/fwd.hpp>
 #include <cstdint>
@@ -11,7 +12,7 @@ using namespace std;
 
 
 events::events() 
-    : m_mouse_button_buffer(0), m_mouse_pos(0), m_mouse_delta(0) {
+    : m_mouse_button_buffer(0), m_mouse_pos(0), m_mouse_delta(0), m_has_window(false) {
     s_instance = this;
 }
 
@@ -21,7 +22,12 @@ events::~events() {
 
 void events::apply_callbacks(const game_window& window) {
 
+    /* Headless, nothing to attach to */
+    if (window.props().glfw_handle == nullptr)
+        return;
+
     std::cerr << "Callbacks attached! (" << &window << ")" << std::endl;
+    m_has_window = true;
 
     /* Get initial mouse position - so no weirdness occurs */
     double initial_mouse_x, initial_mouse_y;
@@ -62,6 +68,8 @@ void events::apply_callbacks(const game_window& window) {
 
 void events::process_frame() {
     
+    PROFILE_ZONE("events::process_frame");
+
     /* Update state for all keys */
     for (int i = 0; i < m_key_buffer.size(); i++) {
         m_key_buffer[i] ^= m_key_delta_buffer[i];   /* Transfer delta buffer to main key buffer */
@@ -74,7 +82,8 @@ void events::process_frame() {
 
     m_mouse_delta = glm::vec2(0);
 
-    glfwPollEvents();
+    if (m_has_window)
+        glfwPollEvents();
 }
 
 bool events::is_key_pressed(key_code key) {        
@@ -45,4 +45,5 @@ class events {
         
         glm::vec2 m_mouse_pos;
         glm::vec2 m_mouse_delta;
+        bool m_has_window;      ///< Headless windows have no input to poll
 };
@@ -5,24 +5,31 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
-game_window::game_window()
-    : m_props({false, "", video_mode(), nullptr}), m_cursor_state(cursor_state::cursor_visible) {
+#ifdef ENGINE_HEADLESS
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
 
-    /* Initialize GLFW */
-    if (!glfwInit())
-        throw std::runtime_error("GLFW context initialization failed!");
+game_window::game_window()
+    : m_props({false, "", video_mode(), nullptr, 0}), m_cursor_state(cursor_state::cursor_visible), m_glfw_initialized(false), m_shared_windows{},
+      m_headless({0, ""}), m_egl_display(nullptr), m_egl_context(nullptr), m_egl_config(nullptr), m_egl_shared_contexts{}, 
+      m_color_buffer(0), m_frame_count(0), m_frame_limit_reached(false) {
 
     std::cerr << "Window created! (" << this << ")" << std::endl;
 }
 
-void game_window::create(const std::string& title, video_mode& mode) {
-
-
+void game_window::create(const std::string& title, video_mode& mode, const headless_options_t& headless) {
 
     /* Destroy old window if needed */
+    m_destroy_shared_context();
+
     if (m_props.glfw_handle != nullptr) {
 
         std::cerr << "Old window deleted! (" << this << ")" << std::endl;
@@ -30,14 +37,32 @@ void game_window::create(const std::string& title, video_mode& mode) {
         glfwDestroyWindow(m_props.glfw_handle);
     }
 
+    m_destroy_headless();
+
     /* Setup new window */
     m_props = game_window::window_props_t{
         false, 
         title, 
         mode,
-        nullptr
+        nullptr,
+        0
     };
 
+    m_headless = headless;
+    m_frame_count = 0;
+    m_frame_limit_reached = false;
+
+    if (m_props.current_mode.win_mode() == video_mode::window_mode::HEADLESS) {
+        m_create_headless();
+        return;
+    }
+
+    /* Initialize GLFW, only needed by real windows - headless machines may have no display to connect to */
+    if (!m_glfw_initialized && !glfwInit())
+        throw std::runtime_error("GLFW context initialization failed!");
+
+    m_glfw_initialized = true;
+
     /* Get primary monitor vidmode */
     const GLFWvidmode* glfw_vidmode = glfwGetVideoMode(glfwGetPrimaryMonitor());    
     if (glfw_vidmode == nullptr)
@@ -81,23 +106,142 @@ game_window::~game_window() {
  
     std::cerr << "Window destroyed! (" << this << ")" << std::endl;
 
-    if (!m_props.glfw_handle)
-        return;
-    
-    glfwHideWindow(m_props.glfw_handle);
-    glfwDestroyWindow(m_props.glfw_handle);
+    m_destroy_shared_context();
+    m_destroy_headless();
 
-    glfwTerminate();
+    if (m_props.glfw_handle) {
+        glfwHideWindow(m_props.glfw_handle);
+        glfwDestroyWindow(m_props.glfw_handle);
+    }
+
+    if (m_glfw_initialized)
+        glfwTerminate();
 }
 
 const cursor_state& game_window::cursor(const cursor_state& state) {
-    glfwSetInputMode(m_props.glfw_handle, GLFW_CURSOR, static_cast<int>(state));
+    if (m_props.glfw_handle)
+        glfwSetInputMode(m_props.glfw_handle, GLFW_CURSOR, static_cast<int>(state));
     return m_cursor_state = state;
 }
 
 void game_window::close() {
     m_props.is_closing = true;
-    glfwHideWindow(m_props.glfw_handle);
+    if (m_props.glfw_handle)
+        glfwHideWindow(m_props.glfw_handle);
+}
+
+void game_window::swap_buffers() {
+
+    if (m_props.glfw_handle) {
+        glfwSwapBuffers(m_props.glfw_handle);
+        return;
+    }
+
+    m_frame_count++;
+    if (!m_headless.dump_path.empty())
+        m_dump_frame();
+
+    if (m_headless.frame_limit != 0 && m_frame_count >= m_headless.frame_limit)
+        m_frame_limit_reached = true;
+}
+
+void game_window::make_current() {
+
+    if (m_props.glfw_handle) {
+        glfwMakeContextCurrent(m_props.glfw_handle);
+        return;
+    }
+
+#ifdef ENGINE_HEADLESS
+    eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_egl_context);
+#endif
+}
+
+void game_window::release_current() {
+
+    if (m_props.glfw_handle) {
+        glfwMakeContextCurrent(nullptr);
+        return;
+    }
+
+#ifdef ENGINE_HEADLESS
+    eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#endif
+}
+
+void game_window::create_shared_context(shared_context context) {
+
+    size_t index = static_cast<size_t>(context);
+    if (m_props.glfw_handle) {
+
+        /* Contexts come only with windows in GLFW, these are never shown */
+        if (m_shared_windows[index] == nullptr) {
+            m_apply_default_hints();
+            m_shared_windows[index] = glfwCreateWindow(1, 1, "", nullptr, m_props.glfw_handle);
+
+            if (m_shared_windows[index] == nullptr)
+                throw std::runtime_error("Shared OpenGL context creation failed!");
+        }
+        return;
+    }
+
+#ifdef ENGINE_HEADLESS
+
+    if (m_egl_shared_contexts[index] == nullptr) {
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 6,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        m_egl_shared_contexts[index] = eglCreateContext(m_egl_display, m_egl_config, m_egl_context, context_attributes);
+        if (m_egl_shared_contexts[index] == EGL_NO_CONTEXT) {
+            m_egl_shared_contexts[index] = nullptr;
+            throw std::runtime_error("Shared EGL context creation failed!");
+        }
+    }
+
+#endif
+}
+
+void game_window::make_shared_current(shared_context context) {
+
+    size_t index = static_cast<size_t>(context);
+    create_shared_context(context);
+
+    if (m_props.glfw_handle) {
+        glfwMakeContextCurrent(m_shared_windows[index]);
+        return;
+    }
+
+#ifdef ENGINE_HEADLESS
+
+    if (!eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_egl_shared_contexts[index]))
+        throw std::runtime_error("Shared EGL context could not be made current!");
+
+#endif
+}
+
+void game_window::m_destroy_shared_context() {
+
+    for (GLFWwindow*& shared_window : m_shared_windows) {
+        if (shared_window != nullptr) {
+            glfwDestroyWindow(shared_window);
+            shared_window = nullptr;
+        }
+    }
+
+#ifdef ENGINE_HEADLESS
+
+    for (void*& shared_context : m_egl_shared_contexts) {
+        if (shared_context != nullptr) {
+            eglDestroyContext(m_egl_display, shared_context);
+            shared_context = nullptr;
+        }
+    }
+
+#endif
 }
 
 void game_window::m_apply_default_hints() {
@@ -109,4 +253,120 @@ void game_window::m_apply_default_hints() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_SAMPLES, static_cast<int>(m_props.current_mode.antialias_level()));
-}
\ No newline at end of file
+}
+
+void game_window::m_create_headless() {
+
+#ifdef ENGINE_HEADLESS
+
+    /* Surfaceless platform needs no display server, Mesa provides it even without a GPU (llvmpipe) */
+    auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    EGLDisplay display = get_platform_display != nullptr 
+        ? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) 
+        : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint egl_major = 0, egl_minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &egl_major, &egl_minor))
+        throw std::runtime_error("EGL display initialization failed!");
+
+    m_egl_display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw std::runtime_error("EGL does not support desktop OpenGL!");
+
+    const EGLint config_attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0)
+        throw std::runtime_error("No EGL config supports OpenGL!");
+
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 6,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT)
+        throw std::runtime_error("EGL OpenGL 4.6 context creation failed!");
+
+    m_egl_context = context;
+    m_egl_config = config;
+
+    /* No surface, all the drawing goes to framebuffer objects */
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        throw std::runtime_error("Surfaceless EGL context could not be made current!");
+
+    /* Initialize GLAD */
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+        throw std::runtime_error("OpenGL context initialization failed!");
+
+    /* Offscreen framebuffer standing in for the back buffer */
+    glm::ivec2 size = m_props.current_mode.size();
+    glCreateRenderbuffers(1, &m_color_buffer);
+    glNamedRenderbufferStorage(m_color_buffer, GL_RGBA8, size.x, size.y);
+
+    glCreateFramebuffers(1, &m_props.framebuffer);
+    glNamedFramebufferRenderbuffer(m_props.framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color_buffer);
+    glNamedFramebufferDrawBuffer(m_props.framebuffer, GL_COLOR_ATTACHMENT0);
+    glNamedFramebufferReadBuffer(m_props.framebuffer, GL_COLOR_ATTACHMENT0);
+
+    if (!m_headless.dump_path.empty())
+        std::filesystem::create_directories(m_headless.dump_path);
+
+    std::cerr << "Headless context initialized! (" << this << ", EGL " << egl_major << "." << egl_minor << ")" << std::endl;
+
+#else
+    throw std::runtime_error("Engine was built without headless support, rebuild it with the headless option");
+#endif
+}
+
+void game_window::m_destroy_headless() {
+
+#ifdef ENGINE_HEADLESS
+
+    if (m_egl_context == nullptr)
+        return;
+
+    glDeleteFramebuffers(1, &m_props.framebuffer);
+    glDeleteRenderbuffers(1, &m_color_buffer);
+    m_props.framebuffer = 0;
+    m_color_buffer = 0;
+
+    eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(m_egl_display, m_egl_context);
+    eglTerminate(m_egl_display);
+
+    m_egl_context = nullptr;
+    m_egl_config = nullptr;
+    m_egl_display = nullptr;
+
+#endif
+}
+
+void game_window::m_dump_frame() {
+
+    glm::ivec2 size = m_props.current_mode.size();
+    std::vector<uint8_t> pixels(size.x * size.y * 3);
+
+    /* Waits for the frame to finish, dumping is meant for tests, not for benchmarks */
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_props.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.x, size.y, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    char file_name[32];
+    std::snprintf(file_name, sizeof(file_name), "frame_%05u.ppm", m_frame_count);
+
+    std::ofstream frame_file = std::ofstream(std::filesystem::path(m_headless.dump_path) / file_name, std::ios::out | std::ios::binary);
+    if (!frame_file.is_open()) {
+        std::cerr << "[ERROR] Unable to dump frame " << m_frame_count << " into " << m_headless.dump_path << std::endl;
+        return;
+    }
+
+    /* OpenGL rows go bottom-up, PPM rows top-down */
+    frame_file << "P6\n" << size.x << " " << size.y << "\n255\n";
+    for (int row = size.y - 1; row >= 0; row--)
+        frame_file.write(reinterpret_cast<const char*>(pixels.data() + row * size.x * 3), size.x * 3);
+}
@@ -4,12 +4,19 @@
 ///
 
 #pragma once
+#include "../lib/glad/glad.h"
 #include "window/key_code.hpp"
 #include "window/video_mode.hpp"
 #include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 /// @brief Main engine window class, wrapper of the GLFW functionality
+///
+/// With @c video_mode::window_mode::HEADLESS no window is created, the context is created through EGL surfaceless
+/// and frames are presented into an offscreen framebuffer. Requires the engine to be built with @c ENGINE_HEADLESS
 class game_window {
 
     public:  
@@ -18,7 +25,14 @@ class game_window {
             bool is_closing;            ///< Flag signaling wether the window should close
             std::string win_title;      ///< Current title of the window
             video_mode current_mode;    ///< Currently used video mode
-            GLFWwindow* glfw_handle;    ///< Handle of the underlying GLFW object
+            GLFWwindow* glfw_handle;    ///< Handle of the underlying GLFW object, null when headless
+            GLuint framebuffer;         ///< Framebuffer presented by @c swap_buffers, 0 for the window's back buffer
+        };
+
+        /// @brief Options of the headless backend
+        struct headless_options_t {
+            uint32_t frame_limit;       ///< Number of frames rendered before the window closes, 0 for no limit
+            std::string dump_path;      ///< Directory the presented frames are dumped into, empty to not dump
         };
 
     public:
@@ -29,8 +43,42 @@ class game_window {
         ///
         /// @param title Title of the window
         /// @param mode Video mode to be used by the window
-        void create(const std::string& title, video_mode& mode);
+        /// @param headless Options used when @c mode is headless
+        void create(const std::string& title, video_mode& mode, const headless_options_t& headless = {0, ""});
+
+        /// @brief Presents the rendered frame
+        ///
+        /// Swaps the window's buffers, or dumps the offscreen framebuffer when headless
+        void swap_buffers();
+
+        /// @brief Checks whether the headless frame limit was reached, safe to call while another thread presents
+        ///
+        /// The window is not closed by @c swap_buffers, which may run on the render thread. The simulation closes it instead
+        inline bool frame_limit_reached() const { return m_frame_limit_reached; }
+
+        /// @brief Makes the window's context current on the calling thread
+        void make_current();
 
+        /// @brief Releases the context current on the calling thread
+        void release_current();
+
+        /// @brief Contexts sharing objects with the window's one, each may be current on one thread only
+        enum class shared_context {
+            SIMULATION, ///< Context of the simulation, while the window's one draws on the render thread
+            UPLOAD,     ///< Context of the upload thread
+            COUNT
+        };
+
+        /// @brief Creates a context sharing objects with the window's one, has to be called from the main thread
+        /// @param context Which of the shared contexts to create, nothing is done if it exists already
+        void create_shared_context(shared_context context);
+
+        /// @brief Makes a context sharing objects with the window's one current on the calling thread
+        ///
+        /// The context is created by the first call unless created before, in which case the call has to come from the main thread.
+        /// Container objects (VAOs, FBOs, program pipelines) and bindings are not shared, those belong to the window's context
+        /// @param context Which of the shared contexts to make current
+        void make_shared_current(shared_context context = shared_context::SIMULATION);
         
         /// @brief Sets cursor state for the window
         /// @param state Cursor state to be used
@@ -46,7 +94,27 @@ class game_window {
     private:
         window_props_t m_props;         ///< Window's properties
         cursor_state m_cursor_state;    ///< Current cursor state
+        bool m_glfw_initialized;        ///< GLFW is initialized only for real windows
+        std::array<GLFWwindow*, static_cast<size_t>(shared_context::COUNT)> m_shared_windows; ///< Hidden windows owning the shared contexts
+
+        /* Headless backend */
+        headless_options_t m_headless;  ///< Options of the headless backend
+        void* m_egl_display;            ///< EGL display of the headless context
+        void* m_egl_context;            ///< Headless OpenGL context
+        void* m_egl_config;             ///< Config the headless contexts were created with
+        std::array<void*, static_cast<size_t>(shared_context::COUNT)> m_egl_shared_contexts; ///< Headless contexts sharing objects with @c m_egl_context
+        GLuint m_color_buffer;          ///< Color renderbuffer of the offscreen framebuffer
+        uint32_t m_frame_count;         ///< Frames presented so far
+        std::atomic<bool> m_frame_limit_reached; ///< Set once @c m_headless.frame_limit frames were presented
 
         /// @brief Applies some default hints (like OpenGL version) to the window
         void m_apply_default_hints();
+
+        /// @brief Creates a headless context and its offscreen framebuffer
+        void m_create_headless();
+        void m_destroy_headless();
+        void m_destroy_shared_context();
+
+        /// @brief Writes the offscreen framebuffer into a PPM file
+        void m_dump_frame();
 };
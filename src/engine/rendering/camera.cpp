@@ -24,7 +24,7 @@ camera::camera(scene::scene_node* parent, const utils::resource& res)
       
 
 camera::camera(scene::scene_node* parent, float fov, float near, float far, bool main) 
-    : scene::node_component(parent), m_fov(fov), m_near(near), m_far(far), m_main(main) {
+    : scene::node_component(parent), m_fov(fov), m_near(near), m_far(far), m_main(main), m_world_position(0.0f, 0.0f, 0.0f, 1.0f) {
 
     glCreateBuffers(1, &m_camera_data);
     
@@ -39,7 +39,9 @@ camera::camera(scene::scene_node* parent, float fov, float near, float far, bool
 
 camera::~camera() {
     
-    glDeleteBuffers(1, &m_camera_data);
+    /* Buffer may still be read by a frame being drawn */
+    GLuint camera_data = m_camera_data;
+    renderer::instance()->enqueue_render_task([camera_data] { glDeleteBuffers(1, &camera_data); });
 }
 
 mat4x4 camera::view() const {
@@ -115,13 +117,8 @@ void camera::scene_enter() {
 
 void camera::prepare_draw(const mat4x4& parent_transform) {
 
-    vec4 world_pos = vec4(parent()->position, 1.0) * parent_transform;
-
-    glNamedBufferSubData(
-        m_camera_data, 
-        2 * sizeof(mat4x4), sizeof(vec4), 
-        value_ptr(world_pos)
-    );
+    /* Uploaded by the renderer along with the view, when the camera is active */
+    m_world_position = vec4(parent()->position, 1.0) * parent_transform;
 } 
 
 
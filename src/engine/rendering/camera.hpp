@@ -55,6 +55,9 @@ namespace rendering {
             /// @returns OpenGL handle for the buffer containing camera data
             inline GLuint camera_data() const { return m_camera_data; }
 
+            /// @brief World position of the camera, as of the last @c prepare_draw
+            inline const glm::vec4& world_position() const { return m_world_position; }
+
             /// @brief Makes camera active
             ///
             /// Sets this camera up as an active camera and begins rendering through it
@@ -67,5 +70,6 @@ namespace rendering {
             float m_fov, m_near, m_far;
             bool m_main;
             GLuint m_camera_data;
+            glm::vec4 m_world_position;
     };
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "frustum.hpp"
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+using namespace glm;
+using namespace rendering;
+
+void frustum::box_list::push_back(const vec3& center, const vec3& extent) {
+
+    m_center_x.push_back(center.x);
+    m_center_y.push_back(center.y);
+    m_center_z.push_back(center.z);
+    m_extent_x.push_back(extent.x);
+    m_extent_y.push_back(extent.y);
+    m_extent_z.push_back(extent.z);
+}
+
+void frustum::box_list::clear() {
+
+    m_center_x.clear();
+    m_center_y.clear();
+    m_center_z.clear();
+    m_extent_x.clear();
+    m_extent_y.clear();
+    m_extent_z.clear();
+}
+
+void frustum::box_list::reserve(size_t count) {
+
+    m_center_x.reserve(count);
+    m_center_y.reserve(count);
+    m_center_z.reserve(count);
+    m_extent_x.reserve(count);
+    m_extent_y.reserve(count);
+    m_extent_z.reserve(count);
+}
+
+frustum::frustum(const mat4x4& view_projection) {
+
+    /* Gribb-Hartmann plane extraction, rows of the matrix combined */
+    auto row = [&view_projection](int i) {
+        return vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+
+    m_planes = {
+        row(3) + row(0), row(3) - row(0),   /* Left, right */
+        row(3) + row(1), row(3) - row(1),   /* Bottom, top */
+        row(3) + row(2), row(3) - row(2)    /* Near, far */
+    };
+
+    for (auto& plane : m_planes)
+        plane /= length(vec3(plane));
+}
+
+void frustum::cull(const box_list& boxes, std::vector<uint32_t>& visible) const {
+
+    size_t i = 0;
+
+#if defined(__AVX2__)
+
+    /* 8 boxes per iteration */
+    for (; i + 8 <= boxes.size(); i += 8) {
+
+        __m256 cx = _mm256_loadu_ps(&boxes.m_center_x[i]), ex = _mm256_loadu_ps(&boxes.m_extent_x[i]);
+        __m256 cy = _mm256_loadu_ps(&boxes.m_center_y[i]), ey = _mm256_loadu_ps(&boxes.m_extent_y[i]);
+        __m256 cz = _mm256_loadu_ps(&boxes.m_center_z[i]), ez = _mm256_loadu_ps(&boxes.m_extent_z[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (const auto& plane : m_planes) {
+
+            /* Distance of the center and projected radius of the box */
+            __m256 dist = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+                _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w))
+            );
+            __m256 radius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y)))),
+                _mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z)))
+            );
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        for (int mask = _mm256_movemask_ps(inside); mask != 0; mask &= mask - 1)
+            visible.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+    }
+
+#elif defined(__SSE2__)
+
+    /* 4 boxes per iteration */
+    for (; i + 4 <= boxes.size(); i += 4) {
+
+        __m128 cx = _mm_loadu_ps(&boxes.m_center_x[i]), ex = _mm_loadu_ps(&boxes.m_extent_x[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.m_center_y[i]), ey = _mm_loadu_ps(&boxes.m_extent_y[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.m_center_z[i]), ez = _mm_loadu_ps(&boxes.m_extent_z[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (const auto& plane : m_planes) {
+
+            /* Distance of the center and projected radius of the box */
+            __m128 dist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w))
+            );
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+                _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z)))
+            );
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+        }
+
+        for (int mask = _mm_movemask_ps(inside); mask != 0; mask &= mask - 1)
+            visible.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+    }
+
+#endif
+
+    /* Leftovers (or everything, when no SIMD is available) */
+    for (; i < boxes.size(); i++) {
+        if (m_is_visible(boxes, i))
+            visible.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+bool frustum::m_is_visible(const box_list& boxes, size_t index) const {
+
+    for (const auto& plane : m_planes) {
+
+        float dist = plane.x * boxes.m_center_x[index] + plane.y * boxes.m_center_y[index] + plane.z * boxes.m_center_z[index] + plane.w;
+        float radius = std::abs(plane.x) * boxes.m_extent_x[index] + std::abs(plane.y) * boxes.m_extent_y[index] + std::abs(plane.z) * boxes.m_extent_z[index];
+
+        if (dist + radius < 0)
+            return false;
+    }
+
+    return true;
+}
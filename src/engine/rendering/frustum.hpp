@@ -0,0 +1,60 @@
+///
+/// @file frustum.hpp
+/// @author geffevil
+///
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace rendering {
+
+    /// @brief View frustum used to cull objects on the CPU
+    ///
+    /// Boxes are tested in batches - 8 at once with AVX2 (built with @c --avx2), 4 at once with SSE,
+    /// falling back to scalar code when neither is available at compile time
+    class frustum {
+
+        public:
+            /// @brief List of world-space axis aligned bounding boxes, stored as structure of arrays
+            class box_list {
+
+                public:
+                    /// @brief Appends a box to the list
+                    /// @param center World-space center of the box
+                    /// @param extent Half-size of the box along each axis
+                    void push_back(const glm::vec3& center, const glm::vec3& extent);
+                    void clear();
+                    void reserve(size_t count);
+
+                    inline size_t size() const { return m_center_x.size(); }
+
+                private:
+                    friend class frustum;
+
+                    std::vector<float> m_center_x, m_center_y, m_center_z;
+                    std::vector<float> m_extent_x, m_extent_y, m_extent_z;
+            };
+
+        public:
+            /// @brief Constructor
+            ///
+            /// Extracts the frustum planes from the combined matrix
+            /// @param view_projection Product of the projection and the view matrix
+            frustum(const glm::mat4x4& view_projection);
+
+            /// @brief Tests boxes against the frustum
+            ///
+            /// @param boxes Boxes to be tested
+            /// @param visible Output list, indices of the boxes intersecting the frustum are appended to it
+            void cull(const box_list& boxes, std::vector<uint32_t>& visible) const;
+
+        private:
+            /// @brief Scalar test of a single box
+            bool m_is_visible(const box_list& boxes, size_t index) const;
+
+        private:
+            std::array<glm::vec4, 6> m_planes;  ///< Normalized frustum planes, normals pointing inside
+    };
+}
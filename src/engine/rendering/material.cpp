@@ -14,8 +14,42 @@
 using namespace glm;
 using namespace rendering;
 
+/// @brief Texture of a material, as given in its JSON
+struct texture_entry {
+    std::string path;       ///< Filesystem path of the texture
+    std::string variant;    ///< Name of the cached variant, empty for the plain texture
+    GLenum format;          ///< Requested storage format, 0 for the image's own
+};
+
+/// @brief Parses a texture of a material
+/// @param entry Path of the texture, or an object with its @c path and storage @c format (@c auto, @c r, @c rg, @c rgb or @c rgba)
+static texture_entry parse_texture(const nlohmann::json& entry) {
+
+    if (!entry.is_object())
+        return texture_entry{ entry.get<std::string>(), "", 0 };
+
+    /* Textures stored differently are different assets, the format names the cached variant */
+    std::string format = entry.value("format", "auto");
+    GLenum internal_format = assets::texture::parse_format(format);
+    return texture_entry{ entry.at("path").get<std::string>(), internal_format == 0 ? "" : format, internal_format };
+}
+
+/// @brief Starts loading the textures of a material in the background, up to two of them
+static std::vector<assets::loader::handle<assets::texture>> load_textures(const nlohmann::json& textures) {
+
+    std::vector<assets::loader::handle<assets::texture>> handles;
+    for (size_t i = 0; i < std::min(textures.size(), 2ul); i++) {
+        texture_entry entry = parse_texture(textures[i]);
+        handles.push_back(assets::loader::load_async_variant<assets::texture>(
+            entry.path, entry.variant, assets::loader::caching_policy::DESTROY_UNUSED, entry.format
+        ));
+    }
+
+    return handles;
+}
+
 material::material() 
-    : m_material_index(-1), m_uv_mat(glm::identity<glm::mat3x3>()) {
+    : m_uv_mat(glm::identity<glm::mat3x3>()), m_material_index(-1), m_pipeline_id(c_invalid_pipeline) {
 
     m_data.ambient =  vec3(1.0f, 0.2f, 0.6f);
     m_data.specular = vec3(0.0f, 0.0f, 0.0f);
@@ -26,10 +60,11 @@ material::material()
 
     m_data.bound_textures_count = ivec4(0);
     m_fill_empty_shaders();
+    m_pipeline_id = renderer::instance()->register_pipeline(m_shader_stages);
 }
 
 material::material(const utils::resource& res)
-    : m_material_index(-1), m_uv_mat(glm::identity<glm::mat3x3>()) {
+    : m_uv_mat(glm::identity<glm::mat3x3>()), m_material_index(-1), m_pipeline_id(c_invalid_pipeline) {
 
     using namespace glm;
     using namespace nlohmann;
@@ -48,6 +83,9 @@ material::material(const utils::resource& res)
     /* Add shaders to the empty spots */
     m_fill_empty_shaders();
 
+    /* Registered ahead of the textures, whether they are streamed depends on the pipeline reporting mip feedback */
+    m_pipeline_id = renderer::instance()->register_pipeline(m_shader_stages);
+
     /* Deserialize internal data structure */
     m_data.ambient = res.deserialize<vec3>("colors/ambient", vec3(0, 1, 1));
     m_data.diffuse = res.deserialize<vec3>("colors/diffuse", vec3(1, 1, 1));
@@ -57,21 +95,27 @@ material::material(const utils::resource& res)
     m_data.alpha = res.deserialize<float>("alpha", 1.0f);
 
     json diffuse_textures = res.deserialize<json>("textures/diffuse", {});
-    for (int i = 0; i < std::min(diffuse_textures.size(), 2ul); i++)
-        m_diffuse_textures[i] = assets::loader::load<assets::texture>(diffuse_textures[i]);
-
     json specular_textures = res.deserialize<json>("textures/specular", {});
-    for (int i = 0; i < std::min(specular_textures.size(), 2ul); i++)
-        m_specular_textures[i] = assets::loader::load<assets::texture>(specular_textures[i]);
-
     json normal_maps = res.deserialize<json>("textures/normal", {});
-    for (int i = 0; i < std::min(normal_maps.size(), 2ul); i++)
-        m_normal_maps[i] = assets::loader::load<assets::texture>(normal_maps[i]);
-
     json blend_maps = res.deserialize<json>("textures/blend", {});
-    for (int i = 0; i < std::min(blend_maps.size(), 2ul); i++)
-        m_blend_maps[i] = assets::loader::load<assets::texture>(blend_maps[i]); /* Save texture & assign handle*/
 
+    /* Loads run side by side on the loader's threads, their images are prefetched onto the image decoder as they are queued */
+    auto diffuse = load_textures(diffuse_textures);
+    auto specular = load_textures(specular_textures);
+    auto normal = load_textures(normal_maps);
+    auto blend = load_textures(blend_maps);
+
+    for (size_t i = 0; i < diffuse.size(); i++)
+        m_diffuse_textures[i] = diffuse[i].get();
+
+    for (size_t i = 0; i < specular.size(); i++)
+        m_specular_textures[i] = specular[i].get();
+
+    for (size_t i = 0; i < normal.size(); i++)
+        m_normal_maps[i] = normal[i].get();
+
+    for (size_t i = 0; i < blend.size(); i++)
+        m_blend_maps[i] = blend[i].get(); /* Save texture & assign handle*/
 
     m_data.bound_textures_count = ivec4(
         std::min(diffuse_textures.size(), 2ul),
@@ -82,7 +126,7 @@ material::material(const utils::resource& res)
 }
 
 material::material(glm::vec3 a, glm::vec3 d, glm::vec3 s, float sh, float al) 
-    : m_data({a, d, s, sh, al}), m_uv_mat(glm::identity<glm::mat3x3>()) {
+    : m_data({a, d, s, sh, al}), m_uv_mat(glm::identity<glm::mat3x3>()), m_material_index(-1), m_pipeline_id(c_invalid_pipeline) {
 }
 
 material::~material() {
@@ -91,7 +135,10 @@ material::~material() {
         return;
 
     /* Only do cleanup when material has data to clean up */
-    renderer::instance()->material_allocator().free_buffer(m_buffer_handle);
+    renderer::instance()->retire_buffer(renderer::instance()->material_allocator(), m_buffer_handle);
+
+    uint32_t material_index = m_material_index;
+    renderer::instance()->enqueue_render_task([material_index] { renderer::instance()->residency().remove_material(material_index); });
 }
 
 void material::use() {
@@ -130,6 +177,16 @@ void material::use() {
     /* Calculate index */
     m_material_index = offset / sizeof(m_data);
     m_buffer_handle = handle;
+
+    /* Textures are made resident when an object using the material is drawn */
+    uint32_t material_index = m_material_index;
+    texture_residency::material_slots slots = {
+        m_data.diffuse_texture_ids[0], m_data.diffuse_texture_ids[1],
+        m_data.specular_texture_ids[0], m_data.specular_texture_ids[1],
+        m_data.normal_map_ids[0], m_data.normal_map_ids[1],
+        m_data.blend_map_ids[0], m_data.blend_map_ids[1]
+    };
+    renderer::instance()->enqueue_render_task([material_index, slots] { renderer::instance()->residency().set_material(material_index, slots); });
 }
 
 void material::m_fill_empty_shaders() {
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <glm/glm.hpp>
@@ -23,6 +24,9 @@ namespace rendering {
     /// This class contains data for material used for phong lighting model
     class material {
 
+        public:
+            static constexpr uint16_t c_invalid_pipeline = UINT16_MAX;  ///< Pipeline of a material without shaders, such is not drawn
+
         public:
             /// @brief Default constructor
             ///
@@ -36,7 +40,7 @@ namespace rendering {
 
             /// @brief Constructor
             ///
-            /// Constructs material from provided colors/parameters
+            /// Constructs material from provided colors/parameters, it has no shaders and no pipeline
             material(glm::vec3 a, glm::vec3 d, glm::vec3 s, float sh, float al);
             ~material();
 
@@ -50,6 +54,7 @@ namespace rendering {
 
             inline bool transparent() const { return m_data.alpha < 0.95f; }
             inline int material_index() const { return m_material_index; }
+            inline uint16_t pipeline_id() const { return m_pipeline_id; }
             inline std::unordered_map<GLbitfield, std::shared_ptr<assets::shader_stage>>& shader_stages() { return m_shader_stages; }
 
         private:
@@ -87,6 +92,7 @@ namespace rendering {
             std::unordered_map<GLbitfield, std::shared_ptr<assets::shader_stage>> m_shader_stages;
             utils::gpu_allocator::handle m_buffer_handle;
             int m_material_index;
+            uint16_t m_pipeline_id;
         };
 }
 
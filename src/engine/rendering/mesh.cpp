@@ -1,3 +1,4 @@
+#include <cmath>
 #include <memory>
 #include <string_view>
 #include <utility>
@@ -17,17 +18,34 @@ REGISTER_COMPONENT(mesh_instance);
 
 mesh::mesh() 
     : m_draw_mode(GL_TRIANGLES), m_indexed(false), m_element_count(0), 
-      m_first_vertex(0), m_first_index(0) {}
+      m_first_vertex(0), m_first_index(0), 
+      m_bounds({glm::vec3(-INFINITY), glm::vec3(INFINITY)}), m_bounding_sphere(0, 0, 0, INFINITY) {}
 
 mesh::~mesh() {
-    renderer::instance()->vertex_allocator().free_buffer(m_vert_handle);
+
+    /* Frames in flight may still draw the geometry, its chunks are reused only once they are done */
+    renderer::instance()->retire_buffer(renderer::instance()->vertex_allocator(), m_vert_handle);
     
     if (m_indexed)
-        renderer::instance()->element_allocator().free_buffer(m_elem_handle);
+        renderer::instance()->retire_buffer(renderer::instance()->element_allocator(), m_elem_handle);
+}
+
+size_t mesh::m_geometry_size() const {
+
+    if (m_element_count == 0)
+        return 0;
+
+    return m_vert_handle->chunk_size + (m_indexed ? m_elem_handle->chunk_size : 0);
+}
+
+void mesh::m_set_bounds(const glm::vec3& min, const glm::vec3& max) {
+
+    m_bounds = { min, max };
+    m_bounding_sphere = vec4((min + max) * 0.5f, length(max - min) * 0.5f);
 }
 
 mesh_instance::mesh_instance(scene::scene_node* parent, const utils::resource& res)
-    : scene::node_component(parent), m_material(res.deserialize<material>("material", material())) {
+    : scene::node_component(parent), m_material(res.deserialize<material>("material", material())), m_visibility_slot(UINT32_MAX) {
 
     std::string_view type = res.deserialize<std::string_view>("mesh/type");
 
@@ -37,10 +55,11 @@ mesh_instance::mesh_instance(scene::scene_node* parent, const utils::resource& r
             res.deserialize<std::string>("mesh/path")
         ));
 
+    /* Loaded through the background path, which hands the heightmap's decode to the image decoder */
     else if (type == "displacement")
-        m_mesh = std::move(assets::loader::load<assets::displacement>(
+        m_mesh = assets::loader::load_async<assets::displacement>(
             res.deserialize<std::string>("mesh/path")
-        ));
+        ).get();
 
     else if (type == "builtin_camera")
         m_mesh = std::make_shared<camera_mesh>();
@@ -52,12 +71,21 @@ mesh_instance::mesh_instance(scene::scene_node* parent, const utils::resource& r
 }
 
 mesh_instance::mesh_instance(scene::scene_node* parent, std::shared_ptr<mesh>& drawable, const material& mat)
-    : scene::node_component(parent), m_mesh(drawable), m_material(mat) {}
+    : scene::node_component(parent), m_mesh(drawable), m_material(mat), m_visibility_slot(UINT32_MAX) {}
+
+mesh_instance::~mesh_instance() {
+
+    if (m_visibility_slot != UINT32_MAX)
+        renderer::instance()->free_visibility_slot(m_visibility_slot);
+}
 
 void mesh_instance::scene_enter() { 
 
     /* Enable material */
     m_material.use();
+
+    if (m_visibility_slot == UINT32_MAX)
+        m_visibility_slot = renderer::instance()->alloc_visibility_slot();
 }
 
 void mesh_instance::prepare_draw(const glm::mat4x4& parent_transform) {
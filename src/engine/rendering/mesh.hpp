@@ -6,9 +6,11 @@
 #include "../../lib/glad/glad.h"
 #include "material.hpp"
 #include <glm/glm.hpp>
+#include <cmath>
 #include <memory>
 #include "../scene/scene_node.hpp"
 #include "../utils/gpu_memory.hpp"
+#include "upload_queue.hpp"
 
 namespace rendering {
 
@@ -27,6 +29,12 @@ namespace rendering {
                 glm::vec2 uv;
             };
 
+            /// @brief Object-space axis aligned bounding box
+            struct bounding_box {
+                glm::vec3 min,  ///< Minimal corner of the box
+                          max;  ///< Maximal corner of the box
+            };
+
             /* Renderer manages drawing */
             virtual ~mesh();
             inline GLuint mode() const { return m_draw_mode; }
@@ -35,9 +43,30 @@ namespace rendering {
             inline GLuint first_vertex() const { return m_first_vertex; }
             inline GLuint first_index() const { return m_first_index; }
 
+            /// @brief Getter for the object-space bounding box
+            inline const bounding_box& bounds() const { return m_bounds; }
+
+            /// @brief Getter for the object-space bounding sphere
+            /// @returns Sphere packed as @c vec4, @c xyz being the center and @c w the radius
+            inline const glm::vec4& bounding_sphere() const { return m_bounding_sphere; }
+
+            /// @brief Checks whether the mesh has finite bounds
+            inline bool bounded() const { return std::isfinite(m_bounding_sphere.w); }
+
+            /// @brief Checks whether the vertices and indices are on the GPU, the mesh is not drawn before
+            inline bool ready() const { return upload_queue::ready(m_upload); }
+
         protected: 
             explicit mesh(); 
 
+            /// @brief Sets the bounding box and the bounding sphere enclosing it
+            /// @param min Minimal corner of the bounding box
+            /// @param max Maximal corner of the bounding box
+            void m_set_bounds(const glm::vec3& min, const glm::vec3& max);
+
+            /// @brief Bytes taken up by the vertices and indices in the renderer's buffers, 0 before they are allocated
+            size_t m_geometry_size() const;
+
             GLuint m_draw_mode; /* GL_LINES/GL_STRIP, etc... */
             bool m_indexed;
             GLuint m_element_count;
@@ -46,6 +75,11 @@ namespace rendering {
             utils::gpu_allocator::handle m_elem_handle;
             GLuint m_first_vertex;
             GLuint m_first_index;
+            upload_queue::ticket m_upload;  ///< Upload of the indices, queued after the vertices
+
+            /* Infinite by default, so unbounded meshes are never culled */
+            bounding_box m_bounds;
+            glm::vec4 m_bounding_sphere;
     };
     
     class mesh_instance : public scene::node_component {
@@ -53,16 +87,20 @@ namespace rendering {
         public:
             mesh_instance(scene::scene_node* parent, const utils::resource& res);    
             mesh_instance(scene::scene_node* parent, std::shared_ptr<mesh>& drawable, const material& mat);
-            ~mesh_instance() override = default;  
+            ~mesh_instance() override;  
               
             std::shared_ptr<mesh>& get_mesh() { return m_mesh; }
             material& get_material() { return m_material; }
 
+            /// @brief Slot holding the visibility of the instance in the last frame, used by occlusion culling
+            uint32_t visibility_slot() const { return m_visibility_slot; }
+
         private:
             void scene_enter() override;
             void prepare_draw(const glm::mat4x4& parent_transform) override;
 
             std::shared_ptr<mesh> m_mesh;
             material m_material;
+            uint32_t m_visibility_slot;
     };
 }
@@ -45,6 +45,11 @@ class billboard : public mesh {
             m_first_index = eles_offset / sizeof(s_billboard_indices[0]);   
             m_element_count = s_billboard_indices.size();
             m_indexed = true;
+
+            /* Billboard is rotated towards the camera, bounds must enclose every orientation */
+            float radius = glm::length(glm::vec2(6, 6));
+            m_set_bounds(glm::vec3(-radius), glm::vec3(radius));
+            m_bounding_sphere = glm::vec4(0, 0, 0, radius);
         }
 
         ~billboard() override = default;
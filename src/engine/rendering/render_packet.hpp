@@ -0,0 +1,84 @@
+///
+/// @file render_packet.hpp
+/// @author geffevil
+///
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum.hpp"
+#include "light.hpp"
+#include "../assets/cubemap.hpp"
+#include "../../lib/glad/glad.h"
+
+namespace rendering {
+
+    /// @brief Post-processing effect
+    ///
+    /// Effects are GLSL snippets defining @c vec4 @c effect(vec4 @c color, @c vec2 @c uv), returning the new color of the pixel.
+    /// Snippets are compiled into compute kernels, consecutive per-pixel effects of the same scale share one dispatch. 
+    /// Samplers @c u_source and @c u_depth, the @c camera and @c engine_frame blocks are declared by the kernel.
+    /// Effects with a non-zero radius read neighbours through @c tile_fetch(ivec2 @c offset), served from a shared-memory tile
+    struct postprocess_pass {
+        std::string source;     ///< GLSL source of the effect
+        float scale;            ///< Resolution of the effect's output, relative to the window
+        GLuint radius;          ///< Neighbourhood radius read through @c tile_fetch, 0 for per-pixel effects
+    };
+
+    /// @brief Everything the renderer needs to draw a frame
+    ///
+    /// Packets are filled by the simulation while the scene is being prepared for drawing, then handed over
+    /// to the renderer and never touched again by the simulation. All the data are copied out of the scene,
+    /// so the scene may change, or objects may be destroyed, while the renderer still draws the packet
+    struct render_packet {
+
+        /// @brief Requested draw of a mesh
+        struct draw_item {
+            glm::mat4x4 transform;      ///< Model matrix of the mesh
+            glm::mat3x3 uv;             ///< Texture coordinate transform of the material
+            glm::vec4 sphere;           ///< Object-space bounding sphere of the mesh
+            GLuint element_count;
+            GLuint first_index;
+            GLuint first_vertex;
+            int material_index;
+            uint16_t pipeline;          ///< Pipeline ID of the material
+            bool transparent;
+            uint32_t visibility_slot;
+        };
+
+        /// @brief State of the active camera
+        struct camera_state {
+            bool valid;                 ///< Whether any camera is active, nothing is drawn otherwise
+            GLuint camera_data;         ///< Uniform buffer of the camera
+            glm::mat4x4 view;
+            glm::mat4x4 projection;
+            glm::vec4 world_position;
+            float near, far;
+        };
+
+        std::vector<draw_item> draws;                   ///< Draws waiting for frustum culling
+        frustum::box_list bounds;                       ///< World-space bounds of the draws
+        std::vector<light::light_data> lights;          ///< Lights of the frame
+        camera_state camera = {};                       ///< Camera the frame is viewed through
+        std::shared_ptr<assets::cubemap> skybox;        ///< Skybox, null for none
+        std::shared_ptr<const std::vector<postprocess_pass>> postprocess;  ///< Post-processing passes, replaced whenever they change
+        std::vector<std::function<void()>> tasks;       ///< GL work which has to run on the renderer's context before drawing
+        float global_time = 0.0f;                       ///< Global clock of the runtime
+        uint32_t visibility_slots = 0;                  ///< Number of visibility slots in use
+        GLsync uploads = nullptr;                       ///< Fence of the simulation's GL work, null when drawn on the same context
+
+        /// @brief Empties the packet, keeping its storage for the next frame
+        void clear() {
+            draws.clear();
+            bounds.clear();
+            lights.clear();
+            tasks.clear();
+            skybox.reset();
+            postprocess.reset();
+            uploads = nullptr;
+        }
+    };
+}
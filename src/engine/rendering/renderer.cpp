@@ -1,6 +1,11 @@
 #include "renderer.hpp"
 
 #include <glm/detail/qualifier.hpp>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <stdexcept>
 #include <utility>
 #include <glm/glm.hpp>
@@ -10,6 +15,8 @@
 #include "mesh.hpp"
 #include "meshes/quad.hpp"
 #include "meshes/skybox.hpp"
+#include "../utils/algorithms.hpp"
+#include "../utils/cpu_profiler.hpp"
 #include "../utils/project_settings.hpp"
 #include "../runtime.hpp"
 #include "../assets/loader.hpp"
@@ -26,11 +33,165 @@ constexpr std::array<GLenum, 1> g_opaque_attachments = { GL_COLOR_ATTACHMENT0 };
 /// @brief list of active attachments for OIT
 constexpr std::array<GLenum, 2> g_transparent_attachments = { GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
 
+/// @brief bit layout of the render queue sort keys, see @c renderer::sort_entry
+constexpr uint64_t g_key_depth_bits = 24;
+constexpr uint64_t g_key_material_bits = 24;
+constexpr uint64_t g_key_pipeline_bits = 15;
+constexpr uint64_t g_key_material_shift = g_key_depth_bits;
+constexpr uint64_t g_key_pipeline_shift = g_key_material_shift + g_key_material_bits;
+constexpr uint64_t g_key_transparent_shift = g_key_pipeline_shift + g_key_pipeline_bits;
+
+/// @brief Moves a bounding sphere to world space, scaled by the largest axis scale
+static vec4 world_sphere(const vec4& sphere, const mat4x4& transform) {
+
+    float scale = glm::max(length(vec3(transform[0])), glm::max(length(vec3(transform[1])), length(vec3(transform[2]))));
+    return vec4(vec3(transform * vec4(vec3(sphere), 1.0f)), sphere.w * scale);
+}
+
+/// @brief Distance at which the light's attenuation drops below 1/256, infinite for directional lights
+static float light_range(const light::light_data& light) {
+
+    constexpr float cutoff = 256.0f;
+
+    if (light.type == light::light_type::DIRECTIONAL)
+        return INFINITY;
+
+    /* Attenuated below the cutoff at its very position, the light never reaches anything */
+    if (light.constant >= cutoff)
+        return 0.0f;
+
+    /* Solve quadratic * d^2 + linear * d + constant = cutoff */
+    if (light.quadratic <= 0.0f)
+        return light.linear > 0.0f ? (cutoff - light.constant) / light.linear : INFINITY;
+
+    float discriminant = std::max(light.linear * light.linear - 4.0f * light.quadratic * (light.constant - cutoff), 0.0f);
+    return (-light.linear + std::sqrt(discriminant)) / (2.0f * light.quadratic);
+}
+
+/// @brief initial number of objects the per-frame buffers can hold, grown on demand
+constexpr size_t g_initial_object_capacity = 1024;
+
+/// @brief initial number of lights the per-frame light buffer can hold, grown on demand
+constexpr size_t g_initial_light_capacity = 256;
+
+/// @brief distance between per-pass uniform slots, the largest uniform buffer offset alignment the spec permits
+constexpr size_t g_pass_uniform_stride = 256;
+
+/// @brief initial number of per-pass uniform slots, grown on demand
+constexpr size_t g_initial_pass_capacity = 16;
+
+/// @brief number of light clusters along the screen's x and y and the view depth
+constexpr glm::uvec3 g_cluster_grid = glm::uvec3(16, 9, 24);
+
+/// @brief capacity of a cluster's light list, lights beyond it are dropped
+constexpr GLuint g_max_lights_per_cluster = 128;
+
+/// @brief edge of the post-processing work groups and tiles
+constexpr GLuint g_postprocess_tile = 16;
+
+/// @brief declarations shared by all the post-processing kernels
+constexpr const char* g_postprocess_header = R"(#version 460 core
+
+layout (local_size_x = 16, local_size_y = 16) in;
+layout (rgba8, binding = 0) uniform restrict writeonly image2D u_destination;
+
+layout (std140, binding = 2) uniform camera {
+    mat4x4 u_mat_projection;
+    mat4x4 u_mat_view;
+    vec4   u_camera_position;
+    vec4   u_clip_planes;
+};
+
+layout (std140, binding = 9) uniform engine_frame {
+    float u_global_time;
+    uint  u_light_count;
+    uint  u_frame_number;
+    vec2  u_resolution;
+    vec2  u_cluster_depth;
+    uvec4 u_cluster_grid;
+};
+
+uniform sampler2D u_source;
+uniform sampler2D u_depth;
+)";
+
+/// @brief Generates a compute kernel running the effects one after another on every pixel
+/// @param passes Effects to be fused, only the first one may read neighbours
+static string postprocess_kernel(const vector<const postprocess_pass*>& passes) {
+
+    GLuint radius = passes.front()->radius;
+    string source = g_postprocess_header;
+
+    if (radius > 0) {
+        source += "\nconst int TILE_RADIUS = " + to_string(radius) + ";\n"
+                  "const int TILE_SIZE = " + to_string(g_postprocess_tile + 2 * radius) + ";\n"
+                  "shared vec4 s_tile[TILE_SIZE * TILE_SIZE];\n\n"
+                  "vec4 tile_fetch(ivec2 offset) {\n"
+                  "    ivec2 t = ivec2(gl_LocalInvocationID.xy) + TILE_RADIUS + offset;\n"
+                  "    return s_tile[t.y * TILE_SIZE + t.x];\n"
+                  "}\n";
+    }
+
+    /* Every effect gets its own name */
+    for (size_t i = 0; i < passes.size(); i++)
+        source += "\n#define effect effect_" + to_string(i) + "\n" + passes[i]->source + "\n#undef effect\n";
+
+    source += "\nvoid main() {\n\n"
+              "    ivec2 size = imageSize(u_destination);\n"
+              "    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+              "    vec2 texel_size = 1.0 / vec2(size);\n"
+              "    vec2 uv = (vec2(texel) + 0.5) * texel_size;\n";
+
+    /* Neighbourhood is fetched once per tile, instead of once per reading pixel */
+    if (radius > 0) {
+        source += "\n    ivec2 origin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) - TILE_RADIUS;\n"
+                  "    for (int i = int(gl_LocalInvocationIndex); i < TILE_SIZE * TILE_SIZE; i += int(gl_WorkGroupSize.x * gl_WorkGroupSize.y))\n"
+                  "        s_tile[i] = textureLod(u_source, (vec2(origin + ivec2(i % TILE_SIZE, i / TILE_SIZE)) + 0.5) * texel_size, 0.0);\n"
+                  "    barrier();\n";
+    }
+
+    source += "\n    if (any(greaterThanEqual(texel, size)))\n"
+              "        return;\n\n";
+    source += radius > 0 
+        ? "    vec4 color = tile_fetch(ivec2(0));\n" 
+        : "    vec4 color = textureLod(u_source, uv, 0.0);\n";
+
+    for (size_t i = 0; i < passes.size(); i++)
+        source += "    color = effect_" + to_string(i) + "(color, uv);\n";
+
+    source += "\n    imageStore(u_destination, texel, color);\n}\n";
+    return source;
+}
+
 renderer::renderer() 
-    : m_vertex_buffer(gpu_allocator(project_settings::gpu_geometry_buffer_alloc_size())), 
+    : m_prepass_pipeline(0), m_depth_prepass(false), m_overdraw_queried({}), m_frame_timed({}),
+      m_resolution_scaler(1.0f, 1.0f, 0.0f), m_render_size(0, 0),
+      m_build_packet(0), m_packet_pending(false), m_stop_rendering(false), m_mip_feedback(false), m_submitted_packets(0),
+      m_cull_counts({0, 0, 0}),
+      m_visibility_slot_count(0),
+      m_statistics({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1.0f}),
+      m_published_statistics(m_statistics),
+      m_vertex_buffer(gpu_allocator(project_settings::gpu_geometry_buffer_alloc_size())), 
       m_element_buffer(gpu_allocator(project_settings::gpu_geometry_buffer_alloc_size())),
       m_material_buffer(gpu_allocator(project_settings::gpu_material_buffer_alloc_size())),
-      m_texture_buffer(gpu_allocator(project_settings::gpu_textures_buffer_alloc_size())) { }
+      m_texture_buffer(gpu_allocator(project_settings::gpu_textures_buffer_alloc_size())),
+      m_texture_residency(project_settings::texture_budget(), gpu_frame_sync::c_frames_in_flight),
+      m_texture_streamer(project_settings::texture_stream_tail(), gpu_frame_sync::c_frames_in_flight),
+      m_uploads(project_settings::upload_staging_size()),
+      m_cull_input(g_initial_object_capacity * sizeof(cull_instance)),
+      m_cull_batches(g_initial_object_capacity * sizeof(cull_batch)),
+      m_object_storage(g_initial_object_capacity * sizeof(draw_request::object_data)),
+      m_light_storage(g_initial_light_capacity * sizeof(light::light_data)),
+      m_light_bounds(g_initial_light_capacity * sizeof(vec4)),
+      m_frame_uniforms(sizeof(frame_uniforms)),
+      m_pass_uniforms(g_initial_pass_capacity * g_pass_uniform_stride),
+      m_frame_number(0),
+      m_draw_cmd_queue(0), m_draw_count_buffer(0),
+      m_culled_objects(0), m_batch_counts(0), m_visibility(0),
+      m_light_grid(0), m_light_indices(0),
+      m_draw_cmd_capacity(0), m_draw_count_capacity(0),
+      m_culled_objects_capacity(0), m_batch_counts_capacity(0), m_visibility_capacity(0),
+      m_light_grid_capacity(0), m_light_index_capacity(0) { }
 
 void renderer::init() {
 
@@ -48,6 +209,25 @@ void renderer::init() {
 
     s_instance = this;
     glGenProgramPipelines(1, &m_pipeline);
+    glGenProgramPipelines(1, &m_prepass_pipeline);
+
+    /* Overdraw is measured every frame, results are read once the frame's fence is passed */
+    m_depth_prepass = project_settings::depth_prepass();
+    glGenQueries(m_prepass_queries.size(), m_prepass_queries.data());
+    glGenQueries(m_shading_queries.size(), m_shading_queries.data());
+    glGenQueries(m_timer_queries.size(), m_timer_queries.data());
+
+    /* Per-pass GPU times, optionally dumped every frame */
+    m_gpu_profiler.init();
+    if (!project_settings::gpu_profile_path().empty())
+        m_gpu_profiler.open_csv(project_settings::gpu_profile_path());
+
+    /* Main target is rendered at a scale, picked from the measured GPU frame time */
+    m_resolution_scaler = resolution_scaler(
+        project_settings::min_resolution_scale(), 
+        project_settings::max_resolution_scale(), 
+        project_settings::target_frame_time()
+    );
 
     /* Setup quad */
     auto [q_handle, q_offset] = m_vertex_buffer.alloc_buffer(sizeof(c_quad_mesh));
@@ -66,7 +246,14 @@ void renderer::init() {
     m_combination_shader = loader::load<shader_stage>("shaders/combination.frag");
     m_skybox_vertex_shader = loader::load<shader_stage>("shaders/skybox.vert");
     m_skybox_fragment_shader = loader::load<shader_stage>("shaders/skybox.frag");
-    
+    m_culling_shader = loader::load<shader_stage>("shaders/culling.comp");
+    m_compaction_shader = loader::load<shader_stage>("shaders/compact_commands.comp");
+    m_depth_pyramid_shader = loader::load<shader_stage>("shaders/depth_pyramid.comp");
+    m_light_cluster_shader = loader::load<shader_stage>("shaders/light_clusters.comp");
+    m_prepass_shader = loader::load<shader_stage>("shaders/depth_prepass.vert");
+
+    /* Depth prepass has no fragment stage, only depth is written */
+    glUseProgramStages(m_prepass_pipeline, GL_VERTEX_SHADER_BIT, static_cast<GLuint>(*m_prepass_shader));
 
     for (const auto& stage_path : project_settings::default_shaders()) {
 
@@ -92,17 +279,25 @@ void renderer::init() {
     /* Bind Texture and Model budder */
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_SSBO, m_material_buffer.buffer());
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TEXTURE_SSBO, m_texture_buffer.buffer());
-
-    /* Create Draw command queue */
-    glCreateBuffers(1, &m_draw_cmd_queue);
-
-    /* Create dynamic object data storage */
-    glCreateBuffers(1, &m_object_storage);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_SSBO, m_object_storage);
-
-    /* Create light buffer */
-    glCreateBuffers(1, &m_light_storage);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_SSBO, m_light_storage);
+    if (texture_array_pool::enabled()) {
+        std::cerr << "[INFO] Bindless textures unavailable, textures are packed into texture arrays" << std::endl;
+        m_texture_arrays.init(m_texture_buffer.buffer());
+    }
+    else
+        m_texture_residency.init(m_texture_buffer.buffer());
+    m_texture_streamer.init(m_texture_buffer.buffer_size() / sizeof(GLuint64), MIP_FEEDBACK_SSBO);
+
+    /* Create Draw command queue, counters and culled object data, filled by the culling pass. Culling input, object and light data live in ring buffers, bound per-frame */
+    m_reserve_gpu_buffer(m_draw_cmd_queue, m_draw_cmd_capacity, 2 * g_initial_object_capacity * sizeof(draw_request::draw_command), DRAW_COMMAND_SSBO);
+    m_reserve_gpu_buffer(m_draw_count_buffer, m_draw_count_capacity, 2 * g_initial_pass_capacity * sizeof(GLuint), DRAW_COUNT_SSBO);
+    m_reserve_gpu_buffer(m_culled_objects, m_culled_objects_capacity, 2 * g_initial_object_capacity * sizeof(draw_request::object_data), OBJECT_SSBO);
+    m_reserve_gpu_buffer(m_batch_counts, m_batch_counts_capacity, 2 * g_initial_object_capacity * sizeof(GLuint), BATCH_COUNT_SSBO);
+    m_reserve_gpu_buffer(m_visibility, m_visibility_capacity, g_initial_object_capacity * sizeof(GLuint), VISIBILITY_SSBO, true);
+
+    /* Create light clusters, filled by the clustering pass */
+    GLuint cluster_count = g_cluster_grid.x * g_cluster_grid.y * g_cluster_grid.z;
+    m_reserve_gpu_buffer(m_light_grid, m_light_grid_capacity, cluster_count * sizeof(GLuint), LIGHT_GRID_SSBO);
+    m_reserve_gpu_buffer(m_light_indices, m_light_index_capacity, cluster_count * g_max_lights_per_cluster * sizeof(GLuint), LIGHT_INDEX_SSBO);
 
     /* Clear the screen */
     glClearColor(0, 0, 0, 1);
@@ -110,14 +305,29 @@ void renderer::init() {
 
 renderer::~renderer() {
 
+    stop_render_thread();
+
     for (auto& [type, stage] : m_attached_shader_stages)
         glUseProgramStages(m_pipeline, type, 0);
 
     glDeleteProgramPipelines(1, &m_pipeline);
+    glDeleteProgramPipelines(1, &m_prepass_pipeline);
+    glDeleteQueries(m_prepass_queries.size(), m_prepass_queries.data());
+    glDeleteQueries(m_shading_queries.size(), m_shading_queries.data());
+    glDeleteQueries(m_timer_queries.size(), m_timer_queries.data());
 
     m_vertex_buffer.free_buffer(m_quad_handle);
     m_vertex_buffer.free_buffer(m_skybox_handle);
 
+    /* Destroy per-frame buffers */
+    glDeleteBuffers(1, &m_draw_cmd_queue);
+    glDeleteBuffers(1, &m_draw_count_buffer);
+    glDeleteBuffers(1, &m_culled_objects);
+    glDeleteBuffers(1, &m_batch_counts);
+    glDeleteBuffers(1, &m_visibility);
+    glDeleteBuffers(1, &m_light_grid);
+    glDeleteBuffers(1, &m_light_indices);
+
     /* Destroy FBOs */
     m_destroy_fbos();
 
@@ -125,12 +335,24 @@ renderer::~renderer() {
     s_instance = nullptr; 
 }
 
-renderer::pp_pass_handle renderer::add_postprocess_pass(const shared_ptr<shader_stage>& shader) {
+renderer::pp_pass_handle renderer::add_postprocess_pass(const std::string& path, float scale, GLuint radius) {
+
+    if (scale <= 0.0f)
+        throw logic_error("Post-processing pass scale has to be positive!");
+
+    ifstream effect_file = ifstream(path, ios::in);
+    if (!effect_file.is_open())
+        throw runtime_error("Unable to open post-processing effect " + path);
 
-    if (shader->type_bitmask() != GL_FRAGMENT_SHADER_BIT)
-        throw logic_error("Provided shader is not a fragment shader!");
+    string source = string(istreambuf_iterator<char>(effect_file), istreambuf_iterator<char>());
+    if (!effect_file.eof() && effect_file.fail())
+        throw runtime_error("Unable to read from post-processing effect " + path);
 
-    return m_postprocess_passes.emplace(m_postprocess_passes.end(), shader);
+    auto handle = m_postprocess_passes.emplace(m_postprocess_passes.end(), postprocess_pass{source, scale, radius});
+
+    /* Chain is rebuilt by the renderer once a packet carries the new passes */
+    m_postprocess_snapshot = make_shared<const vector<postprocess_pass>>(m_postprocess_passes.begin(), m_postprocess_passes.end());
+    return handle;
 }
 
 void renderer::remove_postprocess_pass(const renderer::pp_pass_handle& index) {
@@ -141,6 +363,9 @@ void renderer::remove_postprocess_pass(const renderer::pp_pass_handle& index) {
     }
 
     m_postprocess_passes.erase(index);
+    m_postprocess_snapshot = m_postprocess_passes.empty() 
+        ? nullptr 
+        : make_shared<const vector<postprocess_pass>>(m_postprocess_passes.begin(), m_postprocess_passes.end());
 }
 
 void renderer::set_active_camera(const utils::observer_ptr<camera>& camera) {
@@ -148,78 +373,435 @@ void renderer::set_active_camera(const utils::observer_ptr<camera>& camera) {
     if (!camera.valid() || m_active_camera == camera)
         return;
 
+    /* Camera's buffer is bound when drawing, bindings belong to the renderer's context */
     m_active_camera = camera;
-    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO, camera->camera_data());
 } 
 
 void renderer::set_active_skybox(const std::shared_ptr<assets::cubemap>& skybox) {
 
     m_current_skybox = skybox;
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->cubemap_object());
+}
+
+uint32_t renderer::alloc_visibility_slot() {
+
+    if (m_free_visibility_slots.empty())
+        return m_visibility_slot_count++;
+
+    uint32_t slot = m_free_visibility_slots.back();
+    m_free_visibility_slots.pop_back();
+    return slot;
+}
+
+void renderer::free_visibility_slot(uint32_t slot) {
+
+    m_free_visibility_slots.push_back(slot);
 }
 
 void renderer::request_draw(const observer_ptr<mesh_instance>& mesh_instance, const glm::mat4x4& transform) {
 
-    /* If mesh is invalid, there is no point in drawing it */
-    if (!mesh_instance.valid())
+    /* If mesh is invalid, there is no point in drawing it, nor in drawing geometry still on its way to the GPU */
+    if (!mesh_instance.valid() || !mesh_instance->get_mesh()->ready())
+        return;
+
+    /* Materials without a pipeline have no shaders to be drawn with */
+    const auto& material = mesh_instance->get_material();
+    if (material.pipeline_id() == material::c_invalid_pipeline)
+        return;
+
+    /* Everything the renderer needs is copied, the instance may be gone by the time the packet is drawn */
+    const auto& mesh = mesh_instance->get_mesh();
+    render_packet& packet = m_packets[m_build_packet];
+
+    packet.draws.push_back(render_packet::draw_item{
+        transform,
+        material.uv_mat(),
+        mesh->bounding_sphere(),
+        mesh->element_count(),
+        mesh->first_index(),
+        mesh->first_vertex(),
+        material.material_index(),
+        material.pipeline_id(),
+        material.transparent(),
+        mesh_instance->visibility_slot()
+    });
+
+    /* Unbounded meshes get a box large enough to always pass, yet finite so no NaNs show up */
+    if (!mesh->bounded()) {
+        packet.bounds.push_back(vec3(transform[3]), vec3(FLT_MAX));
+        return;
+    }
+
+    /* Transform the box to world space (Arvo) - center is transformed, extent projected on the world axes */
+    vec3 center = (mesh->bounds().min + mesh->bounds().max) * 0.5f;
+    vec3 extent = (mesh->bounds().max - mesh->bounds().min) * 0.5f;
+    mat3x3 abs_transform = mat3x3(transform);
+
+    for (int i = 0; i < 3; i++)
+        abs_transform[i] = abs(abs_transform[i]);
+
+    packet.bounds.push_back(vec3(transform * vec4(center, 1.0f)), abs_transform * extent);
+}
+
+void renderer::enqueue_render_task(std::function<void()> task) {
+
+    if (!m_render_thread.joinable()) {
+        task();
+        return;
+    }
+
+    m_packets[m_build_packet].tasks.push_back(std::move(task));
+}
+
+void renderer::retire_buffer(utils::gpu_allocator& allocator, const utils::gpu_allocator::handle& handle) {
+
+    m_retired_chunks.push_back(retired_chunk{ &allocator, handle, m_submitted_packets });
+}
+
+void renderer::submit_frame() {
+
+    PROFILE_ZONE("renderer::submit_frame");
+
+    /* Two packets back was drawn by now, frames in flight before it were waited for. Chunks retired since may be reused */
+    auto expired = std::remove_if(m_retired_chunks.begin(), m_retired_chunks.end(), [this](const retired_chunk& chunk) {
+        if (chunk.packet + gpu_frame_sync::c_frames_in_flight + 2 > m_submitted_packets)
+            return false;
+
+        chunk.allocator->free_buffer(chunk.handle);
+        return true;
+    });
+    m_retired_chunks.erase(expired, m_retired_chunks.end());
+    m_submitted_packets++;
+
+    /* Assets whose uploads finished queue their render tasks into this packet */
+    m_uploads.poll();
+    render_packet& packet = m_packets[m_build_packet];
+
+    /* Renderer state set up by the scene, captured as it is at the end of the frame */
+    packet.camera = render_packet::camera_state{};
+    if (m_active_camera.valid()) {
+        packet.camera = render_packet::camera_state{
+            true,
+            m_active_camera->camera_data(),
+            m_active_camera->view(),
+            m_active_camera->projection(),
+            m_active_camera->world_position(),
+            m_active_camera->near(),
+            m_active_camera->far()
+        };
+    }
+
+    packet.skybox = m_current_skybox;
+    packet.postprocess = m_postprocess_snapshot;
+    packet.global_time = engine_runtime::instance()->global_clock();
+    packet.visibility_slots = m_visibility_slot_count;
+
+    if (!m_render_thread.joinable()) {
+        m_present(packet);
+        packet.clear();
+        return;
+    }
+
+    /* Uploads issued on the simulation's context have to land before the renderer reads them */
+    packet.uploads = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    {
+        /* Only one packet is drawn at a time, the other one is being filled */
+        std::unique_lock<std::mutex> lock(m_packet_mutex);
+        m_packet_drawn.wait(lock, [this] { return !m_packet_pending; });
+
+        if (m_render_error) {
+            glDeleteSync(packet.uploads);
+            std::rethrow_exception(std::exchange(m_render_error, nullptr));
+        }
+
+        m_packet_pending = true;
+        m_build_packet ^= 1;
+    }
+
+    m_packet_submitted.notify_one();
+}
+
+void renderer::start_render_thread() {
+
+    if (m_render_thread.joinable())
+        return;
+
+    m_stop_rendering = false;
+    m_render_thread = std::thread(&renderer::m_render_loop, this);
+}
+
+void renderer::stop_render_thread() {
+
+    if (!m_render_thread.joinable())
         return;
 
+    {
+        std::lock_guard<std::mutex> lock(m_packet_mutex);
+        m_stop_rendering = true;
+    }
+
+    m_packet_submitted.notify_one();
+    m_render_thread.join();
+
+    /* Tasks queued after the last submitted frame still have to run on the window's context */
+    engine_runtime::instance()->window().make_current();
+    m_render_error = nullptr;
+    for (auto& task : m_packets[m_build_packet].tasks)
+        task();
+    m_packets[m_build_packet].tasks.clear();
+}
+
+renderer::frame_statistics renderer::statistics() const {
+
+    std::lock_guard<std::mutex> lock(m_packet_mutex);
+    return m_published_statistics;
+}
+
+void renderer::m_render_loop() {
+
+    game_window& window = engine_runtime::instance()->window();
+    window.make_current();
+
+    while (true) {
+
+        size_t packet_index;
+        {
+            std::unique_lock<std::mutex> lock(m_packet_mutex);
+            m_packet_submitted.wait(lock, [this] { return m_packet_pending || m_stop_rendering; });
+
+            /* Pending packet is drawn even when stopping, the simulation may wait for it */
+            if (!m_packet_pending)
+                break;
+
+            packet_index = m_build_packet ^ 1;
+        }
+
+        std::exception_ptr error = nullptr;
+        try {
+            m_present(m_packets[packet_index]);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        m_packets[packet_index].clear();
+        {
+            std::lock_guard<std::mutex> lock(m_packet_mutex);
+            m_packet_pending = false;
+            m_render_error = error;
+        }
+
+        m_packet_drawn.notify_one();
+
+        /* Error is rethrown on the simulation thread by the next submit */
+        if (error)
+            break;
+    }
+
+    window.release_current();
+}
+
+void renderer::m_present(render_packet& packet) {
+
+    if (packet.uploads != nullptr) {
+        glWaitSync(packet.uploads, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(packet.uploads);
+        packet.uploads = nullptr;
+    }
+
+    for (auto& task : packet.tasks)
+        task();
+
+    m_draw_scene(packet);
+    engine_runtime::instance()->window().swap_buffers();
+
+    std::lock_guard<std::mutex> lock(m_packet_mutex);
+    m_published_statistics = m_statistics;
+}
+
+void renderer::m_cull_pending_draws(const render_packet& packet) {
+
+    /* Only the visible draws pay for the normal matrix and the queue insertion */
+    vector<uint32_t> visible;
+    visible.reserve(packet.draws.size());
+
+    const mat4x4& view = packet.camera.view;
+    frustum(packet.camera.projection * view).cull(packet.bounds, visible);
+
+    m_enqueued_objects.reserve(visible.size());
+    m_sort_entries.reserve(visible.size());
+
+    /* Depth of the object's origin, normalized to the far plane */
+    float inv_far = 1.0f / packet.camera.far;
+    for (uint32_t index : visible) {
+        const auto& draw = packet.draws[index];
+        m_enqueue_draw(draw, -(view * draw.transform[3]).z * inv_far);
+    }
+
+    m_statistics.visible_objects = visible.size();
+    m_statistics.culled_objects = packet.draws.size() - visible.size();
+}
+
+void renderer::m_enqueue_draw(const render_packet::draw_item& draw, float depth) {
+
+    const auto& transform = draw.transform;
+
     /* Create draw request */
     draw_request req = {
         draw_request::draw_command{
-            mesh_instance->get_mesh()->element_count(),
-            1, /* No instancing RN */
-            mesh_instance->get_mesh()->first_index(),
-            static_cast<int>(mesh_instance->get_mesh()->first_vertex()),
-            0 /* No instancing RN */
+            draw.element_count,
+            1, /* Merged with draws of the same mesh when preparing the draw */
+            draw.first_index,
+            static_cast<int>(draw.first_vertex),
+            0 /* Index of the object data, assigned when preparing the draw */
         },
         draw_request::object_data{
             transform,
             glm::transpose(glm::inverse(transform)),
-            mesh_instance->get_material().uv_mat(),
-            mesh_instance->get_material().material_index()
+            draw.uv,
+            draw.material_index
         },
-        mesh_instance->get_material().transparent(),
-        mesh_instance->get_material().shader_stages()  
+        world_sphere(draw.sphere, transform),
+        draw.visibility_slot
     };
 
-    /* Insert into list */
-    m_enqueued_objects.insert(std::move(req), 
-        static_cast<GLuint>(*mesh_instance->get_material().shader_stages().at(shader_stage::c_known_stage_types[1])), 
-        static_cast<GLuint>(*mesh_instance->get_material().shader_stages().at(shader_stage::c_known_stage_types[1]))
-    );
+    /* Opaque objects go front to back within their pipeline and material, helping the early-z. */
+    /* Transparent objects are sorted the same way - the blending is order independent */
+    constexpr uint64_t depth_max = (1ull << g_key_depth_bits) - 1;
+    uint64_t depth_bucket = static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * depth_max);
+
+    uint64_t key = (static_cast<uint64_t>(draw.transparent) << g_key_transparent_shift)
+                 | (static_cast<uint64_t>(draw.pipeline) << g_key_pipeline_shift)
+                 | ((static_cast<uint64_t>(draw.material_index) & ((1ull << g_key_material_bits) - 1)) << g_key_material_shift)
+                 | depth_bucket;
+
+    m_texture_residency.mark_material(draw.material_index, m_frame_number);
+    m_sort_entries.push_back(sort_entry{key, static_cast<uint32_t>(m_enqueued_objects.size())});
+    m_enqueued_objects.push_back(std::move(req));
+}
+
+uint16_t renderer::register_pipeline(const shader_map& stages) {
+
+    /* Materials are loaded by the simulation while the renderer binds the pipelines */
+    std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+    for (size_t id = 0; id < m_pipelines.size(); id++) {
+        if (m_pipelines[id] == stages)
+            return static_cast<uint16_t>(id);
+    }
+
+    if (m_pipelines.size() >= (1ull << g_key_pipeline_bits))
+        throw runtime_error("Too many shader stage combinations, at most " + to_string(1ull << g_key_pipeline_bits) + " are supported!");
+
+    m_pipelines.push_back(stages);
+
+    /* Textures loaded from now on rely on the feedback for their finer levels */
+    for (const auto& [type, stage] : stages)
+        if (stage && stage->declares_storage(MIP_FEEDBACK_SSBO))
+            m_mip_feedback = true;
+
+    return static_cast<uint16_t>(m_pipelines.size() - 1);
+}
+
+uint32_t renderer::texture_stream_tail() const {
+
+    return m_mip_feedback ? project_settings::texture_stream_tail() : 0;
 }
 
 /* This... this is gonna be a big one */
-void renderer::draw_scene() {
+void renderer::m_draw_scene(const render_packet& packet) {
+
+    PROFILE_ZONE("renderer::draw_scene");
 
     //===============================
     // SETUP - Prepare rendering
     //===============================
 
-    /* No valid camera bound or nothing to draw, end the draw function */
-    if (!m_active_camera.valid() || m_enqueued_objects.empty())
+    /* Every drawn packet counts, including those which end early with nothing to draw */
+    m_frame_number++;
+
+    /* Wait until GPU releases this frame's part of the ring buffers */
+    m_frame_sync.begin_frame();
+    m_statistics.fence_wait_ns = m_frame_sync.statistics().last_wait_ns;
+    m_statistics.draw_calls = 0;
+    m_statistics.triangles = 0;
+    m_collect_queries();
+    m_gpu_profiler.begin_frame(m_frame_sync.frame_index(), m_frame_number);
+    m_texture_streamer.begin_frame(m_frame_sync.frame_index(), m_frame_number, m_texture_residency);
+    m_texture_arrays.bind();
+
+    /* Post-processing passes changed, recompile the chain */
+    if (packet.postprocess != m_built_postprocess) {
+        m_built_postprocess = packet.postprocess;
+        m_build_postprocess_chain();
+    }
+
+    /* Timer spans the whole frame, ended in m_end_draw */
+    glBeginQuery(GL_TIME_ELAPSED, m_timer_queries[m_frame_sync.frame_index()]);
+    m_frame_timed[m_frame_sync.frame_index()] = true;
+
+    /* No valid camera bound, end the draw function */
+    if (!packet.camera.valid) {
+        m_end_draw();
         return;
+    }
 
-    /* Update view matrix uniform */
-    glNamedBufferSubData(
-        m_active_camera->camera_data(), 
-        sizeof(mat4x4), sizeof(mat4x4), 
-        glm::value_ptr(m_active_camera->view())
-    );
+    /* Throw away everything outside of the view */
+    m_cull_pending_draws(packet);
+
+    /* Textures of the visible materials have to be resident before the draws are issued */
+    m_texture_residency.update(m_frame_number);
+    m_statistics.resident_texture_bytes = texture_array_pool::enabled() ? m_texture_arrays.memory_size() : m_texture_residency.statistics().resident_bytes;
+    m_statistics.texture_evictions = m_texture_residency.statistics().evictions;
+
+    /* Nothing to draw, end the draw function */
+    if (m_enqueued_objects.empty()) {
+        m_end_draw();
+        return;
+    }
+
+    /* Update the camera block - projection, view, world position and clip planes */
+    const render_packet::camera_state& camera = packet.camera;
+    const std::array<mat4x4, 2> camera_matrices = { camera.projection, camera.view };
+    const std::array<vec4, 2> camera_vectors = { camera.world_position, vec4(camera.near, camera.far, 0.0f, 0.0f) };
+    glNamedBufferSubData(camera.camera_data, 0, sizeof(camera_matrices), camera_matrices.data());
+    glNamedBufferSubData(camera.camera_data, sizeof(camera_matrices), sizeof(camera_vectors), camera_vectors.data());
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO, camera.camera_data);
 
     /* Prepare object data for drawing */
     std::vector<render_pass> draw_passes;
-    m_prepare_drawing(draw_passes);
+    m_prepare_drawing(draw_passes, packet);
 
     /* Update light data  & prepare for drawing */
-    glNamedBufferData(m_light_storage, m_lights.size() * sizeof(m_lights[0]), m_lights.data(), GL_DYNAMIC_DRAW);
+    const auto& lights = packet.lights;
+    size_t light_bytes = lights.size() * sizeof(light::light_data);
+    memcpy(m_light_storage.frame_data(m_frame_sync.frame_index(), light_bytes), lights.data(), light_bytes);
+    m_light_storage.bind_range(GL_SHADER_STORAGE_BUFFER, LIGHTS_SSBO, m_frame_sync.frame_index());
+
+    /* Bounds of the lights in view space, used to bin them into clusters */
+    vec4* light_bounds = static_cast<vec4*>(m_light_bounds.frame_data(m_frame_sync.frame_index(), lights.size() * sizeof(vec4)));
+    for (size_t i = 0; i < lights.size(); i++)
+        light_bounds[i] = vec4(vec3(camera.view * vec4(lights[i].position, 1.0f)), light_range(lights[i]));
+
+    m_light_bounds.bind_range(GL_SHADER_STORAGE_BUFFER, LIGHT_BOUNDS_SSBO, m_frame_sync.frame_index());
+
+    /* Engine uniforms, written once for the whole frame */
+    m_upload_uniforms(draw_passes, packet);
+
+    m_statistics.commands_saved = m_enqueued_objects.size() - m_cull_counts.batches;
+
+    /* Drop everything outside of the frustum or not visible last frame, before any vertex work is done */
+    m_gpu_profiler.begin_zone("culling");
+    m_cull_draws(LAST_VISIBLE_PHASE);
+    m_gpu_profiler.end_zone();
+
+    m_gpu_profiler.begin_zone("light clusters");
+    m_build_light_clusters();
+    m_gpu_profiler.end_zone();
+
     glBindProgramPipeline(m_pipeline);
     glBindVertexArray(m_models_vao);
     glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_cmd_queue);
- 
-    GLuint objects_drawn = 0;
-    auto pass = draw_passes.begin();
+    glBindBuffer(GL_PARAMETER_BUFFER, m_draw_count_buffer);
 
     /* Clean the fbo's depth */
     glClearNamedFramebufferfi(m_default_target.fbo, GL_DEPTH_STENCIL, 0, 1.0f, 0.0f);
@@ -230,6 +812,7 @@ void renderer::draw_scene() {
 
     /* Bind default FBO */
     glBindFramebuffer(GL_FRAMEBUFFER, m_default_target.fbo);
+    glViewport(0, 0, m_render_size.x, m_render_size.y);
 
     /* Enable only opaque attachment for drawing and clear it */
     glNamedFramebufferDrawBuffers(m_default_target.fbo, g_opaque_attachments.size(), g_opaque_attachments.data());
@@ -241,31 +824,9 @@ void renderer::draw_scene() {
     glEnable(GL_BLEND);
     glBlendFunci(0, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    /* Itterate over draw passes and draw them */
-    for (; pass != draw_passes.end(); ++pass) {
-        
-        /* Upon reaching the first transparent pass, end this step */
-        if (pass->transparent)
-            break;
-
-        /* Bind shader delta */
-        for (const auto& stage : pass->shader_delta)
-            attach_stage(stage);
-
-        /* Set uniforms correctly - Only TWO (engine) uniforms per shader! */
-        set_uniform("draw_id_offset", objects_drawn, GL_VERTEX_SHADER_BIT);
-        set_uniform("light_count", static_cast<uint>(m_lights.size()), GL_FRAGMENT_SHADER_BIT);
-        set_uniform("global_time", engine_runtime::instance()->global_clock());
-
-        /* Draw! */
-        glMultiDrawElementsIndirect(
-            GL_TRIANGLES, GL_UNSIGNED_INT, 
-            reinterpret_cast<void*>(objects_drawn * sizeof(draw_request::draw_command)), 
-            pass->object_count, 0
-        );
-
-        objects_drawn += pass->object_count;
-    }
+    m_gpu_profiler.begin_zone("opaque");
+    m_draw_opaque_passes(draw_passes);
+    m_gpu_profiler.end_zone();
 
     //===============================
     // PASS 2 - Transparent objects
@@ -278,30 +839,14 @@ void renderer::draw_scene() {
 
     /* Set appropriate OpenGL state */
     glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LESS);
     glBlendFunci(0, GL_ONE, GL_ONE);
     glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
 
-    /* Draw the rest of the passes */
-    for (; pass != draw_passes.end(); ++pass) {
-    
-        /* Bind shader delta */
-        for (const auto& stage : pass->shader_delta)
-            attach_stage(stage);
-
-        /* Set uniforms correctly - Only TWO (engine) uniforms per shader! */
-        set_uniform("draw_id_offset", objects_drawn, GL_VERTEX_SHADER_BIT);
-        set_uniform("light_count", static_cast<uint>(m_lights.size()), GL_FRAGMENT_SHADER_BIT);
-        set_uniform("global_time", engine_runtime::instance()->global_clock());
-
-        /* Draw! */
-        glMultiDrawElementsIndirect(
-            GL_TRIANGLES, GL_UNSIGNED_INT, 
-            reinterpret_cast<void*>(objects_drawn * sizeof(draw_request::draw_command)), 
-            pass->object_count, 0
-        );
-
-        objects_drawn += pass->object_count;
-    }
+    /* Transparent objects are all tested against the depth pyramid */
+    m_gpu_profiler.begin_zone("transparent");
+    m_draw_passes(draw_passes, true, OCCLUSION_PHASE);
+    m_gpu_profiler.end_zone();
 
     //===============================
     // INTERMEZZO - Skybox
@@ -313,16 +858,21 @@ void renderer::draw_scene() {
     glDepthFunc(GL_LEQUAL);
     
     /* If the scene has skybox, draw it! */
-    if (m_current_skybox) {
+    if (packet.skybox) {
         
+        m_gpu_profiler.begin_zone("skybox");
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, packet.skybox->cubemap_object());
         attach_stage(m_skybox_vertex_shader);
         attach_stage(m_skybox_fragment_shader);
 
+        m_statistics.draw_calls++;
         glDrawArraysInstancedBaseInstance(
             GL_TRIANGLES, 
             m_skybox_first_vertex, 
             c_skybox_mesh.size(), 1, 0
         );
+        m_gpu_profiler.end_zone();
     }
 
     //===============================
@@ -333,19 +883,25 @@ void renderer::draw_scene() {
     /* Otherwise, choose the postprocess FBO */
     glBindFramebuffer(
         GL_FRAMEBUFFER, 
-        m_postprocess_passes.size() > 0 ? m_postprocess_targets[0].fbo : 0
+        m_postprocess_stages.empty() ? engine_runtime::instance()->window().props().framebuffer : m_postprocess_targets[0].fbo
     );
 
     glDepthMask(GL_TRUE);
     glDepthFunc(GL_ALWAYS);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    /* Upscale to the window */
+    glm::ivec2 window_size = engine_runtime::instance()->window().props().current_mode.size();
+    glViewport(0, 0, window_size.x, window_size.y);
+
     /* If no object nor skybox were drawn, end the frame now */
-    if (objects_drawn == 0 && !m_current_skybox) {
+    if (m_cull_counts.batches == 0 && !packet.skybox) {
         m_end_draw();
         return;
     }
     
+    m_gpu_profiler.begin_zone("combination");
+
     /* Attach default FBO's attachments as textures */
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_default_target.opaque_target);   
@@ -359,58 +915,27 @@ void renderer::draw_scene() {
     attach_stage(m_combination_shader);
     
     /* Set uniforms */
-    set_uniform("opaque_target", 0);
-    set_uniform("accum_target", 1);
-    set_uniform("reveal_target", 2);
+    set_uniform("u_opaque_target", 0);
+    set_uniform("u_accum_target", 1);
+    set_uniform("u_reveal_target", 2);
     
     /* Draw! */
+    m_statistics.draw_calls++;
     glDrawArraysInstancedBaseInstance(
         GL_TRIANGLES, 
         m_quad_first_vertex, 
         c_quad_mesh.size(), 1, 0
     );
+    m_gpu_profiler.end_zone();
     
     //===============================
     // PASS 4 - Post-processing
     //===============================
 
-    /* Definitions of "front" and "back" buffers - allows having just two buffers for the */
-    /* entirety of postprocessing */
-    GLuint front = 0, 
-           back = 1;
-
-    for (auto pp_pass = m_postprocess_passes.begin(); pp_pass != m_postprocess_passes.end(); ++pp_pass) {
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_postprocess_targets[0].color_target);   
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_default_target.depth_stencil_target);
-        glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
-
-
-        /* Setup shaders */
-        attach_stage(*pp_pass);
-        
-        /* Set uniforms */
-        set_uniform("color_target", 0);
-        set_uniform("depth_target", 1);
-        
-        /* If this is the last postprocessing pass, bind back buffer */
-        glBindFramebuffer(
-            GL_FRAMEBUFFER, 
-            utils::is_last_in_container(m_postprocess_passes, pp_pass) ? 0 : m_postprocess_targets[0].fbo
-        );
-        
-        /* Draw! */
-        glDrawArraysInstancedBaseInstance(
-            GL_TRIANGLES, 
-            m_quad_first_vertex, 
-            c_quad_mesh.size(), 1, 0
-        );
-        
-        /* Swap buffers */
-        front = back;
-        back ^= 1;
+    if (!m_postprocess_stages.empty()) {
+        m_gpu_profiler.begin_zone("post-processing");
+        m_run_postprocess();
+        m_gpu_profiler.end_zone();
     }
 
     //===============================
@@ -420,7 +945,7 @@ void renderer::draw_scene() {
 }
 
 template <typename T> 
-void renderer::set_uniform(std::string uniform_name, const T& val, GLbitfield stage_hint) {
+void renderer::set_uniform(const std::string& uniform_name, const T& val, GLbitfield stage_hint) {
 
     for (auto [type, stage] : m_attached_shader_stages) {
         
@@ -428,7 +953,7 @@ void renderer::set_uniform(std::string uniform_name, const T& val, GLbitfield st
         if (!(type & stage_hint))
             continue;
 
-        stage->set_uniform<T>(uniform_name, val);
+        stage->template set_uniform<T>(uniform_name, val);
     }
 }
 
@@ -438,134 +963,441 @@ void renderer::attach_stage(const shared_ptr<shader_stage>& stage) {
     glUseProgramStages(m_pipeline, stage->type_bitmask(), static_cast<GLuint>(*stage));
 }
 
-void renderer::m_prepare_drawing(vector<render_pass>& draw_passes) {
+void renderer::m_prepare_drawing(vector<render_pass>& draw_passes, const render_packet& packet) {
+
+    PROFILE_ZONE("renderer::m_prepare_drawing");
 
-    /* Create command queues */
-    vector<draw_request::draw_command> commands;
-    vector<draw_request::object_data> object_data;
+    size_t frame = m_frame_sync.frame_index();
+    size_t object_count = m_enqueued_objects.size();
 
-    /* Split objects to opaque and transparent */
-    auto first_transparent = stable_partition(
-        m_enqueued_objects.begin(), m_enqueued_objects.end(), 
-        [](draw_request req) { return !req.transparent; }
+    /* Culling input is written straight to the mapped memory, write-only and in order */
+    cull_instance* instances = static_cast<cull_instance*>(m_cull_input.frame_data(frame, object_count * sizeof(cull_instance)));
+    cull_batch* batches = static_cast<cull_batch*>(m_cull_batches.frame_data(frame, object_count * sizeof(cull_batch)));
+    draw_request::object_data* object_data = static_cast<draw_request::object_data*>(
+        m_object_storage.frame_data(frame, object_count * sizeof(draw_request::object_data))
     );
 
-    /* Currently bound shaders */
-    shader_map current_shaders;
-    bool is_transparent = false;
+    /* Opaque before transparent, then by pipeline, material and depth */
+    radix_sort(m_sort_entries, m_sort_scratch, [](const sort_entry& entry) { return entry.key; });
     
-    /* This waay before than the code before */
-    auto object = m_enqueued_objects.begin();
-    while (object != m_enqueued_objects.end()) {
-        
-        /* Prepare new pass */
-        GLuint objects_in_pass = 0;
-        shader_list shader_delta;
+    /* Transparency and pipeline bits of the key identify the pass */
+    GLuint objects_reserved = 0, batches_written = 0;
+    for (size_t i = 0; i < m_sort_entries.size();) {
 
-        /* Prepare space for shaders - by default vert and frag */
-        draw_passes.reserve(2); 
-        
-        /* Process shader delta */
-        for (const auto& [type, stage] : object->used_stages) {
+        uint64_t pass_key = m_sort_entries[i].key >> g_key_pipeline_shift;
+        bool transparent = (pass_key >> (g_key_transparent_shift - g_key_pipeline_shift)) != 0;
 
-            if (auto iter = current_shaders.find(type); iter == current_shaders.end() || iter->second != stage) {
-                current_shaders[type] = stage;
-                shader_delta.push_back(stage);
-            }
-        }
+        size_t pass_end = i;
+        while (pass_end < m_sort_entries.size() && (m_sort_entries[pass_end].key >> g_key_pipeline_shift) == pass_key)
+            pass_end++;
 
-        /* Process objects */
-        for (; object != m_enqueued_objects.end(); ++object) {
+        /* Group objects drawing the same mesh range, batches keep the order of their first object */
+        m_batch_lookup.clear();
+        m_batches.clear();
+        m_batch_of.resize(pass_end - i);
 
-            /* Transparent passes start */
-            if (!is_transparent && object == first_transparent) 
-                break;
+        /* Sampler array indices come from the material, instances of a command have to share it */
+        bool split_materials = texture_array_pool::enabled();
+        int batch_material = -1;
 
-            /* Shader missmatch */
-            if (m_has_shader_missmatch(object->used_stages, current_shaders))
-                break;
+        for (size_t j = i; j < pass_end; j++) {
+
+            const draw_request& object = m_enqueued_objects[m_sort_entries[j].index];
+            if (split_materials && object.data.mat_index != batch_material) {
+                /* Objects are sorted by material within the pass, a new material starts new batches */
+                m_batch_lookup.clear();
+                batch_material = object.data.mat_index;
+            }
+
+            uint64_t mesh_key = (static_cast<uint64_t>(object.command.m_first_index) << 32) | static_cast<uint32_t>(object.command.m_first_vertex);
 
-            for (const auto& [key, stage] : object->used_stages) {
-                if (auto iter = current_shaders.find(key); iter == current_shaders.end() || iter->second != stage)
-                    break;
+            auto [batch, inserted] = m_batch_lookup.try_emplace(mesh_key, static_cast<uint32_t>(m_batches.size()));
+            if (inserted) {
+                m_batches.push_back(instance_batch{object.command});
+                m_batches.back().command.m_instance_count = 0;
             }
 
-            /* Push data to queues */
-            commands.push_back(std::move(object->command));
-            object_data.push_back(std::move(object->data));
-            objects_in_pass++;
+            m_batches[batch->second].command.m_instance_count++;
+            m_batch_of[j - i] = batch->second;
+        }
+
+        /* Every batch reserves room for all its instances in the culled object data, found through the base instance */
+        GLuint first_command = batches_written;
+        for (auto& batch : m_batches) {
+            batch.command.m_base_instance = objects_reserved;
+            objects_reserved += batch.command.m_instance_count;
+
+            batches[batches_written++] = cull_batch{
+                batch.command, static_cast<GLuint>(draw_passes.size()), first_command, transparent ? 1u : 0u
+            };
+        }
+
+        /* Instances keep the sorted order, the culling pass moves them to their batch */
+        for (size_t j = i; j < pass_end; j++) {
+
+            const draw_request& object = m_enqueued_objects[m_sort_entries[j].index];
+            instances[j] = cull_instance{
+                object.bounds, first_command + m_batch_of[j - i], 
+                static_cast<GLuint>(j), object.visibility_slot, 0
+            };
+            object_data[j] = object.data;
+            m_statistics.triangles += object.command.m_element_count / 3;
         }
 
-        /* Save pass */
-        if (objects_in_pass > 0)
-            draw_passes.emplace_back(render_pass{is_transparent, objects_in_pass, shader_delta});
+        draw_passes.emplace_back(render_pass{
+            transparent, batches_written - first_command, first_command,
+            static_cast<uint16_t>(pass_key & ((1ull << g_key_pipeline_bits) - 1))
+        });
+
+        i = pass_end;
+    }
+
+    m_cull_counts = cull_counts{
+        static_cast<GLuint>(object_count), batches_written, static_cast<GLuint>(draw_passes.size())
+    };
+
+    m_cull_input.bind_range(GL_SHADER_STORAGE_BUFFER, CULL_INPUT_SSBO, frame);
+    m_cull_batches.bind_range(GL_SHADER_STORAGE_BUFFER, CULL_BATCH_SSBO, frame);
+    m_object_storage.bind_range(GL_SHADER_STORAGE_BUFFER, OBJECT_SOURCE_SSBO, frame);
+
+    /* GPU-only outputs, one region per culling phase. Counters start at zero, the culling pass increments them */
+    m_reserve_gpu_buffer(m_culled_objects, m_culled_objects_capacity, 2 * object_count * sizeof(draw_request::object_data), OBJECT_SSBO);
+    m_reserve_gpu_buffer(m_draw_cmd_queue, m_draw_cmd_capacity, 2 * batches_written * sizeof(draw_request::draw_command), DRAW_COMMAND_SSBO);
+    m_reserve_gpu_buffer(m_batch_counts, m_batch_counts_capacity, 2 * batches_written * sizeof(GLuint), BATCH_COUNT_SSBO);
+    m_reserve_gpu_buffer(m_draw_count_buffer, m_draw_count_capacity, 2 * draw_passes.size() * sizeof(GLuint), DRAW_COUNT_SSBO);
+    m_reserve_gpu_buffer(m_visibility, m_visibility_capacity, std::max<size_t>(packet.visibility_slots, 1) * sizeof(GLuint), VISIBILITY_SSBO, true);
+
+    glClearNamedBufferSubData(m_batch_counts, GL_R32UI, 0, 2 * batches_written * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glClearNamedBufferSubData(m_draw_count_buffer, GL_R32UI, 0, 2 * draw_passes.size() * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void renderer::m_reserve_gpu_buffer(GLuint& buffer, size_t& capacity, size_t size, binding_points binding, bool keep_contents) {
+
+    if (buffer != 0 && size <= capacity)
+        return;
+
+    GLuint old_buffer = buffer;
+    size_t old_capacity = capacity;
+
+    capacity = std::max(size, 2 * capacity);
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, capacity, nullptr, 0);
+
+    /* The grown part starts zeroed */
+    if (keep_contents) {
+        glClearNamedBufferData(buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+        if (old_buffer != 0)
+            glCopyNamedBufferSubData(old_buffer, buffer, 0, 0, old_capacity);
+    }
+
+    /* Commands still in flight keep the old buffer alive, the deletion is deferred by the driver */
+    if (old_buffer != 0)
+        glDeleteBuffers(1, &old_buffer);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+}
+
+void renderer::m_build_light_clusters() {
+
+    GLuint cluster_count = g_cluster_grid.x * g_cluster_grid.y * g_cluster_grid.z;
+
+    glUseProgram(static_cast<GLuint>(*m_light_cluster_shader));
+    glDispatchCompute((cluster_count + 63) / 64, 1, 1);
+    glUseProgram(0);
+
+    /* Light lists are read by the fragment shaders */
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void renderer::m_upload_uniforms(const vector<render_pass>& passes, const render_packet& packet) {
+
+    size_t frame = m_frame_sync.frame_index();
+
+    frame_uniforms* frame_data = static_cast<frame_uniforms*>(m_frame_uniforms.frame_data(frame, sizeof(frame_uniforms)));
+    /* Slices are exponential, slice = log(depth) * scale - bias */
+    float near = packet.camera.near, far = packet.camera.far;
+    float depth_scale = g_cluster_grid.z / std::log(far / near);
+    
+    *frame_data = frame_uniforms{
+        packet.global_time, 
+        static_cast<GLuint>(packet.lights.size()), 
+        m_frame_number, 0,
+        vec2(m_render_size),
+        vec2(depth_scale, std::log(near) * depth_scale),
+        uvec4(g_cluster_grid, g_max_lights_per_cluster)
+    };
+    m_frame_uniforms.bind_range(GL_UNIFORM_BUFFER, FRAME_UBO, frame);
+
+    /* Every pass gets its own aligned slot, so switching passes is only a range rebind */
+    uint8_t* pass_data = static_cast<uint8_t*>(m_pass_uniforms.frame_data(frame, passes.size() * g_pass_uniform_stride));
+    for (size_t i = 0; i < passes.size(); i++) {
+        *reinterpret_cast<pass_uniforms*>(pass_data + i * g_pass_uniform_stride) = pass_uniforms{
+            static_cast<GLuint>(i), passes[i].transparent, {0, 0}
+        };
+    }
+}
+
+void renderer::m_bind_pass(size_t pass_index) {
+
+    glBindBufferRange(
+        GL_UNIFORM_BUFFER, PASS_UBO, m_pass_uniforms.buffer(), 
+        m_pass_uniforms.frame_offset(m_frame_sync.frame_index()) + pass_index * g_pass_uniform_stride, 
+        sizeof(pass_uniforms)
+    );
+}
+
+void renderer::m_cull_draws(cull_phase phase) {
+
+    if (m_cull_counts.instances == 0)
+        return;
+
+    /* Compute shaders can not be a part of the graphics pipeline, use the program directly */
+    glUseProgram(static_cast<GLuint>(*m_culling_shader));
+    glBindTextureUnit(0, m_default_target.depth_pyramid);
+
+    m_culling_shader->set_uniform("u_instance_count", m_cull_counts.instances);
+    m_culling_shader->set_uniform("u_batch_count", m_cull_counts.batches);
+    m_culling_shader->set_uniform("u_object_count", m_cull_counts.instances);
+    m_culling_shader->set_uniform("u_phase", static_cast<GLuint>(phase));
+    m_culling_shader->set_uniform("u_depth_pyramid", 0);
+    glDispatchCompute((m_cull_counts.instances + 63) / 64, 1, 1);
+
+    /* Instance counts are final, emit commands of the non-empty batches */
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(static_cast<GLuint>(*m_compaction_shader));
+    m_compaction_shader->set_uniform("u_batch_count", m_cull_counts.batches);
+    m_compaction_shader->set_uniform("u_pass_count", m_cull_counts.passes);
+    m_compaction_shader->set_uniform("u_object_count", m_cull_counts.instances);
+    m_compaction_shader->set_uniform("u_phase", static_cast<GLuint>(phase));
+    glDispatchCompute((m_cull_counts.batches + 63) / 64, 1, 1);
+    glUseProgram(0);
+
+    /* Make the written commands, counts and object data visible to the indirect draws */
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void renderer::m_build_depth_pyramid() {
+
+    const glm::ivec2 size = m_render_size;
+
+    GLint levels = 0;
+    glGetTextureParameteriv(m_default_target.depth_pyramid, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+
+    glUseProgram(static_cast<GLuint>(*m_depth_pyramid_shader));
+    m_depth_pyramid_shader->set_uniform("u_source", 0);
+
+    for (GLint level = 0; level < levels; level++) {
+
+        /* First level copies the depth buffer, every other one reduces the level above */
+        glBindTextureUnit(0, level == 0 ? m_default_target.depth_stencil_target : m_default_target.depth_pyramid);
+        m_depth_pyramid_shader->set_uniform("u_reduce", level > 0);
+        m_depth_pyramid_shader->set_uniform("u_source_level", std::max(level - 1, 0));
+        glBindImageTexture(0, m_default_target.depth_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
 
-        if (object == first_transparent)
-            is_transparent = true;
+        GLuint level_width = std::max(size.x >> level, 1), level_height = std::max(size.y >> level, 1);
+        glDispatchCompute((level_width + 7) / 8, (level_height + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
     }
 
-    glNamedBufferData(m_draw_cmd_queue, commands.size() * sizeof(commands[0]), commands.data(), GL_DYNAMIC_DRAW);
-    glNamedBufferData(m_object_storage, object_data.size() * sizeof(object_data[0]), object_data.data(), GL_DYNAMIC_DRAW);
+    glUseProgram(0);
 }
 
-bool renderer::m_has_shader_missmatch(const shader_map& a, const shader_map& b) {
+void renderer::m_bind_pipeline(uint16_t pipeline) {
 
-    for (const auto& [type, stage] : a) {
+    std::lock_guard<std::mutex> lock(m_pipeline_mutex);
 
-        if (auto iter = b.find(type); iter == b.end() || iter->second != stage)
-            return true;
+    /* Only stages that differ from the attached ones are swapped */
+    for (const auto& [type, stage] : m_pipelines[pipeline]) {
+
+        if (auto iter = m_attached_shader_stages.find(type); iter == m_attached_shader_stages.end() || iter->second != stage)
+            attach_stage(stage);
     }
+}
 
-    return false;
+void renderer::m_draw_passes(const vector<render_pass>& passes, bool transparent, cull_phase phase) {
+
+    for (size_t i = 0; i < passes.size(); i++) {
+
+        const render_pass& pass = passes[i];
+        if (pass.transparent != transparent)
+            continue;
+
+        m_bind_pipeline(pass.pipeline);
+
+        /* Engine uniforms of the pass */
+        m_bind_pass(i);
+        m_draw_pass_commands(i, pass, phase);
+    }
+}
+
+void renderer::m_draw_pass_commands(size_t pass_index, const render_pass& pass, cull_phase phase) {
+
+    /* Draw! Number of commands is known only to the GPU */
+    m_statistics.draw_calls++;
+    glMultiDrawElementsIndirectCount(
+        GL_TRIANGLES, GL_UNSIGNED_INT, 
+        reinterpret_cast<void*>((phase * m_cull_counts.batches + pass.first_command) * sizeof(draw_request::draw_command)), 
+        static_cast<GLintptr>((phase * m_cull_counts.passes + pass_index) * sizeof(GLuint)),
+        pass.command_count, 0
+    );
+}
+
+void renderer::m_draw_depth_prepass(const vector<render_pass>& passes, cull_phase phase) {
+
+    /* Every opaque pass shares the position-only pipeline, no stage or pass uniform switches */
+    glBindProgramPipeline(m_prepass_pipeline);
+
+    for (size_t i = 0; i < passes.size(); i++) {
+
+        if (!passes[i].transparent)
+            m_draw_pass_commands(i, passes[i], phase);
+    }
+
+    glBindProgramPipeline(m_pipeline);
+}
+
+void renderer::m_draw_opaque_passes(const vector<render_pass>& passes) {
+
+    size_t frame = m_frame_sync.frame_index();
+    m_overdraw_queried[frame] = true;
+
+    if (!m_depth_prepass) {
+
+        /* Objects visible last frame first, their depth then occludes the rest */
+        glBeginQuery(GL_SAMPLES_PASSED, m_shading_queries[frame]);
+        m_draw_passes(passes, false, LAST_VISIBLE_PHASE);
+
+        m_build_depth_pyramid();
+        m_cull_draws(OCCLUSION_PHASE);
+        m_draw_passes(passes, false, OCCLUSION_PHASE);
+        glEndQuery(GL_SAMPLES_PASSED);
+        return;
+    }
+
+    /* Lay down the depth of both phases, fragments passing here are the ones shaded without the prepass */
+    m_gpu_profiler.begin_zone("depth prepass");
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glBeginQuery(GL_SAMPLES_PASSED, m_prepass_queries[frame]);
+    m_draw_depth_prepass(passes, LAST_VISIBLE_PHASE);
+
+    m_build_depth_pyramid();
+    m_cull_draws(OCCLUSION_PHASE);
+    m_draw_depth_prepass(passes, OCCLUSION_PHASE);
+    glEndQuery(GL_SAMPLES_PASSED);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    m_gpu_profiler.end_zone();
+
+    /* Only the closest fragment of every pixel gets shaded */
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_EQUAL);
+
+    glBeginQuery(GL_SAMPLES_PASSED, m_shading_queries[frame]);
+    m_draw_passes(passes, false, LAST_VISIBLE_PHASE);
+    m_draw_passes(passes, false, OCCLUSION_PHASE);
+    glEndQuery(GL_SAMPLES_PASSED);
+}
+
+void renderer::m_collect_queries() {
+
+    /* The frame's fence was passed, so were its queries */
+    size_t frame = m_frame_sync.frame_index();
+
+    if (m_overdraw_queried[frame]) {
+
+        GLuint64 shaded = 0, prepassed = 0;
+        glGetQueryObjectui64v(m_shading_queries[frame], GL_QUERY_RESULT, &shaded);
+        if (m_depth_prepass)
+            glGetQueryObjectui64v(m_prepass_queries[frame], GL_QUERY_RESULT, &prepassed);
+
+        m_statistics.shaded_fragments = shaded;
+        m_statistics.overdraw_saved = prepassed > shaded ? prepassed - shaded : 0;
+        m_overdraw_queried[frame] = false;
+    }
+
+    if (m_frame_timed[frame]) {
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_timer_queries[frame], GL_QUERY_RESULT, &elapsed);
+        m_statistics.gpu_frame_ns = elapsed;
+        m_frame_timed[frame] = false;
+
+        /* Frames in flight still use the old targets, deletion is deferred by the driver */
+        if (m_resolution_scaler.update(elapsed)) {
+            m_destroy_fbos();
+            m_build_fbos();
+        }
+    }
 }
 
 void renderer::m_end_draw() {
+
+    /* Everything of this frame was submitted, guard its ring buffer regions */
+    m_gpu_profiler.end_frame();
+    m_texture_streamer.end_frame(m_frame_sync.frame_index());
+    glEndQuery(GL_TIME_ELAPSED);
+    m_frame_sync.end_frame();
+
     glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBuffer(GL_PARAMETER_BUFFER, 0);
     glBindVertexArray(0);
     glBindProgramPipeline(0);
 
-    size_t last_frame_lights = m_lights.size();
-    m_lights.clear();
-    m_lights.reserve(last_frame_lights);
     m_enqueued_objects.clear();
+    m_sort_entries.clear();
 }
 
 void renderer::m_build_fbos() {
 
     const game_window::window_props_t& props = engine_runtime::instance()->window().props();
 
-    /* Opaque attachment */
+    /* Main target is rendered at a scale and upscaled by the combination pass */
+    m_statistics.render_scale = m_resolution_scaler.scale();
+    m_render_size = glm::max(glm::ivec2(glm::vec2(props.current_mode.size()) * m_statistics.render_scale), glm::ivec2(1));
+
+    /* Opaque attachment, filtered linearly for the upscale */
     glCreateTextures(GL_TEXTURE_2D, 1, &m_default_target.opaque_target);
-    glTextureParameteri(m_default_target.opaque_target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_default_target.opaque_target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(m_default_target.opaque_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_default_target.opaque_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTextureStorage2D(
         m_default_target.opaque_target, 1, GL_RGBA8, 
-        props.current_mode.size().x, props.current_mode.size().y
+        m_render_size.x, m_render_size.y
     );
 
     /* Accum attachment */
     glCreateTextures(GL_TEXTURE_2D, 1, &m_default_target.accum_target);
-    glTextureParameteri(m_default_target.accum_target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_default_target.accum_target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(m_default_target.accum_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_default_target.accum_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTextureStorage2D(
         m_default_target.accum_target, 1, GL_RGBA16F, 
-        props.current_mode.size().x, props.current_mode.size().y
+        m_render_size.x, m_render_size.y
     );
 
     /* Reveal attachment */
     glCreateTextures(GL_TEXTURE_2D, 1, &m_default_target.reveal_target);
-    glTextureParameteri(m_default_target.reveal_target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_default_target.reveal_target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(m_default_target.reveal_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_default_target.reveal_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTextureStorage2D(
         m_default_target.reveal_target, 1, GL_R8, 
-        props.current_mode.size().x, props.current_mode.size().y
+        m_render_size.x, m_render_size.y
     );
 
     /* Depth attachment */
     glCreateTextures(GL_TEXTURE_2D, 1, &m_default_target.depth_stencil_target);
     glTextureStorage2D(
         m_default_target.depth_stencil_target, 1, GL_DEPTH24_STENCIL8, 
-        props.current_mode.size().x, props.current_mode.size().y
+        m_render_size.x, m_render_size.y
+    );
+
+    /* Depth pyramid, the first level matches the depth attachment */
+    GLsizei pyramid_levels = static_cast<GLsizei>(std::log2(std::max(m_render_size.x, m_render_size.y))) + 1;
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_default_target.depth_pyramid);
+    glTextureParameteri(m_default_target.depth_pyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(m_default_target.depth_pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureStorage2D(
+        m_default_target.depth_pyramid, pyramid_levels, GL_R32F, 
+        m_render_size.x, m_render_size.y
     );
 
     /* Bind attachments together */
@@ -575,20 +1407,10 @@ void renderer::m_build_fbos() {
     glNamedFramebufferTexture(m_default_target.fbo, GL_COLOR_ATTACHMENT2, m_default_target.reveal_target, 0);
     glNamedFramebufferTexture(m_default_target.fbo, GL_DEPTH_STENCIL_ATTACHMENT, m_default_target.depth_stencil_target, 0);
 
-    for (auto& pp_target : m_postprocess_targets) {
+    /* Post-processing samples the depth, not the stencil */
+    glTextureParameteri(m_default_target.depth_stencil_target, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
 
-        glCreateTextures(GL_TEXTURE_2D, 1, &pp_target.color_target);
-        glTextureParameteri(pp_target.color_target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTextureParameteri(pp_target.color_target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTextureStorage2D(
-            pp_target.color_target, 1, GL_RGBA8, 
-            props.current_mode.size().x, props.current_mode.size().y
-        );    
-
-        glCreateFramebuffers(1, &pp_target.fbo);
-        glNamedFramebufferTexture(pp_target.fbo, GL_COLOR_ATTACHMENT0, pp_target.color_target, 0);
-        glNamedFramebufferDrawBuffer(pp_target.fbo, GL_COLOR_ATTACHMENT0);
-    }
+    m_build_postprocess_targets();
 }
 
 void renderer::m_destroy_fbos() {
@@ -599,10 +1421,139 @@ void renderer::m_destroy_fbos() {
     glDeleteTextures(1, &m_default_target.accum_target);
     glDeleteTextures(1, &m_default_target.reveal_target);
     glDeleteTextures(1, &m_default_target.depth_stencil_target);
+    glDeleteTextures(1, &m_default_target.depth_pyramid);
+
+    m_destroy_postprocess_targets();
+}
+
+void renderer::m_build_postprocess_chain() {
 
-    for (auto& pp_target : m_postprocess_targets) {
+    m_postprocess_stages.clear();
 
-        glDeleteFramebuffers(1, &pp_target.fbo);
-        glDeleteTextures(1, &pp_target.color_target);
+    /* Per-pixel effects are fused into the stage before them, as long as its output has the same size */
+    const vector<postprocess_pass> no_passes;
+    vector<const postprocess_pass*> fused;
+    for (const postprocess_pass& pass : m_built_postprocess ? *m_built_postprocess : no_passes) {
+
+        if (!fused.empty() && (pass.radius > 0 || pass.scale != fused.front()->scale)) {
+            m_postprocess_stages.push_back(postprocess_stage{
+                make_shared<shader_stage>(GL_COMPUTE_SHADER, postprocess_kernel(fused), "post-processing kernel"), 
+                fused.front()->scale, 0
+            });
+            fused.clear();
+        }
+
+        fused.push_back(&pass);
     }
+
+    if (!fused.empty()) {
+        m_postprocess_stages.push_back(postprocess_stage{
+            make_shared<shader_stage>(GL_COMPUTE_SHADER, postprocess_kernel(fused), "post-processing kernel"), 
+            fused.front()->scale, 0
+        });
+    }
+
+    m_destroy_postprocess_targets();
+    m_build_postprocess_targets();
+}
+
+void renderer::m_build_postprocess_targets() {
+
+    const glm::ivec2 window_size = engine_runtime::instance()->window().props().current_mode.size();
+
+    auto create_target = [this](glm::ivec2 size) {
+
+        postprocess_target target = { 0, 0, size };
+        glCreateTextures(GL_TEXTURE_2D, 1, &target.color_target);
+        glTextureParameteri(target.color_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(target.color_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(target.color_target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(target.color_target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(target.color_target, 1, GL_RGBA8, size.x, size.y);
+
+        glCreateFramebuffers(1, &target.fbo);
+        glNamedFramebufferTexture(target.fbo, GL_COLOR_ATTACHMENT0, target.color_target, 0);
+        glNamedFramebufferDrawBuffer(target.fbo, GL_COLOR_ATTACHMENT0);
+        glNamedFramebufferReadBuffer(target.fbo, GL_COLOR_ATTACHMENT0);
+
+        m_postprocess_targets.push_back(target);
+        return m_postprocess_targets.size() - 1;
+    };
+
+    /* Combined image, input of the first stage */
+    if (m_postprocess_stages.empty())
+        return;
+
+    size_t source = create_target(window_size);
+
+    /* Only the input of a stage is alive while it runs, any other target of the same size can be written */
+    for (auto& stage : m_postprocess_stages) {
+
+        glm::ivec2 size = glm::max(glm::ivec2(glm::vec2(window_size) * stage.scale), glm::ivec2(1));
+        
+        stage.target = m_postprocess_targets.size();
+        for (size_t i = 0; i < m_postprocess_targets.size(); i++) {
+            if (i != source && m_postprocess_targets[i].size == size) {
+                stage.target = i;
+                break;
+            }
+        }
+
+        if (stage.target == m_postprocess_targets.size())
+            create_target(size);
+
+        source = stage.target;
+    }
+}
+
+void renderer::m_destroy_postprocess_targets() {
+
+    for (auto& target : m_postprocess_targets) {
+
+        glDeleteFramebuffers(1, &target.fbo);
+        glDeleteTextures(1, &target.color_target);
+    }
+
+    m_postprocess_targets.clear();
+}
+
+void renderer::m_run_postprocess() {
+
+    size_t source = 0;
+    for (size_t i = 0; i < m_postprocess_stages.size(); i++) {
+
+        const postprocess_stage& stage = m_postprocess_stages[i];
+        const postprocess_target& target = m_postprocess_targets[stage.target];
+        m_gpu_profiler.begin_zone("post-processing stage " + to_string(i));
+
+        glUseProgram(static_cast<GLuint>(*stage.shader));
+        glBindTextureUnit(0, m_postprocess_targets[source].color_target);
+        glBindTextureUnit(1, m_default_target.depth_stencil_target);
+        stage.shader->set_uniform("u_source", 0);
+        stage.shader->set_uniform("u_depth", 1);
+
+        glBindImageTexture(0, target.color_target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute(
+            (target.size.x + g_postprocess_tile - 1) / g_postprocess_tile, 
+            (target.size.y + g_postprocess_tile - 1) / g_postprocess_tile, 1
+        );
+
+        /* Output is sampled by the next stage or blitted */
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        m_gpu_profiler.end_zone();
+        source = stage.target;
+    }
+
+    glUseProgram(0);
+
+    /* Compute can not write the back buffer, copy the result there, scaling it to the window */
+    const glm::ivec2 window_size = engine_runtime::instance()->window().props().current_mode.size();
+    const postprocess_target& result = m_postprocess_targets[source];
+
+    glBlitNamedFramebuffer(
+        result.fbo, engine_runtime::instance()->window().props().framebuffer, 
+        0, 0, result.size.x, result.size.y, 
+        0, 0, window_size.x, window_size.y, 
+        GL_COLOR_BUFFER_BIT, GL_LINEAR
+    );
 }
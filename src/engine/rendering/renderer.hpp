@@ -4,19 +4,32 @@
 ///
 #pragma once
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <glm/glm.hpp>
 #include "camera.hpp"
+#include "frustum.hpp"
 #include "light.hpp"
 #include "mesh.hpp"
+#include "render_packet.hpp"
+#include "resolution_scaler.hpp"
+#include "texture_residency.hpp"
+#include "texture_streamer.hpp"
+#include "texture_array_pool.hpp"
+#include "upload_queue.hpp"
 #include "../assets/cubemap.hpp"
 #include "../assets/shader.hpp"
 #include "../utils/gpu_memory.hpp"
-#include "../utils/group_list.hpp"
+#include "../utils/gpu_profiler.hpp"
 
 namespace rendering {
 
@@ -24,13 +37,33 @@ namespace rendering {
     ///
     /// Default multi-stage rendering pipeline. Also handles skybox, default camera and 
     /// post-processing passes
+    ///
+    /// The simulation fills a @c render_packet through @c request_draw and @c add_light, and hands it over with @c submit_frame.
+    /// With a render thread running, the packet is drawn on it while the simulation fills the next one. 
+    /// The render thread owns the window's context, the simulation keeps a context sharing objects with it
     class renderer {
 
         public:
-            using pp_pass_handle = std::list<std::shared_ptr<assets::shader_stage>>::iterator;          ///< Handle of an active post-processing pass
+            using pp_pass_handle = std::list<postprocess_pass>::iterator;                               ///< Handle of an active post-processing pass
             using shader_map = std::unordered_map<GLbitfield, std::shared_ptr<assets::shader_stage>>;   ///< Map of shader stages
             using shader_list = std::vector<std::shared_ptr<assets::shader_stage>>;                     ///< List of shader stages
 
+            /// @brief Statistics of the last drawn frame
+            struct frame_statistics {
+                uint32_t visible_objects;   ///< Objects that passed the CPU frustum test
+                uint32_t culled_objects;    ///< Objects rejected by the CPU frustum test
+                uint64_t fence_wait_ns;     ///< Time the CPU spent waiting for the GPU to release the frame's buffers
+                uint32_t commands_saved;    ///< Draw commands spared by merging identical meshes into instanced draws
+                uint64_t shaded_fragments;  ///< Opaque fragments shaded by the materials, measured @c c_frames_in_flight frames late
+                uint64_t overdraw_saved;    ///< Opaque fragments the depth prepass spared from shading, zero with the prepass disabled
+                uint64_t gpu_frame_ns;      ///< GPU time of a frame, measured @c c_frames_in_flight frames late
+                uint32_t draw_calls;        ///< Draw calls issued, a multi-draw counts once
+                uint64_t triangles;         ///< Triangles submitted to GPU culling
+                uint64_t resident_texture_bytes;    ///< Memory of the resident textures, or of the texture array layers in use
+                uint32_t texture_evictions;         ///< Textures evicted to fit a newly drawn one into the budget
+                float render_scale;         ///< Scale of the main render target relative to the window
+            };
+
         public:
             /// @brief Constructor
             ///
@@ -47,9 +80,12 @@ namespace rendering {
 
             /// @brief Prepares and hooks a post-process pass to the pipeline
             ///
-            /// @param shader Pointer to the shader asset
+            /// @param path Filesystem path of the effect snippet
+            /// @param scale Resolution of the pass output, relative to the window
+            /// @param radius Neighbourhood radius read by the effect, 0 for per-pixel effects
             /// @returns Handle of the new post-processing pass
-            pp_pass_handle add_postprocess_pass(const std::shared_ptr<assets::shader_stage>& shader);
+            /// @see postprocess_pass
+            pp_pass_handle add_postprocess_pass(const std::string& path, float scale = 1.0f, GLuint radius = 0);
 
             /// @brief Disables and removes post-processing pass
             ///
@@ -57,7 +93,7 @@ namespace rendering {
             void remove_postprocess_pass(const pp_pass_handle& handle);
 
             /// @brief Prepares a light for rendering
-            void add_light(const light::light_data& light) { m_lights.push_back(light); }
+            void add_light(const light::light_data& light) { m_packets[m_build_packet].lights.push_back(light); }
             
             /// @brief Sets camera as active
             ///
@@ -71,23 +107,99 @@ namespace rendering {
             void set_active_skybox(const std::shared_ptr<assets::cubemap>& skybox);
 
             bool has_active_camera() const { return m_active_camera.valid(); }
+            inline const utils::observer_ptr<camera>& active_camera() const { return m_active_camera; }
+
+            /// @brief Reserves a slot remembering whether an object was visible in the last frame
+            ///
+            /// Objects visible last frame are drawn first, their depth is then used to occlusion cull the rest
+            /// @returns Index of the slot
+            uint32_t alloc_visibility_slot();
+
+            /// @brief Releases a visibility slot
+            /// @param slot Slot returned by @c alloc_visibility_slot
+            void free_visibility_slot(uint32_t slot);
 
             /// @brief Requests a rendering of a mesh
             ///
-            /// Sets up a draw request to be processed during rendering
+            /// Sets up a draw request to be processed during rendering. Requests are frustum culled
+            /// in batches before drawing, so invisible meshes never make it into the draw queue
             /// @param mesh Mesh to be drawn
             /// @param transform Model matrix for the mesh
             void request_draw(const utils::observer_ptr<mesh_instance>& mesh, const glm::mat4x4& transform);
 
-            /// @brief Draws the scene
-            void draw_scene();
+            /// @brief Hands the prepared frame over to be drawn and presented
+            ///
+            /// With a render thread running, waits only until the previous frame is drawn. Otherwise draws the frame right away
+            void submit_frame();
+
+            /// @brief Queues GL work which has to run on the renderer's context, like changes of per-context state
+            ///
+            /// Tasks run before the next submitted frame is drawn, or right away without a render thread
+            /// @param task Work to be done
+            void enqueue_render_task(std::function<void()> task);
+
+            /// @brief Starts drawing on a dedicated thread
+            ///
+            /// The window's context must not be current on any thread, the render thread makes it current
+            void start_render_thread();
+
+            /// @brief Draws the last submitted frame and joins the render thread
+            ///
+            /// The window's context is made current on the calling thread, queued render tasks run on it
+            void stop_render_thread();
+
+            inline bool render_thread_running() const { return m_render_thread.joinable(); }
+
+            /// @brief Registers a combination of shader stages
+            ///
+            /// Draws are sorted and split to passes by pipeline ID, identical stage combinations share the ID
+            /// Pipelines with a stage declaring @c MIP_FEEDBACK_SSBO turn texture streaming on, see @c texture_stream_tail
+            /// @param stages Stages used by a material
+            /// @returns ID of the pipeline
+            uint16_t register_pipeline(const shader_map& stages);
+
+            /// @brief Largest size of the levels textures are loaded with, finer ones are streamed. Safe to call from any thread
+            ///
+            /// Streaming relies on the feedback of the shaders, until a pipeline declaring it is registered
+            /// textures are loaded with their full chain
+            /// @returns @c project/textures/stream_tail_size, 0 for the full chain
+            uint32_t texture_stream_tail() const;
 
             inline utils::gpu_allocator& vertex_allocator() { return m_vertex_buffer; }
             inline utils::gpu_allocator& element_allocator() { return m_element_buffer; }
             inline utils::gpu_allocator& material_allocator() { return m_material_buffer; }
             inline utils::gpu_allocator& texture_allocator() { return m_texture_buffer; }
 
+            /// @brief Frees a chunk of an allocator once no frame in flight may read it, has to be called by the simulation
+            ///
+            /// Packets submitted meanwhile may still draw from the chunk, it stays allocated until the GPU is done with them
+            /// @param allocator Allocator the chunk belongs to
+            /// @param handle Chunk to be freed
+            void retire_buffer(utils::gpu_allocator& allocator, const utils::gpu_allocator::handle& handle);
+
+            /// @brief Residency of the bindless textures, may be used only on the renderer's context
+            /// @see enqueue_render_task
+            inline texture_residency& residency() { return m_texture_residency; }
+
+            /// @brief Mip streaming of the bindless textures, may be used only on the renderer's context
+            /// @see enqueue_render_task
+            inline texture_streamer& streamer() { return m_texture_streamer; }
+
+            /// @brief Number of the frame being drawn, or of the last one drawn in between frames. May be used only on the renderer's context
+            inline uint64_t frame_number() const { return m_frame_number; }
+
+            /// @brief Texture arrays replacing bindless textures where unsupported, may be used only on the renderer's context
+            /// @see texture_array_pool::enabled
+            inline texture_array_pool& texture_arrays() { return m_texture_arrays; }
+
+            /// @brief Uploads of the assets' data, done on a thread of their own once started
+            inline upload_queue& uploads() { return m_uploads; }
+
             inline const shader_map& default_shaders() const { return m_default_shaders; }
+            /// @brief Statistics of the last frame drawn
+            frame_statistics statistics() const;
+            inline const utils::gpu_frame_sync& frame_sync() const { return m_frame_sync; }
+            inline utils::gpu_profiler& gpu_profiler() { return m_gpu_profiler; }
 
             /// @brief Attaches the stage to the renderer's pipeline object
             ///
@@ -106,9 +218,56 @@ namespace rendering {
             /// @param stage_hint Bitmask of type bits. Sets only the uniform of the stages that have their type bit present
             /// @see assets::shader::set_uniform
             template <typename Tp>
-            void set_uniform(std::string uniform_name, const Tp& val, GLbitfield stage_hint = static_cast<GLbitfield>(-1));
+            void set_uniform(const std::string& uniform_name, const Tp& val, GLbitfield stage_hint = static_cast<GLbitfield>(-1));
 
         private:
+            /// @brief Binding points of the engine's buffers
+            ///
+            /// Draw commands are reordered by the culling pass, so @c gl_DrawID can not be used to index
+            /// @c OBJECT_SSBO. Object's data are found at @c gl_BaseInstance + @c gl_InstanceID instead.
+            /// @c OBJECT_SSBO is written by the culling pass, which compacts surviving instances of every batch
+            ///
+            /// Engine-owned uniforms are provided through two std140 blocks, replacing per-pass @c set_uniform calls:
+            /// @code
+            /// layout (std140, binding = 9) uniform engine_frame { 
+            ///     float u_global_time; uint u_light_count; uint u_frame_number;
+            ///     vec2 u_resolution; vec2 u_cluster_depth; uvec4 u_cluster_grid; 
+            /// };
+            /// layout (std140, binding = 10) uniform engine_pass { uint u_pass_index; uint u_pass_transparent; };
+            /// @endcode
+            ///
+            /// Lights are binned into view-space clusters, fragment shaders walk only their cluster's list:
+            /// @code
+            /// uvec3 c = uvec3(gl_FragCoord.xy / u_resolution * u_cluster_grid.xy, log(-view_pos.z) * u_cluster_depth.x - u_cluster_depth.y);
+            /// uint cluster = (c.z * u_cluster_grid.y + c.y) * u_cluster_grid.x + c.x;
+            /// for (uint i = 0; i < b_cluster_light_counts[cluster]; i++) 
+            ///     shade(b_lights[b_cluster_light_indices[cluster * u_cluster_grid.w + i]]);
+            /// @endcode
+            ///
+            /// With @c project/ogl/depth_prepass enabled, opaque depth is laid down first by @c shaders/depth_prepass.vert
+            /// and materials are shaded with @c GL_EQUAL. Opaque material vertex shaders then have to declare
+            /// @c invariant @c gl_Position, compute it as @c u_mat_projection * @c u_mat_view * object * position, and must not discard
+            ///
+            /// Textures are streamed by mip level once @c project/textures/stream_tail_size is set and a pipeline declares
+            /// the feedback buffer, otherwise they are loaded whole. Fragment shaders report the finest level they would sample, relative to
+            /// the texture they got, into @c MIP_FEEDBACK_SSBO. One pixel of every 8x8 tile is enough, rotated each frame:
+            /// @code
+            /// layout (std430, binding = 18) buffer mip_feedback { int b_mip_feedback[]; };
+            /// if (uvec2(gl_FragCoord.xy) % 8u == uvec2(u_frame_number % 8u, (u_frame_number / 8u) % 8u))
+            ///     atomicMin(b_mip_feedback[id], int(floor(textureQueryLod(sampler2D(b_textures[id]), uv).y)));
+            /// @endcode
+            ///
+            /// Without bindless textures, shaders are compiled with @c ENGINE_TEXTURE_ARRAYS defined and texture slots hold
+            /// array/layer pairs instead. Textures are not streamed then, the feedback is left out:
+            /// @code
+            /// #ifdef ENGINE_TEXTURE_ARRAYS
+            /// layout (binding = 8) uniform sampler2DArray u_texture_arrays[16];
+            /// layout (std430, binding = 4) readonly buffer textures { uvec2 b_textures[]; };
+            /// #define sample_texture(id, uv) texture(u_texture_arrays[b_textures[id].x], vec3(uv, b_textures[id].y))
+            /// #endif
+            /// @endcode
+            /// Sampler arrays must be indexed by dynamically uniform values. Draws are instanced per mesh, so in this mode
+            /// objects of different materials are never merged into one command, keeping the material of a command uniform
             enum binding_points {
                 VERTEX_SSBO = 0,
                 OBJECT_SSBO,
@@ -116,6 +275,43 @@ namespace rendering {
                 MATERIAL_SSBO,
                 TEXTURE_SSBO,
                 LIGHTS_SSBO,
+                CULL_INPUT_SSBO,    ///< Draw commands and bounds before culling
+                DRAW_COMMAND_SSBO,  ///< Draw commands that survived culling
+                DRAW_COUNT_SSBO,    ///< Number of surviving draw commands per pass
+                FRAME_UBO,          ///< Engine data, updated once per frame
+                PASS_UBO,           ///< Engine data of the current pass, a slot per pass rebound before its draw
+                LIGHT_BOUNDS_SSBO,  ///< View-space bounding spheres of the lights
+                LIGHT_GRID_SSBO,    ///< Number of lights of each cluster
+                LIGHT_INDEX_SSBO,   ///< Light indices of each cluster, @c u_cluster_grid.w slots per cluster
+                OBJECT_SOURCE_SSBO, ///< Per-object data written by the CPU, input of the culling pass
+                CULL_BATCH_SSBO,    ///< Instanced batches to be culled
+                BATCH_COUNT_SSBO,   ///< Surviving instances of each batch, per phase
+                VISIBILITY_SSBO,    ///< Visibility of each object in the last frame, indexed by visibility slot
+                MIP_FEEDBACK_SSBO,  ///< Finest mip level sampled from each texture slot
+            };
+
+            /// @brief Culling phases, objects visible in the last frame are drawn before the occlusion test
+            enum cull_phase : GLuint {
+                LAST_VISIBLE_PHASE = 0,   ///< Opaque objects visible last frame, not occlusion tested
+                OCCLUSION_PHASE,          ///< Everything else, tested against the depth of the first phase
+            };
+
+            /// @brief Mirrors the @c engine_frame uniform block
+            struct frame_uniforms {
+                float global_time;
+                GLuint light_count;
+                GLuint frame_number;
+                GLuint padding;
+                glm::vec2 resolution;       ///< Size of the render target in pixels
+                glm::vec2 cluster_depth;    ///< Scale and bias turning log of view depth to the cluster slice
+                glm::uvec4 cluster_grid;    ///< Cluster counts along x, y and z, capacity of a cluster's light list in w
+            };
+
+            /// @brief Mirrors the @c engine_pass uniform block
+            struct pass_uniforms {
+                GLuint pass_index;
+                GLuint transparent;
+                GLuint padding[2];
             };
 
             struct draw_request {
@@ -134,22 +330,53 @@ namespace rendering {
                     int mat_index;
                 } data;
 
-                bool transparent;
-                shader_map used_stages;
+                glm::vec4 bounds;   ///< World-space bounding sphere
+                uint32_t visibility_slot;
+            };
+
+            /// @brief Entry of the render queue sort
+            ///
+            /// Key layout, from the most significant bit: transparency (1 bit), pipeline ID (15 bits),
+            /// material index (24 bits), view depth bucket (24 bits)
+            struct sort_entry {
+                uint64_t key;
+                uint32_t index;     ///< Index of the draw request in the render queue
+            };
 
-                draw_request& operator=(const draw_request& other) {
-                    command = other.command; 
-                    data = other.data; 
-                    transparent = other.transparent;
-                    used_stages = other.used_stages; 
-                    return *this;
-                }
+            /// @brief Per-instance input of the culling pass, mirrors @c cull_instance_t in @c culling.comp
+            struct cull_instance {
+                glm::vec4 bounds;           ///< World-space bounding sphere
+                GLuint batch;               ///< Index of the instance's batch
+                GLuint object;              ///< Index of the object's data in the source object storage
+                GLuint visibility_slot;     ///< Slot of the object's last frame visibility
+                GLuint padding;             ///< Padding to the std430 struct size
+            };
+
+            /// @brief Per-batch input of the culling pass, mirrors @c cull_batch_t in the culling shaders
+            struct cull_batch {
+                draw_request::draw_command command;     ///< Command to be emitted when any instance survives
+                GLuint pass;                            ///< Index of the pass the command belongs to
+                GLuint pass_offset;                     ///< First command of the pass in the indirect buffer
+                GLuint flags;                           ///< Batch flags, @c 1 for transparent
+            };
+
+            /// @brief Instanced draw of a single mesh range, being assembled within a pass
+            struct instance_batch {
+                draw_request::draw_command command; ///< Merged command, @c m_instance_count counts the instances
             };
 
             struct render_pass {
                 bool transparent;
-                uint object_count;
-                shader_list shader_delta;
+                uint command_count;
+                uint first_command;
+                uint16_t pipeline;
+            };
+
+            /// @brief Sizes of the current frame's culling input
+            struct cull_counts {
+                GLuint instances;
+                GLuint batches;
+                GLuint passes;
             };
 
             struct main_fbo {
@@ -157,35 +384,111 @@ namespace rendering {
                        opaque_target,
                        accum_target,
                        reveal_target,
-                       depth_stencil_target;
+                       depth_stencil_target,
+                       depth_pyramid;   ///< Maximum depth mip chain, built from the depth attachment
             };
 
-            struct posptprocess_fbo {
+            struct postprocess_target {
                 GLuint fbo,
                        color_target;
+                glm::ivec2 size;
+            };
+
+            /// @brief Fused post-processing effects, run as a single dispatch
+            struct postprocess_stage {
+                std::shared_ptr<assets::shader_stage> shader;
+                float scale;
+                size_t target;  ///< Index of the output target
             };
 
         private:
-            void m_prepare_drawing(std::vector<render_pass>& passes);
-            bool m_has_shader_missmatch(const shader_map& a, const shader_map& b);
+            void m_render_loop();
+            void m_present(render_packet& packet);
+            void m_draw_scene(const render_packet& packet);
+            void m_cull_pending_draws(const render_packet& packet);
+            void m_enqueue_draw(const render_packet::draw_item& draw, float depth);
+            void m_prepare_drawing(std::vector<render_pass>& passes, const render_packet& packet);
+            void m_cull_draws(cull_phase phase);
+            void m_build_depth_pyramid();
+            void m_bind_pipeline(uint16_t pipeline);
+            void m_draw_passes(const std::vector<render_pass>& passes, bool transparent, cull_phase phase);
+            void m_draw_pass_commands(size_t pass_index, const render_pass& pass, cull_phase phase);
+            void m_draw_depth_prepass(const std::vector<render_pass>& passes, cull_phase phase);
+            void m_draw_opaque_passes(const std::vector<render_pass>& passes);
+            void m_collect_queries();
+            void m_build_light_clusters();
+            void m_reserve_gpu_buffer(GLuint& buffer, size_t& capacity, size_t size, binding_points binding, bool keep_contents = false);
+            void m_upload_uniforms(const std::vector<render_pass>& passes, const render_packet& packet);
+            void m_bind_pass(size_t pass_index);
             void m_end_draw();
             void m_build_fbos(); 
             void m_destroy_fbos();
+            void m_build_postprocess_chain();
+            void m_build_postprocess_targets();
+            void m_destroy_postprocess_targets();
+            void m_run_postprocess();
 
         private:
             inline static renderer* s_instance = nullptr;
 
             /* Render targets */
             main_fbo m_default_target;  ///< Default Framebuffer
-            std::array<posptprocess_fbo, 2> m_postprocess_targets;  ///< Framebuffers for the post-processing
+            std::vector<postprocess_target> m_postprocess_targets;  ///< Targets of the post-processing, the first one holds the combined image
 
             /* Shaders */
             GLuint m_pipeline;                      ///< Shader pipeline
             shader_map m_attached_shader_stages;    ///< Currently attached shaders
             shader_map m_default_shaders;           ///< Default shaders
+            std::vector<shader_map> m_pipelines;    ///< Registered stage combinations, indexed by pipeline ID
+            GLuint m_prepass_pipeline;              ///< Position-only pipeline of the depth prepass
+
+            /* Frame queries, one set per frame in flight */
+            bool m_depth_prepass;   ///< Whether opaque depth is laid down before shading
+            std::array<GLuint, utils::gpu_frame_sync::c_frames_in_flight> m_prepass_queries,    ///< Fragments passing the depth prepass
+                                                                           m_shading_queries,   ///< Fragments shaded by the opaque passes
+                                                                           m_timer_queries;     ///< GPU time of the whole frame
+            std::array<bool, utils::gpu_frame_sync::c_frames_in_flight> m_overdraw_queried,     ///< Whether the frame's overdraw queries were issued
+                                                                         m_frame_timed;         ///< Whether the frame's timer query was issued
+
+            /* Dynamic resolution */
+            resolution_scaler m_resolution_scaler;  ///< Picks the scale of the main render target from the GPU frame time
+            glm::ivec2 m_render_size;               ///< Size of the main render target in pixels
+            
+            /* Render packets, one filled by the simulation while the other one is drawn */
+            std::array<render_packet, 2> m_packets;     ///< Double-buffered frame packets
+            size_t m_build_packet;                      ///< Packet being filled by the simulation
+            bool m_packet_pending;                      ///< Whether the render thread has a packet to draw
+            bool m_stop_rendering;                      ///< Signals the render thread to finish
+            mutable std::mutex m_packet_mutex;          ///< Guards the hand-over of the packets and the published statistics
+            std::condition_variable m_packet_submitted, ///< Signaled when a packet is handed over
+                                    m_packet_drawn;     ///< Signaled when the render thread finishes a packet
+            std::thread m_render_thread;                ///< Thread drawing the packets, owns the window's context
+            std::exception_ptr m_render_error;          ///< Error thrown while drawing, rethrown on the simulation thread
+            std::mutex m_pipeline_mutex;                ///< Guards the registered pipelines, registered by the simulation
+            std::atomic<bool> m_mip_feedback;           ///< Whether a registered pipeline reports the sampled mip levels
+
+            /// @brief Allocator chunk waiting for the frames in flight
+            struct retired_chunk {
+                utils::gpu_allocator* allocator;
+                utils::gpu_allocator::handle handle;
+                uint64_t packet;                        ///< Packet being built when the chunk was retired
+            };
+
+            std::vector<retired_chunk> m_retired_chunks;    ///< Freed chunks still read by frames in flight, owned by the simulation
+            uint64_t m_submitted_packets;                   ///< Number of packets submitted by the simulation
             
             /* Object queue */
-            group_list<draw_request, GLuint, GLuint> m_enqueued_objects;    ///< Objects enqueued to be drawn
+            std::vector<draw_request> m_enqueued_objects;                   ///< Objects enqueued to be drawn
+            std::vector<sort_entry> m_sort_entries,                         ///< Sort keys of the enqueued objects
+                                    m_sort_scratch;                         ///< Scratch storage of the radix sort
+            std::unordered_map<uint64_t, uint32_t> m_batch_lookup;          ///< Batch of a mesh range within the pass being prepared
+            std::vector<instance_batch> m_batches;                          ///< Batches of the pass being prepared
+            std::vector<uint32_t> m_batch_of;                               ///< Batch of each object of the pass being prepared
+            cull_counts m_cull_counts;                                      ///< Sizes of the culling input
+            std::vector<uint32_t> m_free_visibility_slots;                  ///< Released visibility slots
+            uint32_t m_visibility_slot_count;                               ///< Number of visibility slots ever allocated
+            frame_statistics m_statistics;                                  ///< Statistics of the frame being drawn
+            frame_statistics m_published_statistics;                        ///< Statistics of the last frame drawn
             
             /* Programmable vertex pulling buffers */
             GLuint m_models_vao;    ///< Vertex attrib obect of the global vertex buffer
@@ -195,14 +498,39 @@ namespace rendering {
             /* Object data */
             utils::gpu_allocator m_material_buffer, ///< Global GPU-bound material buffer
                                  m_texture_buffer;  ///< Global GPU-bound texture buffer
+            texture_residency m_texture_residency;  ///< Keeps the drawn textures resident, within the VRAM budget
+            texture_streamer m_texture_streamer;    ///< Streams mip levels of the sampled textures
+            texture_array_pool m_texture_arrays;    ///< Texture arrays, used instead of bindless textures where unsupported
+            upload_queue m_uploads;                 ///< Uploads of textures and geometry, off the simulation and render threads
+
+            /* Per-frame data, written by the CPU straight into mapped memory */
+            utils::gpu_frame_sync m_frame_sync;     ///< Fences of the frames in flight
+            utils::gpu_ring_buffer m_cull_input,    ///< Instances and their bounds to be culled
+                                   m_cull_batches,  ///< Instanced batches to be culled
+                                   m_object_storage,///< Per-object data storage, compacted by the culling pass
+                                   m_light_storage, ///< Per-light data storage
+                                   m_light_bounds,  ///< Per-light view-space bounds, input of the clustering
+                                   m_frame_uniforms,///< Engine uniform block of the frame
+                                   m_pass_uniforms; ///< Engine uniform block slots of the passes
+            uint32_t m_frame_number;                ///< Number of frames drawn
+            utils::gpu_profiler m_gpu_profiler;     ///< GPU times of the passes, read back frames later
+
+            /* Per-frame data, written only by the GPU */
+            GLuint m_draw_cmd_queue,    ///< Indirect command buffer, written by the culling pass
+                   m_draw_count_buffer, ///< Per-pass draw counts, written by the culling pass
+                   m_culled_objects,    ///< Data of the surviving objects, written by the culling pass
+                   m_batch_counts,      ///< Surviving instances of each batch, written by the culling pass
+                   m_visibility;        ///< Last frame visibility of each slot, updated by the culling pass
+            GLuint m_light_grid,        ///< Per-cluster light counts, written by the clustering pass
+                   m_light_indices;     ///< Per-cluster light lists, written by the clustering pass
+            size_t m_draw_cmd_capacity,     ///< Size of the indirect command buffer in bytes
+                   m_draw_count_capacity,   ///< Size of the draw count buffer in bytes
+                   m_culled_objects_capacity,   ///< Size of the culled object data in bytes
+                   m_batch_counts_capacity,     ///< Size of the batch instance counts in bytes
+                   m_visibility_capacity,       ///< Size of the visibility buffer in bytes
+                   m_light_grid_capacity,   ///< Size of the light grid in bytes
+                   m_light_index_capacity;  ///< Size of the light index lists in bytes
 
-            GLuint m_draw_cmd_queue, ///< Indirect command buffer
-                   m_object_storage, ///< Per-object data storage
-                   m_light_storage;  ///< Per-light data storage
-
-            /* Lights */
-            std::vector<light::light_data> m_lights;    ///< Lights to be drawn in the next frame
-            
             /* Camera */
             utils::observer_ptr<camera> m_active_camera;    ///< Currently active camera
 
@@ -216,12 +544,20 @@ namespace rendering {
             utils::gpu_allocator::handle m_skybox_handle;  ///< Handle of the skybox mesh
             uint m_skybox_first_vertex; ///< First vertex of the skybox mesh
 
-            std::list<std::shared_ptr<assets::shader_stage>> m_postprocess_passes;  ///< List of enabled post-processing passes
+            std::list<postprocess_pass> m_postprocess_passes;       ///< List of enabled post-processing passes
+            std::shared_ptr<const std::vector<postprocess_pass>> m_postprocess_snapshot,    ///< Copy of the passes, handed over with the packets
+                                                                 m_built_postprocess;       ///< Passes the post-processing chain was compiled from
+            std::vector<postprocess_stage> m_postprocess_stages;    ///< Compiled post-processing chain
 
             /* Render-specific shaders */
             std::shared_ptr<assets::shader_stage> m_quad_vertex_shader;     ///< Vertex shader to draw full-screen quad (for example for post-processing)
             std::shared_ptr<assets::shader_stage> m_skybox_vertex_shader;   ///< Vertex shader to draw the skybox
             std::shared_ptr<assets::shader_stage> m_skybox_fragment_shader; ///< Fragment shader to draw the skybox
             std::shared_ptr<assets::shader_stage> m_combination_shader;     ///< Shader to combine opaque and transparent objects              
+            std::shared_ptr<assets::shader_stage> m_culling_shader;         ///< Compute shader culling instances and compacting their data
+            std::shared_ptr<assets::shader_stage> m_compaction_shader;      ///< Compute shader emitting draw commands of the surviving batches
+            std::shared_ptr<assets::shader_stage> m_depth_pyramid_shader;   ///< Compute shader building the depth pyramid
+            std::shared_ptr<assets::shader_stage> m_light_cluster_shader;   ///< Compute shader binning lights into clusters
+            std::shared_ptr<assets::shader_stage> m_prepass_shader;         ///< Position-only vertex shader of the depth prepass
     };
 }
\ No newline at end of file
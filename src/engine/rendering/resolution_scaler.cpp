@@ -0,0 +1,42 @@
+#include "resolution_scaler.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace rendering;
+
+resolution_scaler::resolution_scaler(float min_scale, float max_scale, float target_frame_time)
+    : m_min_scale(min_scale), m_max_scale(std::max(min_scale, max_scale)), m_target_ns(target_frame_time * 1e6f),
+      m_average_ns(0.0f), m_scale(std::max(min_scale, max_scale)), m_settle_frames(c_settle_frames) {}
+
+bool resolution_scaler::update(uint64_t gpu_frame_ns) {
+
+    if (!enabled() || gpu_frame_ns == 0)
+        return false;
+
+    m_average_ns = m_average_ns == 0.0f 
+        ? static_cast<float>(gpu_frame_ns) 
+        : m_average_ns + (static_cast<float>(gpu_frame_ns) - m_average_ns) * c_smoothing;
+
+    /* Let the average catch up with the last change */
+    if (m_settle_frames > 0) {
+        m_settle_frames--;
+        return false;
+    }
+
+    /* Drop as soon as over the target, raise only with some headroom to not oscillate */
+    if (m_average_ns <= m_target_ns && m_average_ns >= m_target_ns * c_raise_headroom)
+        return false;
+
+    /* Cost scales with the pixel count, the square of the axis scale */
+    float ideal = m_scale * std::sqrt(m_target_ns / m_average_ns);
+    float scale = std::clamp(std::round(ideal / c_scale_step) * c_scale_step, m_min_scale, m_max_scale);
+
+    if (std::abs(scale - m_scale) < c_scale_step * 0.5f)
+        return false;
+
+    /* Assume the new cost, until samples of the new scale arrive */
+    m_average_ns *= (scale * scale) / (m_scale * m_scale);
+    m_scale = scale;
+    m_settle_frames = c_settle_frames;
+    return true;
+}
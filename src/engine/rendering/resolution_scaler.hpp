@@ -0,0 +1,45 @@
+///
+/// @file resolution_scaler.hpp
+/// @author geffevil
+///
+#pragma once
+#include <cstdint>
+
+namespace rendering {
+
+    /// @brief Controller of the render resolution scale
+    ///
+    /// Scales the resolution of the main render target so the measured GPU frame time
+    /// stays around the target. Frame time is assumed to be proportional to the pixel count,
+    /// changes are quantized and rate-limited, so the target is not reallocated every frame
+    class resolution_scaler {
+
+        public:
+            /// @brief Constructor
+            /// @param min_scale Smallest allowed scale of each axis
+            /// @param max_scale Largest allowed scale of each axis
+            /// @param target_frame_time Target GPU frame time in milliseconds
+            resolution_scaler(float min_scale, float max_scale, float target_frame_time);
+
+            /// @brief Feeds a measured GPU frame time to the controller
+            /// @param gpu_frame_ns GPU time of a frame in nanoseconds
+            /// @returns True, if the scale has changed
+            bool update(uint64_t gpu_frame_ns);
+
+            inline float scale() const { return m_scale; }
+            inline bool enabled() const { return m_min_scale < m_max_scale; }
+
+        private:
+            static constexpr float c_scale_step = 0.05f;        ///< Scales are multiples of the step
+            static constexpr float c_smoothing = 0.1f;          ///< Weight of a new sample in the frame time average
+            static constexpr float c_raise_headroom = 0.85f;    ///< Scale is raised only when the average is below this part of the target
+            static constexpr uint32_t c_settle_frames = 30;     ///< Frames to wait after a change, before the next one
+
+            float m_min_scale, 
+                  m_max_scale;
+            float m_target_ns;
+            float m_average_ns;
+            float m_scale;
+            uint32_t m_settle_frames;
+    };
+}
@@ -0,0 +1,162 @@
+#include "texture_array_pool.hpp"
+#include <iostream>
+#include "texture_streamer.hpp"
+#include "../utils/project_settings.hpp"
+
+using namespace std;
+using namespace utils;
+using namespace rendering;
+
+texture_array_pool::texture_array_pool()
+    : m_slot_buffer(0), m_memory_size(0) {}
+
+texture_array_pool::~texture_array_pool() {
+
+    if (!m_textures.empty())
+        glDeleteTextures(m_textures.size(), m_textures.data());
+}
+
+bool texture_array_pool::enabled() {
+
+    return !GLAD_GL_ARB_bindless_texture || project_settings::force_texture_arrays();
+}
+
+void texture_array_pool::init(GLuint slot_buffer) {
+
+    m_slot_buffer = slot_buffer;
+
+    /* Single mid-grey texel, neutral enough for colors and blend maps alike */
+    const uint8_t texel[4] = { 128, 128, 128, 255 };
+    m_arrays.push_back(texture_array{ glm::ivec2(1), GL_RGBA8, texture_streamer::swizzle(GL_RGBA8, 4), 1, 1, 1, {} });
+    m_textures.push_back(m_create_array(m_arrays.back()));
+    glTextureSubImage3D(m_textures.back(), 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+}
+
+void texture_array_pool::add(uint32_t slot, const glm::ivec2& size, GLenum format, int channels, vector<vector<uint8_t>> levels) {
+
+    if (slot >= m_slots.size()) {
+        m_slots.resize(slot + 1, layer_ref{0, 0});
+        m_used.resize(slot + 1, false);
+    }
+
+    /* Layers can not generate their own mips, images get their chain filtered on the CPU */
+    glm::ivec2 level_size = size;
+    int components = texture_streamer::components(format);
+    GLsizei level_count = components != 0 ? texture_streamer::level_count(size) : levels.size();
+    while (static_cast<GLsizei>(levels.size()) < level_count)
+        levels.push_back(texture_streamer::downsample(levels.back().data(), level_size, 1, components));
+
+    /* Find the array of the size, format and swizzle, the fallback texel is no candidate */
+    std::array<GLint, 4> swizzle = texture_streamer::swizzle(format, channels);
+    auto matches = [&](const texture_array& array) {
+        return array.size == size && array.format == format && array.swizzle == swizzle && array.levels == level_count;
+    };
+
+    GLuint index = 1;
+    while (index < m_arrays.size() && !matches(m_arrays[index]))
+        index++;
+
+    if (index == m_arrays.size()) {
+
+        /* Every unit is taken, the slot samples the fallback */
+        if (m_arrays.size() == c_max_arrays) {
+            std::cerr << "[WARNING] Out of texture arrays, a " << size.x << "x" << size.y << " texture falls back to grey" << std::endl;
+            m_write_slot(slot, layer_ref{0, 0});
+            return;
+        }
+
+        m_arrays.push_back(texture_array{ size, format, swizzle, level_count, c_initial_layers, 0, {} });
+        m_textures.push_back(m_create_array(m_arrays.back()));
+    }
+
+    texture_array& array = m_arrays[index];
+    GLsizei layer;
+    if (!array.free_layers.empty()) {
+        layer = array.free_layers.back();
+        array.free_layers.pop_back();
+    }
+    else {
+        if (array.used == array.capacity)
+            m_grow(index);
+        layer = array.used++;
+    }
+
+    level_size = size;
+    GLenum pixels = texture_streamer::pixel_format(format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (GLsizei level = 0; level < array.levels; level++) {
+        if (pixels != 0)
+            glTextureSubImage3D(m_textures[index], level, 0, 0, layer, level_size.x, level_size.y, 1, pixels, GL_UNSIGNED_BYTE, levels[level].data());
+        else
+            glCompressedTextureSubImage3D(m_textures[index], level, 0, 0, layer, level_size.x, level_size.y, 1, format, levels[level].size(), levels[level].data());
+        level_size = glm::max(level_size / 2, glm::ivec2(1));
+    }
+
+    m_slots[slot] = layer_ref{ index, static_cast<GLuint>(layer) };
+    m_used[slot] = true;
+    m_memory_size += texture_streamer::memory_size(format, size, array.levels);
+    m_write_slot(slot, m_slots[slot]);
+}
+
+void texture_array_pool::remove(uint32_t slot) {
+
+    if (slot >= m_slots.size() || !m_used[slot])
+        return;
+
+    /* Uploads are ordered after the draws already submitted, the layer may be reused right away */
+    texture_array& array = m_arrays[m_slots[slot].array];
+    array.free_layers.push_back(m_slots[slot].layer);
+    m_memory_size -= texture_streamer::memory_size(array.format, array.size, array.levels);
+    m_used[slot] = false;
+}
+
+void texture_array_pool::bind() const {
+
+    if (!m_textures.empty())
+        glBindTextures(c_first_unit, m_textures.size(), m_textures.data());
+}
+
+GLuint texture_array_pool::m_create_array(const texture_array& array) const {
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, project_settings::tex_min_filter());
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, project_settings::tex_mag_filter());
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureStorage3D(texture, array.levels, array.format, array.size.x, array.size.y, array.capacity);
+
+    /* Layers can not be swizzled one by one, textures reading differently never share an array */
+    glTextureParameteriv(texture, GL_TEXTURE_SWIZZLE_RGBA, array.swizzle.data());
+
+    return texture;
+}
+
+void texture_array_pool::m_grow(GLuint index) {
+
+    texture_array& array = m_arrays[index];
+    GLuint old_texture = m_textures[index];
+    GLsizei old_capacity = array.capacity;
+
+    /* Storage is immutable, layers are copied into a twice as deep array. The driver keeps the old one alive for the frames in flight */
+    array.capacity *= 2;
+    m_textures[index] = m_create_array(array);
+
+    glm::ivec2 level_size = array.size;
+    for (GLsizei level = 0; level < array.levels; level++) {
+        glCopyImageSubData(
+            old_texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            m_textures[index], GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            level_size.x, level_size.y, old_capacity
+        );
+        level_size = glm::max(level_size / 2, glm::ivec2(1));
+    }
+
+    glDeleteTextures(1, &old_texture);
+}
+
+void texture_array_pool::m_write_slot(uint32_t slot, const layer_ref& ref) {
+
+    glNamedBufferSubData(m_slot_buffer, slot * sizeof(GLuint64), sizeof(layer_ref), &ref);
+}
@@ -0,0 +1,92 @@
+///
+/// @file texture_array_pool.hpp
+/// @author geffevil
+///
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../lib/glad/glad.h"
+
+namespace rendering {
+
+    /// @brief Texture backend for devices without @c GL_ARB_bindless_texture
+    ///
+    /// Textures are packed into layers of @c GL_TEXTURE_2D_ARRAY textures, one array per size, format and swizzle.
+    /// Slots of the texture pool hold an array/layer pair instead of a bindless handle, so materials still
+    /// reference textures by slot and a whole pass is drawn by one multi-draw without rebinding textures.
+    /// Arrays are bound to consecutive texture units starting at @c c_first_unit, array 0 is a single grey
+    /// texel sampled by slots which did not fit. All of the methods have to be called on the renderer's context
+    class texture_array_pool {
+
+        public:
+            static constexpr GLuint c_first_unit = 8;       ///< Texture unit of the first array
+            static constexpr GLuint c_max_arrays = 16;      ///< Arrays bound at once, shaders declare as many samplers
+            static constexpr GLsizei c_initial_layers = 4;  ///< Layers of a new array, doubled whenever it fills up
+
+        public:
+            texture_array_pool();
+            texture_array_pool(const texture_array_pool&) = delete;
+            ~texture_array_pool();
+
+            /// @brief Whether textures go through the arrays, decided by the extension support at startup
+            ///
+            /// The fallback may be forced by @c project/textures/force_texture_arrays, to test it on any device
+            static bool enabled();
+
+            /// @brief Creates the fallback array
+            /// @param slot_buffer Buffer of the texture pool
+            void init(GLuint slot_buffer);
+
+            /// @brief Copies a texture into a layer of the array of its size and format and points its slot there
+            /// @param slot Slot of the texture in the pool
+            /// @param size Size of the texture
+            /// @param format Internal format of the texture
+            /// @param channels Channels of the source image, arrays are swizzled as the texture would be
+            /// @param levels Pixels or blocks of the levels, finest first. A single uncompressed level gets the rest generated
+            void add(uint32_t slot, const glm::ivec2& size, GLenum format, int channels, std::vector<std::vector<uint8_t>> levels);
+
+            /// @brief Releases the layer of a texture
+            /// @param slot Slot of the texture in the pool
+            void remove(uint32_t slot);
+
+            /// @brief Binds the arrays to their texture units
+            void bind() const;
+
+            /// @brief Memory occupied by the layers in use in bytes
+            inline size_t memory_size() const { return m_memory_size; }
+
+        private:
+            /// @brief Array holding textures of one size and format
+            struct texture_array {
+                glm::ivec2 size;
+                GLenum format;
+                std::array<GLint, 4> swizzle;       ///< Shared by the layers, narrow formats read as their images would
+                GLsizei levels;
+                GLsizei capacity;                   ///< Number of allocated layers
+                GLsizei used;                       ///< Layers handed out so far, freed ones are reused first
+                std::vector<GLsizei> free_layers;   ///< Layers released by removed textures
+            };
+
+            /// @brief Layer of a texture, mirrors the slot's content
+            struct layer_ref {
+                GLuint array;
+                GLuint layer;
+            };
+
+        private:
+            GLuint m_create_array(const texture_array& array) const;
+            void m_grow(GLuint index);
+            void m_write_slot(uint32_t slot, const layer_ref& ref);
+
+        private:
+            GLuint m_slot_buffer;                   ///< Buffer of the texture pool
+            std::vector<texture_array> m_arrays;    ///< Arrays, indexed as in the slots
+            std::vector<GLuint> m_textures;         ///< Texture objects of the arrays, in binding order
+            std::vector<layer_ref> m_slots;         ///< Layer of every slot
+            std::vector<bool> m_used;               ///< Whether a slot holds a texture
+            size_t m_memory_size;                   ///< Memory of the layers in use
+    };
+}
@@ -0,0 +1,173 @@
+#include "texture_residency.hpp"
+
+using namespace std;
+using namespace rendering;
+
+texture_residency::texture_residency(size_t budget, uint32_t keep_frames)
+    : m_budget(budget), m_keep_frames(keep_frames), m_slot_buffer(0),
+      m_fallback_texture(0), m_fallback_handle(0), m_statistics({0, 0, 0, 0}) {}
+
+texture_residency::~texture_residency() {
+
+    for (uint32_t slot : m_lru)
+        glMakeTextureHandleNonResidentARB(m_textures[slot].handle);
+
+    if (m_fallback_texture != 0) {
+        glMakeTextureHandleNonResidentARB(m_fallback_handle);
+        glDeleteTextures(1, &m_fallback_texture);
+    }
+}
+
+void texture_residency::init(GLuint slot_buffer) {
+
+    m_slot_buffer = slot_buffer;
+
+    /* Single mid-grey texel, neutral enough for colors and blend maps alike */
+    const uint8_t texel[4] = { 128, 128, 128, 255 };
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_fallback_texture);
+    glTextureStorage2D(m_fallback_texture, 1, GL_RGBA8, 1, 1);
+    glTextureSubImage2D(m_fallback_texture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+
+    m_fallback_handle = glGetTextureHandleARB(m_fallback_texture);
+    glMakeTextureHandleResidentARB(m_fallback_handle);
+}
+
+void texture_residency::track(uint32_t slot, GLuint64 handle, size_t bytes) {
+
+    if (slot >= m_textures.size())
+        m_textures.resize(slot + 1, texture_entry{0, 0, 0, false, false, false, {}});
+
+    m_textures[slot] = texture_entry{handle, bytes, 0, true, false, false, {}};
+    m_write_slot(slot, m_fallback_handle);
+}
+
+bool texture_residency::untrack(uint32_t slot) {
+
+    if (slot >= m_textures.size() || !m_textures[slot].tracked)
+        return false;
+
+    bool resident = m_textures[slot].resident;
+    if (resident)
+        m_release(slot);
+
+    /* Pending request of the slot is dropped by the update */
+    m_textures[slot].tracked = false;
+    return resident;
+}
+
+bool texture_residency::replace(uint32_t slot, GLuint64 handle, size_t bytes) {
+
+    if (slot >= m_textures.size() || !m_textures[slot].tracked)
+        return false;
+
+    /* Budget is enforced by the next eviction, a grown texture may overshoot it until then */
+    texture_entry& texture = m_textures[slot];
+    if (texture.resident) {
+        glMakeTextureHandleResidentARB(handle);
+        m_write_slot(slot, handle);
+        m_statistics.resident_bytes += bytes;
+        m_statistics.resident_bytes -= texture.bytes;
+    }
+
+    texture.handle = handle;
+    texture.bytes = bytes;
+    return texture.resident;
+}
+
+void texture_residency::set_material(uint32_t material, const material_slots& slots) {
+
+    if (material >= m_materials.size())
+        m_materials.resize(material + 1, material_entry{{}, UINT64_MAX});
+
+    m_materials[material] = material_entry{slots, UINT64_MAX};
+}
+
+void texture_residency::remove_material(uint32_t material) {
+
+    if (material < m_materials.size())
+        m_materials[material].slots.fill(-1);
+}
+
+void texture_residency::mark_material(int material, uint64_t frame) {
+
+    /* Objects sharing a material are common, each material is marked once a frame */
+    if (material < 0 || static_cast<size_t>(material) >= m_materials.size() || m_materials[material].last_marked == frame)
+        return;
+
+    m_materials[material].last_marked = frame;
+    for (int slot : m_materials[material].slots) {
+
+        if (slot < 0 || static_cast<size_t>(slot) >= m_textures.size() || !m_textures[slot].tracked)
+            continue;
+
+        texture_entry& texture = m_textures[slot];
+        texture.last_used = frame;
+
+        if (texture.resident)
+            m_lru.splice(m_lru.begin(), m_lru, texture.lru);
+        else if (!texture.requested) {
+            texture.requested = true;
+            m_requests.push_back(slot);
+        }
+    }
+}
+
+void texture_residency::update(uint64_t frame) {
+
+    m_statistics.evictions = 0;
+    m_statistics.misses = 0;
+
+    for (uint32_t slot : m_requests) {
+
+        texture_entry& texture = m_textures[slot];
+        texture.requested = false;
+        if (!texture.tracked || texture.resident)
+            continue;
+
+        /* Only textures no frame in flight may sample are evicted, the oldest first */
+        while (m_budget != 0 && m_statistics.resident_bytes + texture.bytes > m_budget && !m_lru.empty() &&
+               m_textures[m_lru.back()].last_used + m_keep_frames < frame) {
+            m_evict(m_lru.back());
+            m_statistics.evictions++;
+        }
+
+        /* Does not fit, the fallback is sampled until older textures age out */
+        if (m_budget != 0 && m_statistics.resident_bytes + texture.bytes > m_budget) {
+            m_statistics.misses++;
+            continue;
+        }
+
+        glMakeTextureHandleResidentARB(texture.handle);
+        m_write_slot(slot, texture.handle);
+
+        texture.resident = true;
+        texture.lru = m_lru.insert(m_lru.begin(), slot);
+        m_statistics.resident_bytes += texture.bytes;
+        m_statistics.resident_textures++;
+    }
+
+    m_requests.clear();
+}
+
+void texture_residency::m_evict(uint32_t slot) {
+
+    m_release(slot);
+    glMakeTextureHandleNonResidentARB(m_textures[slot].handle);
+}
+
+void texture_residency::m_release(uint32_t slot) {
+
+    texture_entry& texture = m_textures[slot];
+
+    /* Handle itself stays resident, it is up to the caller */
+    m_write_slot(slot, m_fallback_handle);
+    m_lru.erase(texture.lru);
+    texture.resident = false;
+    m_statistics.resident_bytes -= texture.bytes;
+    m_statistics.resident_textures--;
+}
+
+void texture_residency::m_write_slot(uint32_t slot, GLuint64 handle) {
+
+    glNamedBufferSubData(m_slot_buffer, slot * sizeof(GLuint64), sizeof(GLuint64), &handle);
+}
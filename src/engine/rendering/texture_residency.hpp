@@ -0,0 +1,122 @@
+///
+/// @file texture_residency.hpp
+/// @author geffevil
+///
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+#include "../../lib/glad/glad.h"
+
+namespace rendering {
+
+    /// @brief Keeps bindless textures of the recently drawn materials resident, within a memory budget
+    ///
+    /// Shaders reach textures through slots of the texture pool, each holding a bindless handle. Slots of textures
+    /// which are not resident hold the handle of a small fallback texture instead. Textures are made resident when
+    /// a drawn material uses them, least recently used ones are evicted once the budget would be exceeded.
+    /// All of the methods have to be called on the renderer's context
+    class texture_residency {
+
+        public:
+            static constexpr size_t c_material_textures = 8;    ///< Texture slots a material may reference
+            using material_slots = std::array<int, c_material_textures>;   ///< Texture slots of a material, -1 for unused
+
+            /// @brief Statistics of the residency
+            struct residency_statistics {
+                uint64_t resident_bytes;    ///< Memory of the resident textures
+                uint32_t resident_textures; ///< Number of resident textures
+                uint32_t evictions;         ///< Textures evicted during the last update
+                uint32_t misses;            ///< Textures the last update could not fit into the budget
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param budget Memory the resident textures may occupy in bytes, 0 for no limit
+            /// @param keep_frames Frames an evicted texture has to be unused for, so no frame in flight samples it
+            texture_residency(size_t budget, uint32_t keep_frames);
+            texture_residency(const texture_residency&) = delete;
+            ~texture_residency();
+
+            /// @brief Creates the fallback texture
+            /// @param slot_buffer Buffer of the texture pool
+            void init(GLuint slot_buffer);
+
+            /// @brief Starts managing a texture, its slot points to the fallback until the texture is used
+            /// @param slot Slot of the texture in the pool
+            /// @param handle Bindless handle of the texture
+            /// @param bytes Memory occupied by the texture
+            void track(uint32_t slot, GLuint64 handle, size_t bytes);
+
+            /// @brief Stops managing a texture, its slot points to the fallback. The handle is left to the caller, like with @c replace
+            ///
+            /// Frames in flight may still sample the handle, it has to be kept resident until they are done
+            /// @param slot Slot of the texture in the pool
+            /// @returns Whether the handle is resident
+            bool untrack(uint32_t slot);
+
+            /// @brief Swaps the texture of a slot, keeping its residency. The old handle is left to the caller
+            /// @param slot Slot of the texture in the pool
+            /// @param handle Bindless handle of the new texture
+            /// @param bytes Memory occupied by the new texture
+            /// @returns Whether the old handle was resident
+            bool replace(uint32_t slot, GLuint64 handle, size_t bytes);
+
+            /// @brief Sets the texture slots referenced by a material
+            /// @param material Index of the material
+            /// @param slots Slots of the material's textures
+            void set_material(uint32_t material, const material_slots& slots);
+
+            /// @brief Forgets textures of a material
+            /// @param material Index of the material
+            void remove_material(uint32_t material);
+
+            /// @brief Marks textures of a material as used in the frame
+            /// @param material Index of the material
+            /// @param frame Number of the frame
+            void mark_material(int material, uint64_t frame);
+
+            /// @brief Makes the textures used in the frame resident, evicting the least recently used ones
+            /// @param frame Number of the frame
+            void update(uint64_t frame);
+
+            inline const residency_statistics& statistics() const { return m_statistics; }
+
+        private:
+            /// @brief Residency of a tracked texture
+            struct texture_entry {
+                GLuint64 handle;
+                size_t bytes;
+                uint64_t last_used;     ///< Frame the texture was last drawn in
+                bool tracked;
+                bool resident;
+                bool requested;         ///< Used in the current frame while not resident
+                std::list<uint32_t>::iterator lru;  ///< Position in the LRU list, valid when resident
+            };
+
+            /// @brief Textures of a material
+            struct material_entry {
+                material_slots slots;
+                uint64_t last_marked;   ///< Frame the material was last marked in
+            };
+
+        private:
+            void m_evict(uint32_t slot);
+            void m_release(uint32_t slot);
+            void m_write_slot(uint32_t slot, GLuint64 handle);
+
+        private:
+            size_t m_budget;                            ///< Maximum resident memory in bytes, 0 for no limit
+            uint32_t m_keep_frames;                     ///< Minimum age of an evicted texture
+            GLuint m_slot_buffer;                       ///< Buffer of the texture pool
+            GLuint m_fallback_texture;                  ///< Texture sampled in place of non-resident ones
+            GLuint64 m_fallback_handle;                 ///< Handle of the fallback texture, always resident
+            std::vector<texture_entry> m_textures;      ///< Tracked textures, indexed by slot
+            std::vector<material_entry> m_materials;    ///< Textures of the materials, indexed by material
+            std::vector<uint32_t> m_requests;           ///< Slots waiting to be made resident
+            std::list<uint32_t> m_lru;                  ///< Resident slots, most recently used first
+            residency_statistics m_statistics;          ///< Statistics of the residency
+    };
+}
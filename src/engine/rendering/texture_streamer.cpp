@@ -0,0 +1,388 @@
+#include "texture_streamer.hpp"
+#include <algorithm>
+#include <iostream>
+#include "../utils/project_settings.hpp"
+#include "../assets/image_decoder.hpp"
+#include "../assets/ktx2.hpp"
+#include "../assets/texture.hpp"
+
+using namespace std;
+using namespace utils;
+using namespace rendering;
+
+/// @brief Size of a mip level, never below a single texel
+static glm::ivec2 level_size(const glm::ivec2& size, GLsizei level) {
+    return glm::ivec2(std::max(size.x >> level, 1), std::max(size.y >> level, 1));
+}
+
+texture_streamer::texture_streamer(uint32_t tail_size, uint32_t keep_frames)
+    : m_tail_size(tail_size), m_keep_frames(keep_frames), m_binding(0), m_slot_count(0),
+      m_feedback_buffers{}, m_feedback_data{}, m_feedback_written{}, m_stop(false) {}
+
+texture_streamer::~texture_streamer() {
+
+    if (m_worker.joinable()) {
+        {
+            lock_guard<mutex> lock(m_queue_mutex);
+            m_stop = true;
+        }
+        m_queue_signal.notify_all();
+        m_worker.join();
+    }
+
+    for (const auto& retired : m_retired) {
+        if (retired.resident)
+            glMakeTextureHandleNonResidentARB(retired.handle);
+        glDeleteTextures(1, &retired.texture);
+    }
+
+    for (GLuint buffer : m_feedback_buffers)
+        if (buffer != 0)
+            glDeleteBuffers(1, &buffer);
+}
+
+void texture_streamer::init(size_t slot_count, GLuint binding) {
+
+    m_slot_count = slot_count;
+    m_binding = binding;
+
+    /* Feedback is read back a few frames later, mapped buffers spare the synchronous readback */
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (size_t i = 0; i < m_feedback_buffers.size(); i++) {
+        glCreateBuffers(1, &m_feedback_buffers[i]);
+        glNamedBufferStorage(m_feedback_buffers[i], slot_count * sizeof(int), nullptr, flags);
+        m_feedback_data[i] = static_cast<int*>(glMapNamedBufferRange(m_feedback_buffers[i], 0, slot_count * sizeof(int), flags));
+    }
+
+    m_worker = std::thread(&texture_streamer::m_worker_loop, this);
+}
+
+void texture_streamer::track(uint32_t slot, const stream_source& source) {
+
+    if (slot >= m_entries.size())
+        m_entries.resize(slot + 1, stream_entry{{}, false, false, 0, c_no_feedback, 0});
+
+    stream_entry& entry = m_entries[slot];
+    entry.source = source;
+    entry.tracked = true;
+    entry.loading = false;
+    entry.generation++;
+    entry.window_min = c_no_feedback;
+    entry.window_start = 0;
+}
+
+void texture_streamer::untrack(uint32_t slot, uint64_t frame, bool resident) {
+
+    if (slot >= m_entries.size() || !m_entries[slot].tracked)
+        return;
+
+    /* Pending decode of the slot is thrown away once it finishes, the texture is retired as a replaced one would be */
+    stream_entry& entry = m_entries[slot];
+    entry.tracked = false;
+    entry.generation++;
+    m_retired.push_back(retired_texture{ frame, entry.source.texture, entry.source.handle, resident });
+}
+
+void texture_streamer::begin_frame(size_t frame_index, uint64_t frame, texture_residency& residency) {
+
+    /* Fence of the frame was passed, its feedback is complete */
+    if (m_feedback_written[frame_index]) {
+        m_process_feedback(m_feedback_data[frame_index]);
+        m_feedback_written[frame_index] = false;
+    }
+
+    /* Grow the textures whose finer levels were decoded */
+    vector<stream_result> results;
+    {
+        lock_guard<mutex> lock(m_queue_mutex);
+        size_t count = std::min<size_t>(m_results.size(), c_uploads_per_frame);
+        std::move(m_results.begin(), m_results.begin() + count, std::back_inserter(results));
+        m_results.erase(m_results.begin(), m_results.begin() + count);
+    }
+
+    for (auto& result : results) {
+
+        if (result.slot >= m_entries.size() || m_entries[result.slot].generation != result.generation)
+            continue;
+
+        stream_entry& entry = m_entries[result.slot];
+        entry.loading = false;
+        if (result.levels.empty() || result.level >= entry.source.top_level)
+            continue;
+
+        GLsizei levels = level_count(entry.source.size) - result.level;
+        GLuint texture = create_texture(entry.source.format, result.size, levels, entry.source.channels);
+        upload_levels(texture, entry.source.format, result.size, result.levels);
+        m_replace(result.slot, texture, result.level, frame, residency);
+    }
+
+    /* Shrink the textures whose finer levels went unsampled */
+    for (uint32_t slot = 0; slot < m_entries.size(); slot++) {
+
+        stream_entry& entry = m_entries[slot];
+        if (!entry.tracked || !entry.source.streamed || entry.loading || frame - entry.window_start < c_drop_window)
+            continue;
+
+        GLsizei level = std::min(entry.window_min, tail_level(entry.source.size, m_tail_size));
+        if (level > entry.source.top_level)
+            m_drop(slot, level, frame, residency);
+
+        entry.window_min = c_no_feedback;
+        entry.window_start = frame;
+    }
+
+    /* Replaced textures are deleted once no frame in flight may sample them */
+    auto expired = std::remove_if(m_retired.begin(), m_retired.end(), [&](const retired_texture& retired) {
+        if (retired.frame + m_keep_frames >= frame)
+            return false;
+
+        if (retired.resident)
+            glMakeTextureHandleNonResidentARB(retired.handle);
+        glDeleteTextures(1, &retired.texture);
+        return true;
+    });
+    m_retired.erase(expired, m_retired.end());
+
+    const int cleared = c_no_feedback;
+    glClearNamedBufferData(m_feedback_buffers[frame_index], GL_R32I, GL_RED_INTEGER, GL_INT, &cleared);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_binding, m_feedback_buffers[frame_index]);
+}
+
+void texture_streamer::end_frame(size_t frame_index) {
+
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    m_feedback_written[frame_index] = true;
+}
+
+GLsizei texture_streamer::level_count(const glm::ivec2& size) {
+
+    GLsizei levels = 1;
+    for (int extent = std::max(size.x, size.y); extent > 1; extent >>= 1)
+        levels++;
+    return levels;
+}
+
+GLsizei texture_streamer::tail_level(const glm::ivec2& size, uint32_t tail_size) {
+
+    if (tail_size == 0)
+        return 0;
+
+    GLsizei level = 0;
+    for (int extent = std::max(size.x, size.y); extent > static_cast<int>(tail_size); extent >>= 1)
+        level++;
+    return level;
+}
+
+size_t texture_streamer::memory_size(GLenum format, const glm::ivec2& size, GLsizei levels) {
+
+    size_t bytes = 0;
+    int stored = components(format);
+    for (GLsizei level = 0; level < levels; level++) {
+        glm::ivec2 extent = level_size(size, level);
+        bytes += stored != 0 ? static_cast<size_t>(extent.x) * extent.y * stored : assets::ktx2_image::level_bytes(format, extent);
+    }
+    return bytes;
+}
+
+int texture_streamer::components(GLenum format) {
+
+    switch (format) {
+        case GL_R8: return 1;
+        case GL_RG8: return 2;
+        case GL_RGB8: return 3;
+        case GL_RGBA8: return 4;
+        default: return 0;
+    }
+}
+
+GLenum texture_streamer::pixel_format(GLenum format) {
+
+    static constexpr GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    int stored = components(format);
+    return stored == 0 ? 0 : formats[stored - 1];
+}
+
+std::array<GLint, 4> texture_streamer::swizzle(GLenum format, int channels) {
+
+    if ((format == GL_R8 || format == GL_COMPRESSED_RED_RGTC1) && channels == 1)
+        return { GL_RED, GL_RED, GL_RED, GL_RED };
+    if (format == GL_R8 && channels == 2)
+        return { GL_RED, GL_RED, GL_RED, GL_ONE };
+    if (format == GL_RG8 && channels <= 2)
+        return { GL_RED, GL_RED, GL_RED, GL_GREEN };
+    return { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+}
+
+vector<uint8_t> texture_streamer::downsample(const uint8_t* pixels, glm::ivec2& size, GLsizei levels, int components) {
+
+    vector<uint8_t> current(pixels, pixels + static_cast<size_t>(size.x) * size.y * components);
+
+    for (GLsizei level = 0; level < levels && (size.x > 1 || size.y > 1); level++) {
+
+        /* 2x2 box filter, odd edges clamp to the last texel */
+        glm::ivec2 next_size = level_size(size, 1);
+        vector<uint8_t> next(static_cast<size_t>(next_size.x) * next_size.y * components);
+
+        for (int y = 0; y < next_size.y; y++) {
+            int y0 = std::min(2 * y, size.y - 1), y1 = std::min(2 * y + 1, size.y - 1);
+
+            for (int x = 0; x < next_size.x; x++) {
+                int x0 = std::min(2 * x, size.x - 1), x1 = std::min(2 * x + 1, size.x - 1);
+
+                for (int c = 0; c < components; c++) {
+                    unsigned sum =
+                        current[(static_cast<size_t>(y0) * size.x + x0) * components + c] + current[(static_cast<size_t>(y0) * size.x + x1) * components + c] +
+                        current[(static_cast<size_t>(y1) * size.x + x0) * components + c] + current[(static_cast<size_t>(y1) * size.x + x1) * components + c];
+                    next[(static_cast<size_t>(y) * next_size.x + x) * components + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        current.swap(next);
+        size = next_size;
+    }
+
+    return current;
+}
+
+GLuint texture_streamer::create_texture(GLenum format, const glm::ivec2& size, GLsizei levels, int channels) {
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, project_settings::tex_min_filter());
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, project_settings::tex_mag_filter());
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureStorage2D(texture, levels, format, size.x, size.y);
+
+    /* Narrow formats are swizzled back to what the shaders expect, e.g. b&w image, not just R */
+    std::array<GLint, 4> texel_swizzle = swizzle(format, channels);
+    glTextureParameteriv(texture, GL_TEXTURE_SWIZZLE_RGBA, texel_swizzle.data());
+
+    return texture;
+}
+
+void texture_streamer::upload_levels(GLuint texture, GLenum format, const glm::ivec2& size, const vector<vector<uint8_t>>& levels) {
+
+    /* Rows of narrow formats are tightly packed */
+    GLenum pixels = pixel_format(format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (GLsizei level = 0; level < static_cast<GLsizei>(levels.size()); level++) {
+
+        glm::ivec2 extent = level_size(size, level);
+        if (pixels != 0)
+            glTextureSubImage2D(texture, level, 0, 0, extent.x, extent.y, pixels, GL_UNSIGNED_BYTE, levels[level].data());
+        else
+            glCompressedTextureSubImage2D(texture, level, 0, 0, extent.x, extent.y, format, levels[level].size(), levels[level].data());
+    }
+
+    /* Cooked textures carry their levels, images get theirs generated */
+    if (pixels != 0 && level_size(size, levels.size() - 1) != glm::ivec2(1))
+        glGenerateTextureMipmap(texture);
+}
+
+void texture_streamer::m_worker_loop() {
+
+    while (true) {
+
+        stream_job job;
+        {
+            unique_lock<mutex> lock(m_queue_mutex);
+            m_queue_signal.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        stream_result result{ job.slot, job.generation, job.level, glm::ivec2(0), {} };
+
+        /* Cooked textures are read from the requested level on, images are decoded whole and filtered down */
+        if (components(job.format) == 0) {
+            try {
+                assets::ktx2_image image = assets::ktx2_image::load(job.path, job.level);
+                result.level = image.first_level();
+                result.size = level_size(image.size(), image.first_level());
+                result.levels = image.levels();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[WARNING] Unable to stream texture " << job.path << ": " << e.what() << std::endl;
+            }
+        }
+        else {
+            try {
+                int channels;
+                GLenum format = job.format;
+                vector<uint8_t> pixels = assets::texture::decode(job.path, format, result.size, channels);
+                result.levels.push_back(downsample(pixels.data(), result.size, job.level, components(format)));
+                assets::image_decoder::recycle(std::move(pixels));
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[WARNING] Unable to stream image " << job.path << ": " << e.what() << std::endl;
+            }
+        }
+
+        lock_guard<mutex> lock(m_queue_mutex);
+        m_results.push_back(std::move(result));
+    }
+}
+
+void texture_streamer::m_process_feedback(const int* feedback) {
+
+    size_t count = std::min(m_entries.size(), m_slot_count);
+    for (uint32_t slot = 0; slot < count; slot++) {
+
+        stream_entry& entry = m_entries[slot];
+        if (!entry.tracked || !entry.source.streamed || feedback[slot] == c_no_feedback)
+            continue;
+
+        /* Shaders report levels relative to the texture they sampled */
+        GLsizei level = std::clamp(entry.source.top_level + feedback[slot], 0, level_count(entry.source.size) - 1);
+        entry.window_min = std::min(entry.window_min, level);
+
+        if (level < entry.source.top_level && !entry.loading) {
+            entry.loading = true;
+            {
+                lock_guard<mutex> lock(m_queue_mutex);
+                m_jobs.push_back(stream_job{ slot, entry.generation, entry.source.path, entry.source.format, level });
+            }
+            m_queue_signal.notify_one();
+        }
+    }
+}
+
+void texture_streamer::m_replace(uint32_t slot, GLuint texture, GLsizei top_level, uint64_t frame, texture_residency& residency) {
+
+    stream_entry& entry = m_entries[slot];
+    glm::ivec2 size = level_size(entry.source.size, top_level);
+    GLuint64 handle = glGetTextureHandleARB(texture);
+
+    bool resident = residency.replace(slot, handle, memory_size(entry.source.format, size, level_count(entry.source.size) - top_level));
+    m_retired.push_back(retired_texture{ frame, entry.source.texture, entry.source.handle, resident });
+
+    entry.source.texture = texture;
+    entry.source.handle = handle;
+    entry.source.top_level = top_level;
+}
+
+void texture_streamer::m_drop(uint32_t slot, GLsizei level, uint64_t frame, texture_residency& residency) {
+
+    stream_entry& entry = m_entries[slot];
+    GLsizei levels = level_count(entry.source.size) - level;
+    glm::ivec2 size = level_size(entry.source.size, level);
+
+    /* Coarser levels are already on the GPU, they are copied over instead of decoded again */
+    GLuint texture = create_texture(entry.source.format, size, levels, entry.source.channels);
+    for (GLsizei i = 0; i < levels; i++) {
+        glm::ivec2 extent = level_size(size, i);
+        glCopyImageSubData(
+            entry.source.texture, GL_TEXTURE_2D, level - entry.source.top_level + i, 0, 0, 0,
+            texture, GL_TEXTURE_2D, i, 0, 0, 0,
+            extent.x, extent.y, 1
+        );
+    }
+
+    m_replace(slot, texture, level, frame, residency);
+}
@@ -0,0 +1,194 @@
+///
+/// @file texture_streamer.hpp
+/// @author geffevil
+///
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "texture_residency.hpp"
+#include "../utils/gpu_memory.hpp"
+#include "../../lib/glad/glad.h"
+
+namespace rendering {
+
+    /// @brief Streams mip levels of the textures, driven by the levels the GPU actually samples
+    ///
+    /// Textures are loaded with their mip tail only. Fragment shaders report the finest level they would sample
+    /// into a feedback buffer, which is read back once its frame is done. Finer levels are decoded on a background
+    /// thread and the texture is replaced by a larger one, levels unused for a while are dropped again.
+    /// Bindless textures are immutable, so every change creates a new texture object and handle - the old ones
+    /// are retired once no frame in flight may sample them. Except for the static helpers, methods have to be called
+    /// on the renderer's context
+    class texture_streamer {
+
+        public:
+            static constexpr uint32_t c_drop_window = 240;      ///< Frames a level has to go unsampled for to be dropped
+            static constexpr uint32_t c_uploads_per_frame = 2;  ///< Streamed textures replaced in a single frame, bounds the hitches
+            static constexpr int c_no_feedback = INT32_MAX;     ///< Feedback value of a texture which was not sampled
+
+            /// @brief Texture being streamed
+            struct stream_source {
+                std::string path;       ///< Image or cooked file the levels are read from
+                glm::ivec2 size;        ///< Size of the full resolution level
+                int channels;           ///< Channels of the source image, decides the swizzle together with @c format
+                GLenum format;          ///< Internal format, block-compressed textures are streamed from their KTX2 levels
+                GLuint texture;         ///< Texture object holding the resident levels
+                GLuint64 handle;        ///< Bindless handle of @c texture
+                GLsizei top_level;      ///< Finest level held by @c texture
+                bool streamed;          ///< Whether the levels follow the feedback, textures loaded whole are left as they are
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param tail_size Largest size of the levels loaded up front, 0 disables streaming
+            /// @param keep_frames Frames a replaced texture is kept alive for, so no frame in flight samples a deleted one
+            texture_streamer(uint32_t tail_size, uint32_t keep_frames);
+            texture_streamer(const texture_streamer&) = delete;
+            ~texture_streamer();
+
+            /// @brief Creates the feedback buffers and starts the loading thread
+            /// @param slot_count Number of slots of the texture pool
+            /// @param binding Binding point of the feedback buffer
+            void init(size_t slot_count, GLuint binding);
+
+            /// @brief Starts streaming a texture, the streamer takes ownership of its texture object
+            /// @param slot Slot of the texture in the pool
+            /// @param source Texture to be streamed
+            void track(uint32_t slot, const stream_source& source);
+
+            /// @brief Stops streaming a texture, its texture object is deleted once no frame in flight may sample it
+            /// @param slot Slot of the texture in the pool
+            /// @param frame Number of the last frame which may sample the texture
+            /// @param resident Whether the texture's handle is resident, as released by @c texture_residency::untrack
+            void untrack(uint32_t slot, uint64_t frame, bool resident);
+
+            /// @brief Reads the feedback of the frame which used the buffer last, replaces textures and binds a cleared buffer
+            ///
+            /// Has to be called once the frame's fence was passed
+            /// @param frame_index Index of the frame in flight
+            /// @param frame Number of the frame
+            /// @param residency Residency of the streamed textures
+            void begin_frame(size_t frame_index, uint64_t frame, texture_residency& residency);
+
+            /// @brief Makes the frame's feedback visible to the CPU, has to be called before the frame's fence
+            /// @param frame_index Index of the frame in flight
+            void end_frame(size_t frame_index);
+
+            /// @brief Number of levels of a full mip chain
+            static GLsizei level_count(const glm::ivec2& size);
+
+            /// @brief First level no larger than the tail size
+            static GLsizei tail_level(const glm::ivec2& size, uint32_t tail_size);
+
+            /// @brief Memory occupied by a chain of levels in bytes
+            static size_t memory_size(GLenum format, const glm::ivec2& size, GLsizei levels);
+
+            /// @brief Number of 8-bit channels stored per texel of an uncompressed format, 0 for block-compressed ones
+            static int components(GLenum format);
+
+            /// @brief Pixel transfer format of an uncompressed internal format
+            static GLenum pixel_format(GLenum format);
+
+            /// @brief Swizzle presenting a texture to the shaders the way an RGBA8 copy of its image would read
+            ///
+            /// Grey images stored as R8 or BC4 read as grey, grey images with alpha stored as RG8 read as grey with alpha.
+            /// Other textures are read as stored, so RG8 normal maps sample as (x, y, 0, 1)
+            /// @param format Internal format
+            /// @param channels Channels of the source image
+            static std::array<GLint, 4> swizzle(GLenum format, int channels);
+
+            /// @brief Box-filters 8-bit pixels down by a number of levels
+            /// @param pixels Pixels of the image
+            /// @param size Size of the image, replaced by the size of the result
+            /// @param levels Number of levels to go down by
+            /// @param components Channels per pixel
+            /// @returns Pixels of the downsampled image
+            static std::vector<uint8_t> downsample(const uint8_t* pixels, glm::ivec2& size, GLsizei levels, int components);
+
+            /// @brief Creates an empty texture with the engine's sampling parameters
+            /// @param format Internal format
+            /// @param size Size of the first level
+            /// @param levels Number of levels
+            /// @param channels Channels of the source image, picks the swizzle
+            /// @returns Texture object
+            static GLuint create_texture(GLenum format, const glm::ivec2& size, GLsizei levels, int channels);
+
+            /// @brief Uploads levels of a texture, starting with the first
+            /// @param texture Texture object
+            /// @param format Internal format of the texture, uncompressed levels missing from @p levels are generated
+            /// @param size Size of the first level
+            /// @param levels Pixels or blocks of the levels, finest first
+            static void upload_levels(GLuint texture, GLenum format, const glm::ivec2& size, const std::vector<std::vector<uint8_t>>& levels);
+
+        private:
+            /// @brief Streaming state of a texture
+            struct stream_entry {
+                stream_source source;
+                bool tracked;
+                bool loading;           ///< Whether finer levels are being decoded
+                uint32_t generation;    ///< Incremented on every track, results of older requests are thrown away
+                int window_min;         ///< Finest level sampled in the current window
+                uint64_t window_start;  ///< Frame the current window started in
+            };
+
+            /// @brief Request to decode a level
+            struct stream_job {
+                uint32_t slot;
+                uint32_t generation;
+                std::string path;
+                GLenum format;
+                GLsizei level;
+            };
+
+            /// @brief Decoded level
+            struct stream_result {
+                uint32_t slot;
+                uint32_t generation;
+                GLsizei level;
+                glm::ivec2 size;
+                std::vector<std::vector<uint8_t>> levels;   ///< Pixels or blocks of the levels, empty on failure
+            };
+
+            /// @brief Replaced texture, deleted once no frame in flight may use it
+            struct retired_texture {
+                uint64_t frame;
+                GLuint texture;
+                GLuint64 handle;
+                bool resident;
+            };
+
+        private:
+            void m_worker_loop();
+            void m_process_feedback(const int* feedback);
+            void m_replace(uint32_t slot, GLuint texture, GLsizei top_level, uint64_t frame, texture_residency& residency);
+            void m_drop(uint32_t slot, GLsizei level, uint64_t frame, texture_residency& residency);
+
+        private:
+            uint32_t m_tail_size;                       ///< Largest size of the levels loaded up front
+            uint32_t m_keep_frames;                     ///< Frames a replaced texture is kept alive for
+            GLuint m_binding;                           ///< Binding point of the feedback buffer
+            size_t m_slot_count;                        ///< Number of slots of the texture pool
+            std::vector<stream_entry> m_entries;        ///< Streamed textures, indexed by slot
+            std::vector<retired_texture> m_retired;     ///< Replaced and untracked textures, waiting for deletion
+
+            /* Feedback, one buffer per frame in flight */
+            std::array<GLuint, utils::gpu_frame_sync::c_frames_in_flight> m_feedback_buffers;   ///< Finest sampled level of every slot
+            std::array<int*, utils::gpu_frame_sync::c_frames_in_flight> m_feedback_data;        ///< Persistently mapped feedback buffers
+            std::array<bool, utils::gpu_frame_sync::c_frames_in_flight> m_feedback_written;     ///< Whether the buffer holds a finished frame's feedback
+
+            /* Loading thread */
+            std::thread m_worker;                       ///< Thread decoding the requested levels
+            std::mutex m_queue_mutex;                   ///< Guards the jobs, results and the stop flag
+            std::condition_variable m_queue_signal;     ///< Signaled when a job is queued or the thread should stop
+            std::deque<stream_job> m_jobs;              ///< Levels waiting to be decoded
+            std::vector<stream_result> m_results;       ///< Decoded levels waiting for upload
+            bool m_stop;                                ///< Signals the loading thread to finish
+    };
+}
@@ -0,0 +1,326 @@
+#include "upload_queue.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "texture_streamer.hpp"
+#include "../game_window.hpp"
+#include "../utils/cpu_profiler.hpp"
+
+using namespace std;
+using namespace rendering;
+
+/// @brief Size of a mip level, never below a single texel
+static glm::ivec2 level_size(const glm::ivec2& size, size_t level) {
+    return glm::ivec2(std::max(size.x >> level, 1), std::max(size.y >> level, 1));
+}
+
+/// @brief Offset rounded up to the staging alignment
+static size_t align(size_t offset) {
+    return (offset + upload_queue::c_staging_alignment - 1) / upload_queue::c_staging_alignment * upload_queue::c_staging_alignment;
+}
+
+/// @brief Writes levels of a texture from the bound unpack buffer, or from CPU memory when none is bound
+/// @param offsets Offsets of the levels within the unpack buffer, null to read from @p levels
+static void write_levels(GLuint texture, GLenum format, const glm::ivec2& size, const vector<vector<uint8_t>>& levels, const vector<size_t>* offsets) {
+
+    GLenum pixels = texture_streamer::pixel_format(format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (size_t level = 0; level < levels.size(); level++) {
+
+        glm::ivec2 extent = level_size(size, level);
+        const void* data = offsets != nullptr ? reinterpret_cast<const void*>((*offsets)[level]) : levels[level].data();
+        if (pixels != 0)
+            glTextureSubImage2D(texture, level, 0, 0, extent.x, extent.y, pixels, GL_UNSIGNED_BYTE, data);
+        else
+            glCompressedTextureSubImage2D(texture, level, 0, 0, extent.x, extent.y, format, levels[level].size(), data);
+    }
+
+    /* Cooked textures carry their levels, images get theirs generated */
+    if (pixels != 0 && level_size(size, levels.size() - 1) != glm::ivec2(1))
+        glGenerateTextureMipmap(texture);
+}
+
+upload_queue::upload_queue(size_t staging_size)
+    : m_staging_size(staging_size), m_stop(false), m_staging_buffer(0), m_staging_data(nullptr), m_staging_head(0), m_staging_used(0) {}
+
+upload_queue::~upload_queue() {
+
+    stop();
+}
+
+void upload_queue::start(game_window& window) {
+
+    if (m_thread.joinable())
+        return;
+
+    /* GLFW creates contexts on the main thread only */
+    window.create_shared_context(game_window::shared_context::UPLOAD);
+    m_stop = false;
+    m_thread = std::thread(&upload_queue::m_worker_loop, this, &window);
+}
+
+void upload_queue::stop() {
+
+    if (!m_thread.joinable())
+        return;
+
+    {
+        lock_guard<mutex> lock(m_queue_mutex);
+        m_stop = true;
+    }
+
+    m_queue_signal.notify_one();
+    m_thread.join();
+}
+
+upload_queue::ticket upload_queue::upload_buffer(GLuint buffer, size_t offset, const void* data, size_t size) {
+
+    if (!running()) {
+        glNamedBufferSubData(buffer, offset, size, data);
+        return nullptr;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    return m_queue(upload_job{ upload_job::job_type::BUFFER, buffer, offset, 0, glm::ivec2(0), { vector<uint8_t>(bytes, bytes + size) }, nullptr, nullptr });
+}
+
+upload_queue::ticket upload_queue::upload_texture(GLuint texture, GLenum format, const glm::ivec2& size, vector<vector<uint8_t>> levels) {
+
+    if (!running()) {
+        write_levels(texture, format, size, levels, nullptr);
+        return nullptr;
+    }
+
+    return m_queue(upload_job{ upload_job::job_type::TEXTURE, texture, 0, format, size, std::move(levels), nullptr, nullptr });
+}
+
+void upload_queue::delete_texture(GLuint texture) {
+
+    if (texture == 0)
+        return;
+
+    if (!running()) {
+        glDeleteTextures(1, &texture);
+        return;
+    }
+
+    m_queue(upload_job{ upload_job::job_type::DELETE_TEXTURE, texture, 0, 0, glm::ivec2(0), {}, nullptr, nullptr });
+}
+
+void upload_queue::when_ready(const ticket& upload, function<void()> callback) {
+
+    {
+        lock_guard<mutex> lock(m_queue_mutex);
+        if (!ready(upload)) {
+            upload->callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+
+    callback();
+}
+
+bool upload_queue::cancel(const ticket& upload) {
+
+    if (!upload)
+        return false;
+
+    lock_guard<mutex> lock(m_queue_mutex);
+    bool pending = !upload->callbacks.empty();
+    upload->callbacks.clear();
+    return pending;
+}
+
+void upload_queue::poll() {
+
+    vector<function<void()>> callbacks;
+    {
+        lock_guard<mutex> lock(m_queue_mutex);
+        for (auto& state : m_completed) {
+            std::move(state->callbacks.begin(), state->callbacks.end(), std::back_inserter(callbacks));
+            state->callbacks.clear();
+        }
+        m_completed.clear();
+    }
+
+    for (auto& callback : callbacks)
+        callback();
+}
+
+upload_queue::ticket upload_queue::m_queue(upload_job job) {
+
+    /* Objects were just created on the queueing context, the upload context waits for them on the GPU */
+    job.objects_ready = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    job.state = std::make_shared<upload_state>();
+    job.state->done = false;
+    ticket state = job.state;
+    {
+        lock_guard<mutex> lock(m_queue_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+
+    m_queue_signal.notify_one();
+    return state;
+}
+
+void upload_queue::m_worker_loop(game_window* window) {
+
+    window->make_shared_current(game_window::shared_context::UPLOAD);
+
+    /* Written by the CPU only, the GPU reads it as the source of copies */
+    glCreateBuffers(1, &m_staging_buffer);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(m_staging_buffer, m_staging_size, nullptr, flags);
+    m_staging_data = static_cast<uint8_t*>(glMapNamedBufferRange(m_staging_buffer, 0, m_staging_size, flags));
+    m_staging_head = 0;
+    m_staging_used = 0;
+
+    while (true) {
+
+        deque<upload_job> jobs;
+        bool stopping;
+        {
+            /* Uploads in flight are polled every millisecond, the rest of the time the thread sleeps */
+            unique_lock<mutex> lock(m_queue_mutex);
+            auto woken = [this] { return m_stop || !m_jobs.empty(); };
+            if (m_inflight.empty())
+                m_queue_signal.wait(lock, woken);
+            else
+                m_queue_signal.wait_for(lock, chrono::milliseconds(1), woken);
+
+            jobs.swap(m_jobs);
+            stopping = m_stop;
+        }
+
+        for (auto& job : jobs)
+            m_execute(job);
+
+        /* Queued jobs were taken along with the stop flag, nothing is left but waiting for the GPU */
+        m_retire(stopping);
+        if (stopping)
+            break;
+    }
+
+    glUnmapNamedBuffer(m_staging_buffer);
+    glDeleteBuffers(1, &m_staging_buffer);
+    m_staging_buffer = 0;
+    m_staging_data = nullptr;
+    window->release_current();
+}
+
+void upload_queue::m_execute(upload_job& job) {
+
+    PROFILE_ZONE("upload_queue::upload");
+    glWaitSync(job.objects_ready, 0, GL_TIMEOUT_IGNORED);
+    glDeleteSync(job.objects_ready);
+
+    size_t taken = 0;
+    switch (job.type) {
+
+        case upload_job::job_type::DELETE_TEXTURE:
+            glDeleteTextures(1, &job.object);
+            break;
+
+        case upload_job::job_type::BUFFER: {
+            const vector<uint8_t>& data = job.data.front();
+            size_t offset = m_reserve(data.size(), taken);
+            if (offset == SIZE_MAX) {
+                glNamedBufferSubData(job.object, job.offset, data.size(), data.data());
+                break;
+            }
+
+            memcpy(m_staging_data + offset, data.data(), data.size());
+            glCopyNamedBufferSubData(m_staging_buffer, job.object, offset, job.offset, data.size());
+            break;
+        }
+
+        case upload_job::job_type::TEXTURE: {
+            size_t bytes = 0;
+            for (const auto& level : job.data)
+                bytes = align(bytes) + level.size();
+
+            size_t offset = m_reserve(bytes, taken);
+            if (offset == SIZE_MAX) {
+                write_levels(job.object, job.format, job.size, job.data, nullptr);
+                break;
+            }
+
+            /* Levels are staged back to back, the texture reads them through the unpack buffer */
+            vector<size_t> offsets;
+            for (const auto& level : job.data) {
+                offsets.push_back(offset);
+                memcpy(m_staging_data + offset, level.data(), level.size());
+                offset = align(offset + level.size());
+            }
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging_buffer);
+            write_levels(job.object, job.format, job.size, job.data, &offsets);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            break;
+        }
+    }
+
+    m_inflight.push_back(inflight_upload{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), taken, job.state });
+    glFlush();
+}
+
+size_t upload_queue::m_reserve(size_t bytes, size_t& taken) {
+
+    taken = 0;
+    if (bytes == 0 || align(bytes) > m_staging_size)
+        return SIZE_MAX;
+
+    /* Ring of staged uploads, the end too short for the upload is skipped over */
+    bytes = align(bytes);
+    bool wrap;
+    size_t padding;
+    while (true) {
+
+        if (m_staging_used == 0)
+            m_staging_head = 0;
+
+        /* Upload which does not fit at the head wraps, including one right after an upload ending at the very end */
+        wrap = m_staging_head + bytes > m_staging_size;
+        padding = wrap ? m_staging_size - m_staging_head : 0;
+        if (m_staging_used + padding + bytes <= m_staging_size)
+            break;
+
+        /* Oldest uploads free their space first, the GPU is waited for */
+        if (glClientWaitSync(m_inflight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) == GL_WAIT_FAILED)
+            std::cerr << "[ERROR] Waiting for an upload failed" << std::endl;
+        m_retire(false);
+    }
+
+    size_t offset = wrap ? 0 : m_staging_head;
+    m_staging_head = offset + bytes;
+    m_staging_used += padding + bytes;
+    taken = padding + bytes;
+    return offset;
+}
+
+void upload_queue::m_retire(bool wait) {
+
+    while (!m_inflight.empty()) {
+
+        inflight_upload& upload = m_inflight.front();
+        GLenum result = glClientWaitSync(upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? UINT64_MAX : 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+            return;
+
+        glDeleteSync(upload.fence);
+        m_staging_used -= upload.staging_bytes;
+        m_complete(upload.state);
+        m_inflight.pop_front();
+    }
+}
+
+void upload_queue::m_complete(const ticket& state) {
+
+    lock_guard<mutex> lock(m_queue_mutex);
+    state->done = true;
+    if (!state->callbacks.empty())
+        m_completed.push_back(state);
+}
@@ -0,0 +1,141 @@
+///
+/// @file upload_queue.hpp
+/// @author geffevil
+///
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../lib/glad/glad.h"
+
+class game_window;
+
+namespace rendering {
+
+    /// @brief Uploads texture and geometry data on a thread with its own context, sharing objects with the others
+    ///
+    /// Assets create their objects and queue the data. The upload thread copies it into a persistently mapped staging
+    /// buffer and from there into the objects, so neither the simulation nor the render thread waits for the transfer.
+    /// Every upload is fenced and they complete in the order they were queued - a ticket is ready once its data and the
+    /// data queued before it is on the GPU, assets must not be drawn before. Without a running thread the data is uploaded
+    /// right away on the calling context. Methods are called by the simulation, or the main thread while loading
+    class upload_queue {
+
+        public:
+            static constexpr size_t c_staging_alignment = 256;  ///< Alignment of the staged uploads within the staging buffer
+
+            /// @brief Completion of an upload
+            struct upload_state {
+                std::atomic<bool> done;                         ///< Whether the data is on the GPU
+                std::vector<std::function<void()>> callbacks;   ///< Run by @c poll once done, guarded by the queue
+            };
+
+            /// @brief Completion shared with the asset waiting for it, null for uploads which were done right away
+            using ticket = std::shared_ptr<upload_state>;
+
+        public:
+            /// @brief Constructor
+            /// @param staging_size Size of the staging buffer, larger uploads are copied straight from the CPU memory
+            upload_queue(size_t staging_size);
+            upload_queue(const upload_queue&) = delete;
+
+            /// @brief Destructor, finishes the uploads
+            ~upload_queue();
+
+            /// @brief Starts the upload thread
+            /// @param window Window owning the contexts, has to be called on the main thread
+            void start(game_window& window);
+
+            /// @brief Finishes all the queued uploads and joins the upload thread, their callbacks are left to @c poll
+            void stop();
+
+            inline bool running() const { return m_thread.joinable(); }
+
+            /// @brief Queues data to be written into a buffer
+            /// @param buffer Buffer object, has to exist until the upload is done
+            /// @param offset Offset of the data within the buffer
+            /// @param data Data to be written
+            /// @param size Size of the data in bytes
+            /// @returns Completion of the upload
+            ticket upload_buffer(GLuint buffer, size_t offset, const void* data, size_t size);
+
+            /// @brief Queues levels of a texture, see @c texture_streamer::upload_levels
+            /// @param texture Texture object, to be deleted through @c delete_texture only
+            /// @param format Internal format of the texture, uncompressed levels missing from @p levels are generated
+            /// @param size Size of the first level
+            /// @param levels Pixels or blocks of the levels, finest first
+            /// @returns Completion of the upload
+            ticket upload_texture(GLuint texture, GLenum format, const glm::ivec2& size, std::vector<std::vector<uint8_t>> levels);
+
+            /// @brief Deletes a texture once the uploads queued before are done, so none of them writes into a recycled name
+            void delete_texture(GLuint texture);
+
+            /// @brief Whether the data of an upload is on the GPU
+            static inline bool ready(const ticket& upload) { return !upload || upload->done; }
+
+            /// @brief Runs a callback once an upload is done, right away if it is done already
+            /// @param upload Completion of the upload
+            /// @param callback Work to be run by @c poll on the simulation's thread
+            void when_ready(const ticket& upload, std::function<void()> callback);
+
+            /// @brief Drops the callbacks of an upload
+            /// @returns Whether there were callbacks which did not run yet
+            bool cancel(const ticket& upload);
+
+            /// @brief Runs the callbacks of the uploads done since the last call, called by the simulation once a frame
+            void poll();
+
+        private:
+            /// @brief Queued upload
+            struct upload_job {
+                enum class job_type { BUFFER, TEXTURE, DELETE_TEXTURE } type;
+                GLuint object;                              ///< Buffer or texture written into
+                size_t offset;                              ///< Offset within a buffer
+                GLenum format;                              ///< Internal format of a texture
+                glm::ivec2 size;                            ///< Size of the texture's first level
+                std::vector<std::vector<uint8_t>> data;     ///< Levels of a texture, or a single range of a buffer
+                GLsync objects_ready;                       ///< Fence of the queueing context, its objects exist once passed
+                ticket state;
+            };
+
+            /// @brief Upload submitted to the GPU
+            struct inflight_upload {
+                GLsync fence;
+                size_t staging_bytes;                       ///< Bytes of the staging buffer taken up, including the padding
+                ticket state;
+            };
+
+        private:
+            void m_worker_loop(game_window* window);
+            ticket m_queue(upload_job job);
+            void m_execute(upload_job& job);
+            size_t m_reserve(size_t bytes, size_t& taken);
+            void m_retire(bool wait);
+            void m_complete(const ticket& state);
+
+        private:
+            size_t m_staging_size;                      ///< Size of the staging buffer
+            std::thread m_thread;                       ///< Upload thread, owns the upload context
+
+            std::mutex m_queue_mutex;                   ///< Guards the jobs, the callbacks and the stop flag
+            std::condition_variable m_queue_signal;     ///< Signaled when a job is queued or the thread should stop
+            std::deque<upload_job> m_jobs;              ///< Uploads waiting for the thread
+            std::vector<ticket> m_completed;            ///< Done uploads with callbacks waiting for @c poll
+            bool m_stop;                                ///< Signals the thread to finish
+
+            /* Owned by the upload thread */
+            GLuint m_staging_buffer;                    ///< Persistently mapped staging buffer, doubles as the unpack buffer of textures
+            uint8_t* m_staging_data;                    ///< Mapped staging memory
+            size_t m_staging_head;                      ///< Offset the next staged upload is written at
+            size_t m_staging_used;                      ///< Bytes taken up by the uploads in flight
+            std::deque<inflight_upload> m_inflight;     ///< Uploads submitted to the GPU, oldest first
+    };
+}
@@ -4,6 +4,7 @@
 #include "events.hpp"
 #include "game_window.hpp"
 #include "scene/scene_node.hpp"
+#include "utils/cpu_profiler.hpp"
 #include "utils/project_settings.hpp"
 
 #include <GLFW/glfw3.h>
@@ -75,42 +76,98 @@ engine_runtime::engine_runtime(game_window& window)
     m_renderer.init();
     m_events.apply_callbacks(window);
     
-    glfwSetWindowCloseCallback(window.props().glfw_handle, [](GLFWwindow*) { engine_runtime::s_instance->m_window.close(); });
+    if (window.props().glfw_handle != nullptr)
+        glfwSetWindowCloseCallback(window.props().glfw_handle, [](GLFWwindow*) { engine_runtime::s_instance->m_window.close(); });
     glViewport(0, 0, window.props().current_mode.size().x, window.props().current_mode.size().y);
 };
 
 engine_runtime::~engine_runtime() {
 
+    /* Background loads still reading their files are waited for, the rest fail */
+    assets::loader::stop();
+
+    /* Released assets are destroyed while the renderer is still around, so are those released from now on */
+    assets::loader::invalidate();
+    assets::loader::budget(0);
+
+    /* Finish the uploads, their callbacks still queue render tasks for the render thread to run */
+    m_renderer.uploads().stop();
+    m_renderer.uploads().poll();
+
+    /* Take the window's context back from the render thread, the rest of the teardown runs here */
+    m_renderer.stop_render_thread();
+
     /* Delete the scene */
     delete m_root_node;
 }
 
-void engine_runtime::start() {           
+void engine_runtime::start(benchmark* bench) {           
 
     /* Setup timekeeping */
-    system_clock::time_point tp_prev = system_clock::now(), 
+    steady_clock::time_point tp_prev = steady_clock::now(), 
                              tp_now;
 
     float physics_delta = 0.0f;
     float physics_interval = project_settings::physics_interval();
 
+    /* Capture the first frames, when built with the profiler */
+    if (project_settings::profile_capture_frames() > 0) {
+        PROFILE_CAPTURE(project_settings::profile_capture_frames(), project_settings::profile_capture_path());
+    }
+
+    /* Assets upload their data on a thread of its own, so loading mid-game does not stall the frames */
+    if (project_settings::upload_thread())
+        m_renderer.uploads().start(m_window);
+
+    /* Background loads read their files on threads of their own, this thread finishes them */
+    assets::loader::start(project_settings::load_threads());
+    assets::loader::budget(project_settings::asset_cache_budget());
+
     /* Load the initial scene */
-    auto initial_scene = assets::loader::load<assets::scene_template>(project_settings::default_scene_path());
+    auto initial_scene = assets::loader::load<assets::scene_template>(
+        bench != nullptr ? bench->scene() : project_settings::default_scene_path()
+    );
     root_node(initial_scene->instantiate());
 
     /* Check if renderer has a valid camera */
     if (!m_renderer.has_active_camera())
         cerr << "No main camera found in the scene! For rendering to work, you'll need to set one up manually" << std::endl;
 
+    /* Drawing moves to its own thread with the window's context, simulation keeps a shared one for its uploads */
+    if (project_settings::render_thread()) {
+        m_window.make_shared_current();
+        m_renderer.start_render_thread();
+    }
+
     /* Mainloop */
     while (!m_window.props().is_closing) {
         
         m_events.process_frame();
+        assets::loader::poll();
+
+        /* Frames are presented on the render thread, which only reports the limit */
+        if (m_window.frame_limit_reached()) {
+            m_window.close();
+            break;
+        }
 
-        /* Calculate time elapsed since last frame */
-        tp_now = system_clock::now();
-        float elapsed = duration_cast<milliseconds>(tp_now - tp_prev).count() / 1000.0f;
+        /* Calculate time elapsed since last frame, benchmarks simulate a fixed timestep */
+        tp_now = steady_clock::now();
+        float elapsed = duration<float>(tp_now - tp_prev).count();
+        uint64_t frame_ns = duration_cast<nanoseconds>(tp_now - tp_prev).count();
         tp_prev = tp_now;        
+
+        if (bench != nullptr) {
+            /* Previous frame is complete, its wall time spans the whole loop */
+            if (m_global_clock > 0.0f)
+                bench->record_frame(m_renderer, frame_ns);
+            if (bench->finished()) {
+                m_window.close();
+                break;
+            }
+
+            elapsed = bench->timestep();
+        }
         
         physics_delta += elapsed;
         m_global_clock += elapsed;
@@ -124,16 +181,24 @@ void engine_runtime::start() {
         /* Logic */
         const mat4x4 ident = identity<mat4x4>();
         
+        if (bench != nullptr)
+            bench->drive_camera(m_renderer, m_global_clock);
+
+        /* Zoned around the root only, the nodes recurse and would flood the profiler's rings */
         if (m_root_node != nullptr) {
-            m_root_node->update_node(elapsed);
-            m_root_node->prepare_draw(ident);
+            {
+                PROFILE_ZONE("scene_node::update_node");
+                m_root_node->update_node(elapsed);
+            }
+            {
+                PROFILE_ZONE("scene_node::prepare_draw");
+                m_root_node->prepare_draw(ident);
+            }
         }
 
-        /* Render & postprocess */
-        m_renderer.draw_scene();
-
-        /* Display new frame */
-        glfwSwapBuffers(m_window.props().glfw_handle);
+        /* Hand the frame over to be rendered, postprocessed and displayed */
+        m_renderer.submit_frame();
+        PROFILE_FRAME();
     }
 }
 
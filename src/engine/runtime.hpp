@@ -4,6 +4,7 @@
 #include "events.hpp"
 #include "scene/scene_node.hpp"
 #include "game_window.hpp"
+#include "benchmark.hpp"
 
 #include <glm/fwd.hpp>
 
@@ -18,7 +19,8 @@ class engine_runtime {
         ~engine_runtime();
 
         /// @brief Starts the mainloop
-        void start(); 
+        /// @param bench Benchmark to run instead of the default scene, runs until the benchmark finishes
+        void start(benchmark* bench = nullptr); 
 
         inline static engine_runtime* instance() { return s_instance; }
         
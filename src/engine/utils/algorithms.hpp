@@ -1,7 +1,9 @@
 #pragma once
 
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -30,6 +32,50 @@ namespace utils {
         return (iter != container.end()) && (iter == --container.end());
     }
 
+    /// @brief Stable LSD radix sort by a 64-bit key
+    ///
+    /// Sorts by 8 bits per pass. Histograms of all passes are gathered in a single sweep,
+    /// passes over bytes shared by all the keys are skipped
+    /// @param values Values to be sorted
+    /// @param scratch Scratch storage, reused between calls to avoid allocations
+    /// @param key Function returning the @c uint64_t key of a value
+    template <class Tp, class KeyFn>
+    void radix_sort(std::vector<Tp>& values, std::vector<Tp>& scratch, KeyFn key) {
+
+        if (values.size() < 2)
+            return;
+
+        std::array<std::array<size_t, 256>, 8> histograms = {};
+        for (const auto& value : values) {
+            uint64_t k = key(value);
+            for (size_t byte = 0; byte < 8; byte++)
+                histograms[byte][(k >> (byte * 8)) & 0xFF]++;
+        }
+
+        scratch.resize(values.size());
+        for (size_t byte = 0; byte < 8; byte++) {
+
+            auto& offsets = histograms[byte];
+            size_t shift = byte * 8;
+
+            /* Every key has the same byte, pass would not move anything */
+            if (offsets[(key(values[0]) >> shift) & 0xFF] == values.size())
+                continue;
+
+            size_t sum = 0;
+            for (auto& offset : offsets) {
+                size_t count = offset;
+                offset = sum;
+                sum += count;
+            }
+
+            for (const auto& value : values)
+                scratch[offsets[(key(value) >> shift) & 0xFF]++] = value;
+
+            values.swap(scratch);
+        }
+    }
+
     /* Borrowed from https://helloacm.com/cc-function-to-compute-the-bilinear-interpolation/ */
     inline float bilinear_interpolation(float q11, float q12, float q21, float q22, float x1, float x2, float y1, float y2, float x, float y) {
         
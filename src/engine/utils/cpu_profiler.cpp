@@ -0,0 +1,131 @@
+#include "cpu_profiler.hpp"
+
+#ifdef ENGINE_PROFILE
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace utils;
+
+cpu_profiler::scoped_zone::scoped_zone(const char* name) 
+    : m_name(name), m_start_ns(m_now()) {
+
+    m_thread_ring().depth++;
+}
+
+cpu_profiler::scoped_zone::~scoped_zone() {
+
+    uint64_t end_ns = m_now();
+    thread_ring& ring = m_thread_ring();
+    ring.depth--;
+
+    /* Only the owning thread writes, publishing the event is a release store of the head */
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % c_ring_capacity] = zone_event{ m_name, m_start_ns, end_ns, ring.depth };
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+cpu_profiler& cpu_profiler::instance() {
+
+    static cpu_profiler s_instance;
+    return s_instance;
+}
+
+cpu_profiler::cpu_profiler() 
+    : m_capture_frames(0), m_capture_start(0) {}
+
+void cpu_profiler::end_frame() {
+
+    if (m_capture_frames == 0)
+        return;
+
+    if (--m_capture_frames == 0)
+        m_export(m_capture_start, m_now());
+}
+
+void cpu_profiler::capture(uint32_t frames, const std::string& path) {
+
+    m_capture_path = path;
+    m_capture_frames = frames;
+    m_capture_start = m_now();
+}
+
+uint64_t cpu_profiler::m_now() {
+
+    static const auto s_epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+cpu_profiler::thread_ring& cpu_profiler::m_thread_ring() {
+
+    /* Rings outlive their threads, a capture may still read them */
+    thread_local thread_ring* t_ring = nullptr;
+    if (t_ring != nullptr)
+        return *t_ring;
+
+    cpu_profiler& profiler = instance();
+    std::lock_guard<std::mutex> lock(profiler.m_rings_lock);
+
+    auto ring = std::make_unique<thread_ring>();
+    ring->events.resize(c_ring_capacity);
+    ring->head = 0;
+    ring->depth = 0;
+    ring->thread_id = profiler.m_rings.size();
+
+    t_ring = ring.get();
+    profiler.m_rings.push_back(std::move(ring));
+    return *t_ring;
+}
+
+void cpu_profiler::m_export(uint64_t start_ns, uint64_t end_ns) {
+
+    std::ofstream trace = std::ofstream(m_capture_path, std::ios::out | std::ios::trunc);
+    if (!trace.is_open()) {
+        std::cerr << "[ERROR] Unable to write CPU profile " << m_capture_path << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_rings_lock);
+    std::vector<zone_event> events;
+    bool first = true;
+
+    /* Microseconds with nanosecond digits, the default precision would round timestamps of a long run */
+    trace << std::fixed << std::setprecision(3);
+    trace << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (const auto& ring : m_rings) {
+
+        /* Copy the newest events, then drop those the owner may have overwritten meanwhile */
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = head > c_ring_capacity ? head - c_ring_capacity : 0;
+
+        events.clear();
+        for (uint64_t i = tail; i < head; i++)
+            events.push_back(ring->events[i % c_ring_capacity]);
+
+        uint64_t new_head = ring->head.load(std::memory_order_acquire);
+        uint64_t valid_from = new_head > c_ring_capacity ? new_head - c_ring_capacity : 0;
+
+        for (uint64_t i = std::max(tail, valid_from); i < head; i++) {
+
+            const zone_event& event = events[i - tail];
+            if (event.end_ns < start_ns || event.start_ns > end_ns)
+                continue;
+
+            /* Trace timestamps are in microseconds */
+            trace << (first ? "" : ",") << "\n{\"name\":\"" << event.name 
+                  << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->thread_id
+                  << ",\"ts\":" << event.start_ns / 1000.0 
+                  << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0
+                  << ",\"args\":{\"depth\":" << event.depth << "}}";
+            first = false;
+        }
+    }
+
+    trace << "\n]}\n";
+    std::cerr << "[INFO] CPU profile written to " << m_capture_path << std::endl;
+}
+
+#endif
@@ -0,0 +1,101 @@
+///
+/// @file cpu_profiler.hpp
+/// @author geffevil
+///
+#pragma once
+
+/// @brief Opens a zone lasting until the end of the enclosing scope
+/// @param name String literal naming the zone
+///
+/// Zones are recorded only when built with @c ENGINE_PROFILE, otherwise the macros expand to nothing
+#ifdef ENGINE_PROFILE
+    #define PROFILE_CONCAT_IMPL(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+    #define PROFILE_ZONE(name) utils::cpu_profiler::scoped_zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+    #define PROFILE_FRAME() utils::cpu_profiler::instance().end_frame()
+    #define PROFILE_CAPTURE(frames, path) utils::cpu_profiler::instance().capture(frames, path)
+#else
+    #define PROFILE_ZONE(name)
+    #define PROFILE_FRAME()
+    #define PROFILE_CAPTURE(frames, path)
+#endif
+
+#ifdef ENGINE_PROFILE
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+    /// @brief Scoped-zone profiler of the CPU work
+    ///
+    /// Each thread records its finished zones into its own ring buffer, so recording takes no locks.
+    /// Captures cover a window of frames and are exported as Chrome trace-event JSON
+    class cpu_profiler {
+
+        public:
+            /// @brief Zone spanning the lifetime of the object
+            class scoped_zone {
+
+                public:
+                    scoped_zone(const char* name);
+                    ~scoped_zone();
+
+                    scoped_zone(const scoped_zone&) = delete;
+                    scoped_zone& operator=(const scoped_zone&) = delete;
+
+                private:
+                    const char* m_name;
+                    uint64_t m_start_ns;
+            };
+
+        public:
+            static cpu_profiler& instance();
+
+            /// @brief Marks the end of a frame, finishing the running capture once its window is over
+            void end_frame();
+
+            /// @brief Captures the zones of the following frames
+            /// @param frames Number of frames to be captured
+            /// @param path Path of the exported trace
+            void capture(uint32_t frames, const std::string& path);
+
+        private:
+            static constexpr size_t c_ring_capacity = 1 << 16;    ///< Zones kept per thread
+
+            struct zone_event {
+                const char* name;
+                uint64_t start_ns;
+                uint64_t end_ns;
+                uint32_t depth;
+            };
+
+            /// @brief Zones of a single thread, written only by the owning thread
+            struct thread_ring {
+                std::vector<zone_event> events;
+                std::atomic<uint64_t> head;     ///< Number of zones ever written
+                uint32_t depth;                 ///< Nesting depth of the next zone
+                uint32_t thread_id;
+            };
+
+            cpu_profiler();
+
+            static uint64_t m_now();
+            static thread_ring& m_thread_ring();
+            void m_export(uint64_t start_ns, uint64_t end_ns);
+
+        private:
+            std::mutex m_rings_lock;
+            std::vector<std::unique_ptr<thread_ring>> m_rings;
+
+            std::string m_capture_path;
+            uint32_t m_capture_frames;  ///< Frames left in the running capture
+            uint64_t m_capture_start;
+    };
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "gpu_memory.hpp"
+#include <chrono>
 #include <cstddef>
 #include <glm/glm.hpp>
 #include <iostream>
@@ -105,4 +106,128 @@ void gpu_allocator::free_all_and_resize(size_t new_size) {
 
     m_chunks.clear();
     m_chunks.emplace_front(new_size, 0, false);
-}
\ No newline at end of file
+}
+
+/* Offsets of indexed bindings must be aligned, 256 is the largest alignment the spec permits */
+constexpr size_t c_ring_region_alignment = 256;
+
+size_t gpu_allocator::used_size() const {
+
+    size_t used = 0;
+    for (const auto& chunk : m_chunks) {
+        if (chunk.used)
+            used += chunk.chunk_size;
+    }
+
+    return used;
+}
+
+gpu_frame_sync::gpu_frame_sync()
+    : m_frame_index(0), m_statistics({0, 0, 0}) {
+
+    m_fences.fill(nullptr);
+}
+
+gpu_frame_sync::~gpu_frame_sync() {
+
+    for (GLsync fence : m_fences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    }
+}
+
+void gpu_frame_sync::begin_frame() {
+
+    m_frame_index = (m_frame_index + 1) % c_frames_in_flight;
+    m_statistics.last_wait_ns = 0;
+
+    GLsync fence = m_fences[m_frame_index];
+    if (fence == nullptr)
+        return;
+
+    /* Poll first, only measure when the GPU is actually behind */
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+
+        auto wait_start = chrono::steady_clock::now();
+        
+        do { status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); }
+        while (status == GL_TIMEOUT_EXPIRED);
+
+        m_statistics.last_wait_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - wait_start).count();
+        m_statistics.total_wait_ns += m_statistics.last_wait_ns;
+        m_statistics.stalled_frames++;
+    }
+
+    if (status == GL_WAIT_FAILED)
+        std::cerr << "[ERROR] Waiting for frame " << m_frame_index << " fence failed!" << std::endl;
+
+    glDeleteSync(fence);
+    m_fences[m_frame_index] = nullptr;
+}
+
+void gpu_frame_sync::end_frame() {
+
+    if (m_fences[m_frame_index] != nullptr)
+        glDeleteSync(m_fences[m_frame_index]);
+
+    m_fences[m_frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+gpu_ring_buffer::gpu_ring_buffer(size_t frame_size) 
+    : m_frame_size(0), m_mapped_data(nullptr), m_buffer(0) {
+
+    m_allocate(frame_size);
+}
+
+gpu_ring_buffer::~gpu_ring_buffer() {
+
+    m_release();
+}
+
+void* gpu_ring_buffer::frame_data(size_t frame_index, size_t size) {
+
+    if (size > m_frame_size) {
+
+        std::cerr << "[INFO] Ring buffer " << m_buffer << " too small, growing regions to " << max(size, 2 * m_frame_size) << " bytes" << std::endl;
+
+        /* Every frame in flight may still read the old buffer */
+        glFinish();
+        m_release();
+        m_allocate(max(size, 2 * m_frame_size));
+    }
+
+    return m_mapped_data + frame_offset(frame_index);
+}
+
+void gpu_ring_buffer::bind_range(GLenum target, GLuint index, size_t frame_index) const {
+
+    glBindBufferRange(target, index, m_buffer, frame_offset(frame_index), m_frame_size);
+}
+
+void gpu_ring_buffer::m_allocate(size_t frame_size) {
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    /* Round regions up, so every one of them starts at an aligned offset */
+    m_frame_size = ((frame_size + c_ring_region_alignment - 1) / c_ring_region_alignment) * c_ring_region_alignment;
+
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferStorage(m_buffer, m_frame_size * gpu_frame_sync::c_frames_in_flight, nullptr, flags);
+    m_mapped_data = static_cast<uint8_t*>(glMapNamedBufferRange(m_buffer, 0, m_frame_size * gpu_frame_sync::c_frames_in_flight, flags));
+
+    if (m_mapped_data == nullptr)
+        throw runtime_error("Unable to persistently map a ring buffer of size " + to_string(m_frame_size) + " bytes!");
+}
+
+void gpu_ring_buffer::m_release() {
+
+    if (m_buffer == 0)
+        return;
+
+    glUnmapNamedBuffer(m_buffer);
+    glDeleteBuffers(1, &m_buffer);
+
+    m_buffer = 0;
+    m_mapped_data = nullptr;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <forward_list>
 #include "../../lib/glad/glad.h"
 
@@ -37,6 +39,9 @@ namespace utils {
             inline size_t buffer_size() const { return m_buffer_size; }
             inline GLuint buffer() const { return  m_buffer; }
 
+            /// @brief Number of bytes in the allocated chunks
+            size_t used_size() const;
+
         private:
             size_t m_buffer_size;
             GLbitfield m_buffer_hints;
@@ -44,4 +49,86 @@ namespace utils {
 
             GLuint m_buffer;
     };
+
+    /// @brief Fence-based pacing of the frames in flight
+    ///
+    /// Each frame in flight owns a region of every @c gpu_ring_buffer. Before the CPU writes
+    /// into a region again, it has to wait until the GPU is done with the frame that used it last
+    class gpu_frame_sync {
+
+        public:
+            static constexpr size_t c_frames_in_flight = 3;   ///< Number of frames CPU may get ahead of the GPU
+
+            /// @brief Statistics of the fence waits
+            struct wait_statistics {
+                uint64_t last_wait_ns;      ///< Time spent waiting at the beginning of the last frame
+                uint64_t total_wait_ns;     ///< Time spent waiting since creation
+                uint64_t stalled_frames;    ///< Number of frames which had to wait for the GPU
+            };
+
+        public:
+            gpu_frame_sync();
+            gpu_frame_sync(const gpu_frame_sync&) = delete;
+            gpu_frame_sync(gpu_frame_sync&&) = delete;
+
+            ~gpu_frame_sync();
+
+            /// @brief Advances to the next frame and waits until its buffer regions are free to be written
+            void begin_frame();
+
+            /// @brief Guards current frame's regions with a fence, must be called after all the frame's commands were issued
+            void end_frame();
+
+            inline size_t frame_index() const { return m_frame_index; }
+            inline const wait_statistics& statistics() const { return m_statistics; }
+
+        private:
+            std::array<GLsync, c_frames_in_flight> m_fences;
+            size_t m_frame_index;
+            wait_statistics m_statistics;
+    };
+
+    /// @brief Persistently mapped buffer, split into one region per frame in flight
+    ///
+    /// Regions are meant to be filled once per frame, the CPU writes straight into the mapped memory.
+    /// Synchronization is left to @c gpu_frame_sync
+    class gpu_ring_buffer {
+
+        public:
+            /// @brief Constructor
+            /// @param frame_size Initial size of a single frame's region in bytes
+            gpu_ring_buffer(size_t frame_size);
+            gpu_ring_buffer(const gpu_ring_buffer&) = delete;
+            gpu_ring_buffer(gpu_ring_buffer&&) = delete;
+
+            ~gpu_ring_buffer();
+
+            /// @brief Provides memory of the frame's region
+            ///
+            /// When the region is too small, the buffer is reallocated. This waits for the GPU to finish
+            /// all the work, and drops any data written into the other regions
+            /// @param frame_index Index of the frame in flight
+            /// @param size Number of bytes to be written
+            /// @returns Pointer to the mapped memory of the region
+            void* frame_data(size_t frame_index, size_t size);
+
+            /// @brief Binds the frame's region to an indexed binding point
+            /// @param target Buffer target (for example @c GL_SHADER_STORAGE_BUFFER)
+            /// @param index Binding point index
+            /// @param frame_index Index of the frame in flight
+            void bind_range(GLenum target, GLuint index, size_t frame_index) const;
+
+            inline size_t frame_offset(size_t frame_index) const { return frame_index * m_frame_size; }
+            inline size_t frame_size() const { return m_frame_size; }
+            inline GLuint buffer() const { return m_buffer; }
+
+        private:
+            void m_allocate(size_t frame_size);
+            void m_release();
+
+        private:
+            size_t m_frame_size;
+            uint8_t* m_mapped_data;
+            GLuint m_buffer;
+    };
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "gpu_profiler.hpp"
+#include <iostream>
+
+using namespace utils;
+
+gpu_profiler::gpu_profiler(size_t max_zones) 
+    : m_max_zones(max_zones), m_current(nullptr), m_overflow_reported(false), m_results_frame(0) {}
+
+gpu_profiler::~gpu_profiler() {
+
+    for (auto& slot : m_slots) {
+        if (!slot.queries.empty())
+            glDeleteQueries(slot.queries.size(), slot.queries.data());
+    }
+}
+
+void gpu_profiler::init() {
+
+    for (auto& slot : m_slots) {
+        slot.queries.resize(2 * m_max_zones);
+        glGenQueries(slot.queries.size(), slot.queries.data());
+        slot.zones.reserve(m_max_zones);
+    }
+}
+
+void gpu_profiler::begin_frame(size_t frame_index, uint64_t frame_number) {
+
+    m_current = &m_slots[frame_index];
+    m_read_back(*m_current);
+
+    m_current->zones.clear();
+    m_current->frame_number = frame_number;
+    m_open_zones.clear();
+}
+
+void gpu_profiler::end_frame() {
+
+    while (!m_open_zones.empty())
+        end_zone();
+
+    m_current = nullptr;
+}
+
+void gpu_profiler::begin_zone(const std::string& name) {
+
+    if (m_current == nullptr)
+        return;
+
+    /* Out of queries, the zone is dropped - nested ends are matched by the open zone stack */
+    if (m_current->zones.size() >= m_max_zones) {
+
+        if (!m_overflow_reported)
+            std::cerr << "[WARNING] GPU profiler ran out of zones (" << m_max_zones << "), skipping " << name << std::endl;
+        
+        m_overflow_reported = true;
+        m_open_zones.push_back(SIZE_MAX);
+        return;
+    }
+
+    uint32_t query = m_current->zones.size() * 2;
+    m_current->zones.push_back(recorded_zone{ name, static_cast<uint32_t>(m_open_zones.size()), query });
+    m_open_zones.push_back(m_current->zones.size() - 1);
+
+    glQueryCounter(m_current->queries[query], GL_TIMESTAMP);
+}
+
+void gpu_profiler::end_zone() {
+
+    if (m_current == nullptr || m_open_zones.empty())
+        return;
+
+    size_t zone = m_open_zones.back();
+    m_open_zones.pop_back();
+
+    if (zone != SIZE_MAX)
+        glQueryCounter(m_current->queries[m_current->zones[zone].query + 1], GL_TIMESTAMP);
+}
+
+void gpu_profiler::open_csv(const std::string& path) {
+
+    m_csv = std::ofstream(path, std::ios::out | std::ios::trunc);
+    if (!m_csv.is_open()) {
+        std::cerr << "[ERROR] Unable to open GPU profile " << path << std::endl;
+        return;
+    }
+
+    m_csv << "frame,zone,depth,start_ns,duration_ns\n";
+}
+
+void gpu_profiler::m_read_back(frame_slot& slot) {
+
+    if (slot.zones.empty())
+        return;
+
+    /* Slot's fence was passed, results are available without waiting */
+    GLuint64 frame_start = 0;
+    glGetQueryObjectui64v(slot.queries[slot.zones.front().query], GL_QUERY_RESULT, &frame_start);
+
+    m_results.clear();
+    for (const auto& zone : slot.zones) {
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[zone.query], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(slot.queries[zone.query + 1], GL_QUERY_RESULT, &end);
+
+        m_results.push_back(zone_result{ zone.name, zone.depth, start - frame_start, end > start ? end - start : 0 });
+    }
+
+    m_results_frame = slot.frame_number;
+
+    if (!m_csv.is_open())
+        return;
+
+    for (const auto& result : m_results)
+        m_csv << m_results_frame << ',' << result.name << ',' << result.depth << ',' << result.start_ns << ',' << result.duration_ns << '\n';
+}
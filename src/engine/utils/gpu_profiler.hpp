@@ -0,0 +1,110 @@
+///
+/// @file gpu_profiler.hpp
+/// @author geffevil
+///
+#pragma once
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "gpu_memory.hpp"
+#include "../../lib/glad/glad.h"
+
+namespace utils {
+
+    /// @brief Timestamp-query profiler of GPU work
+    ///
+    /// Zones are delimited by @c glQueryCounter timestamps. Every frame in flight owns its own set of
+    /// query objects, which are read back once @c gpu_frame_sync released the frame, so reading never stalls
+    class gpu_profiler {
+
+        public:
+            /// @brief Measured zone
+            struct zone_result {
+                std::string name;
+                uint32_t depth;         ///< Nesting depth of the zone
+                uint64_t start_ns;      ///< Start of the zone, relative to the first zone of the frame
+                uint64_t duration_ns;   ///< GPU time spent in the zone
+            };
+
+            /// @brief Zone spanning the lifetime of the object
+            class scoped_zone {
+                
+                public:
+                    scoped_zone(gpu_profiler& profiler, const std::string& name) : m_profiler(profiler) { m_profiler.begin_zone(name); }
+                    ~scoped_zone() { m_profiler.end_zone(); }
+
+                    scoped_zone(const scoped_zone&) = delete;
+                    scoped_zone& operator=(const scoped_zone&) = delete;
+
+                private:
+                    gpu_profiler& m_profiler;
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param max_zones Maximum number of zones measured in a single frame
+            gpu_profiler(size_t max_zones = 64);
+            gpu_profiler(const gpu_profiler&) = delete;
+            gpu_profiler(gpu_profiler&&) = delete;
+
+            ~gpu_profiler();
+
+            /// @brief Creates the query objects, requires a current OpenGL context
+            void init();
+
+            /// @brief Reads back the results of the frame that last used the slot, and starts recording into it
+            ///
+            /// Must be called after @c gpu_frame_sync::begin_frame, which guarantees the slot's queries are finished
+            /// @param frame_index Index of the frame in flight
+            /// @param frame_number Number of the frame, reported in the CSV
+            void begin_frame(size_t frame_index, uint64_t frame_number);
+
+            /// @brief Ends the frame, closing all the zones left open
+            void end_frame();
+
+            /// @brief Opens a zone, zones may nest
+            /// @param name Name of the zone
+            void begin_zone(const std::string& name);
+
+            /// @brief Closes the innermost open zone
+            void end_zone();
+
+            /// @brief Starts dumping every read back frame as CSV rows
+            /// @param path Path of the CSV file
+            void open_csv(const std::string& path);
+
+            /// @brief Zones of the latest read back frame
+            inline const std::vector<zone_result>& results() const { return m_results; }
+
+            /// @brief Number of the frame the results belong to
+            inline uint64_t results_frame() const { return m_results_frame; }
+
+        private:
+            struct recorded_zone {
+                std::string name;
+                uint32_t depth;
+                uint32_t query;     ///< Index of the start query, end query follows
+            };
+
+            struct frame_slot {
+                std::vector<GLuint> queries;
+                std::vector<recorded_zone> zones;
+                uint64_t frame_number;
+            };
+
+            void m_read_back(frame_slot& slot);
+
+        private:
+            size_t m_max_zones;
+            std::array<frame_slot, gpu_frame_sync::c_frames_in_flight> m_slots;
+            frame_slot* m_current;
+            std::vector<size_t> m_open_zones;   ///< Indices of the open zones of the current frame
+            bool m_overflow_reported;
+
+            std::vector<zone_result> m_results;
+            uint64_t m_results_frame;
+            std::ofstream m_csv;
+    };
+}
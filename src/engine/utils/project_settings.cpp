@@ -11,6 +11,12 @@
     if (!isdigit(str_##field.back()))                            \
         field *= UNIT_MAP.at(str_##field.back());
 
+#define PARSE_NUMERIC_SIZE_OR(field, path, default_value)                       \
+    string str_##field = setting_resx.deserialize<string>(path, default_value); \
+    field = strtoul(str_##field.c_str(), nullptr, 10);                          \
+    if (!isdigit(str_##field.back()))                                           \
+        field *= UNIT_MAP.at(str_##field.back());
+
 
 using namespace utils;
 
@@ -34,8 +40,21 @@ void project_settings::init(std::string path) {
     /* Init EVERYTHING */
     m_project_name = setting_resx.deserialize<std::string>("project/name");
     m_gl_global_capabilities = setting_resx.deserialize<vector<uint32_t>>("project/ogl/gl_capabilities");
+    m_depth_prepass = setting_resx.deserialize<bool>("project/ogl/depth_prepass", false);
+    m_render_thread = setting_resx.deserialize<bool>("project/ogl/render_thread", false);
+    m_upload_thread = setting_resx.deserialize<bool>("project/ogl/upload_thread", false);
+    m_min_resolution_scale = setting_resx.deserialize<float>("project/ogl/dynamic_resolution/min_scale", 1.0f);
+    m_max_resolution_scale = setting_resx.deserialize<float>("project/ogl/dynamic_resolution/max_scale", 1.0f);
+    m_target_frame_time = setting_resx.deserialize<float>("project/ogl/dynamic_resolution/target_frame_time", 16.6f);
+    m_gpu_profile_path = setting_resx.deserialize<std::string>("project/ogl/gpu_profile_csv", "");
+    m_profile_capture_frames = setting_resx.deserialize<uint32_t>("project/profiler/capture_frames", 0);
+    m_profile_capture_path = setting_resx.deserialize<std::string>("project/profiler/capture_path", "profile.json");
     m_tex_min_filter = setting_resx.deserialize<int>("project/textures/min_filter");
     m_tex_mag_filter = setting_resx.deserialize<int>("project/textures/mag_filter");
+    m_texture_stream_tail = setting_resx.deserialize<uint32_t>("project/textures/stream_tail_size", 0);
+    m_force_texture_arrays = setting_resx.deserialize<bool>("project/textures/force_texture_arrays", false);
+    m_decode_threads = setting_resx.deserialize<uint32_t>("project/textures/decode_threads", 0);
+    m_load_threads = setting_resx.deserialize<uint32_t>("project/assets/load_threads", 2);
     m_physics_interval = setting_resx.deserialize<float>("project/physics/update_interval");
     m_default_scene_path = setting_resx.deserialize<std::string>("project/game/default_scene");
     m_default_shaders = setting_resx.deserialize<vector<string>>("project/game/default_shaders");
@@ -43,4 +62,7 @@ void project_settings::init(std::string path) {
     PARSE_NUMERIC_SIZE(m_gpu_geometry_buffer_alloc_size, "project/ogl/gpu_geometry_buffer_alloc_size")
     PARSE_NUMERIC_SIZE(m_gpu_material_buffer_alloc_size, "project/ogl/gpu_material_buffer_alloc_size")
     PARSE_NUMERIC_SIZE(m_gpu_textures_buffer_alloc_size, "project/ogl/gpu_textures_buffer_alloc_size")
+    PARSE_NUMERIC_SIZE_OR(m_texture_budget, "project/ogl/texture_budget", "0")
+    PARSE_NUMERIC_SIZE_OR(m_upload_staging_size, "project/ogl/upload_staging_size", "32M")
+    PARSE_NUMERIC_SIZE_OR(m_asset_cache_budget, "project/assets/cache_budget", "256M")
 }
@@ -23,8 +23,24 @@ namespace utils {
             static inline size_t gpu_geometry_buffer_alloc_size() { CHECK_AND_RETURN(m_gpu_geometry_buffer_alloc_size); }
             static inline size_t gpu_material_buffer_alloc_size() { CHECK_AND_RETURN(m_gpu_material_buffer_alloc_size); }
             static inline size_t gpu_textures_buffer_alloc_size() { CHECK_AND_RETURN(m_gpu_textures_buffer_alloc_size); }
+            static inline size_t texture_budget() { CHECK_AND_RETURN(m_texture_budget); }
+            static inline bool depth_prepass() { CHECK_AND_RETURN(m_depth_prepass); }
+            static inline bool render_thread() { CHECK_AND_RETURN(m_render_thread); }
+            static inline bool upload_thread() { CHECK_AND_RETURN(m_upload_thread); }
+            static inline size_t upload_staging_size() { CHECK_AND_RETURN(m_upload_staging_size); }
+            static inline float min_resolution_scale() { CHECK_AND_RETURN(m_min_resolution_scale); }
+            static inline float max_resolution_scale() { CHECK_AND_RETURN(m_max_resolution_scale); }
+            static inline float target_frame_time() { CHECK_AND_RETURN(m_target_frame_time); }
+            static inline const std::string& gpu_profile_path() { CHECK_AND_RETURN(m_gpu_profile_path); }
+            static inline uint32_t profile_capture_frames() { CHECK_AND_RETURN(m_profile_capture_frames); }
+            static inline const std::string& profile_capture_path() { CHECK_AND_RETURN(m_profile_capture_path); }
             static inline int tex_min_filter() { CHECK_AND_RETURN(m_tex_min_filter); }
             static inline int tex_mag_filter() { CHECK_AND_RETURN(m_tex_mag_filter); }
+            static inline uint32_t texture_stream_tail() { CHECK_AND_RETURN(m_texture_stream_tail); }
+            static inline bool force_texture_arrays() { CHECK_AND_RETURN(m_force_texture_arrays); }
+            static inline uint32_t decode_threads() { CHECK_AND_RETURN(m_decode_threads); }
+            static inline uint32_t load_threads() { CHECK_AND_RETURN(m_load_threads); }
+            static inline size_t asset_cache_budget() { CHECK_AND_RETURN(m_asset_cache_budget); }
             static inline float physics_interval() { CHECK_AND_RETURN(m_physics_interval); }   
             static inline const std::string& default_scene_path() { CHECK_AND_RETURN(m_default_scene_path); }
             static inline const std::vector<std::string>& default_shaders() { CHECK_AND_RETURN(m_default_shaders); }
@@ -40,10 +56,30 @@ namespace utils {
             size_t m_gpu_geometry_buffer_alloc_size;
             size_t m_gpu_material_buffer_alloc_size;
             size_t m_gpu_textures_buffer_alloc_size;
+            size_t m_texture_budget;
+            bool m_depth_prepass;
+            bool m_render_thread;
+            bool m_upload_thread;
+            size_t m_upload_staging_size;
+            float m_min_resolution_scale,
+                  m_max_resolution_scale;
+            float m_target_frame_time;
+            std::string m_gpu_profile_path;
+
+            /* Profiling */
+            uint32_t m_profile_capture_frames;
+            std::string m_profile_capture_path;
 
             /* Textures */
             int m_tex_min_filter, 
                 m_tex_mag_filter;
+            uint32_t m_texture_stream_tail;
+            bool m_force_texture_arrays;
+            uint32_t m_decode_threads;
+
+            /* Assets */
+            uint32_t m_load_threads;
+            size_t m_asset_cache_budget;
 
             /* Physics */
             float m_physics_interval;
@@ -9,7 +9,8 @@ class video_mode {
 
     public:
         enum class window_mode {
-            WINDOW, BORDERLESS, FULLSCREEN
+            WINDOW, BORDERLESS, FULLSCREEN, 
+            HEADLESS    ///< No window, rendered offscreen through EGL
         };
         
         enum class aa_level {
@@ -22,6 +23,9 @@ class video_mode {
 
         constexpr video_mode(int w, int h, window_mode win_mode, aa_level antialias, bool vsync)
             : m_w(w), m_h(h), m_win_mode(win_mode), m_antialias_level(antialias), m_vsync(vsync) {}
+
+        /// @brief Copy of the mode with a different window mode
+        constexpr video_mode with_win_mode(window_mode win_mode) const { return video_mode(m_w, m_h, win_mode, m_antialias_level, m_vsync); }
         
         video_mode(std::string path, const video_mode& fallback);
         void save(std::string path);
@@ -43,7 +47,8 @@ class video_mode {
 NLOHMANN_JSON_SERIALIZE_ENUM(video_mode::window_mode, {
     {video_mode::window_mode::WINDOW, "windowed"},
     {video_mode::window_mode::BORDERLESS, "borderless"},
-    {video_mode::window_mode::FULLSCREEN, "fullscreen"}
+    {video_mode::window_mode::FULLSCREEN, "fullscreen"},
+    {video_mode::window_mode::HEADLESS, "headless"}
 });
 
 NLOHMANN_JSON_SERIALIZE_ENUM(video_mode::aa_level, {